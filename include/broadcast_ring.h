@@ -0,0 +1,226 @@
+#ifndef STDX_BROADCAST_RING_H
+#define STDX_BROADCAST_RING_H
+
+#include "memory.h"
+#include "utils.h"
+
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <thread>
+
+namespace stdx
+{
+  /**
+   * \brief broadcast_ring is a bounded, lock-free single-producer multi-consumer ring buffer
+   *        (in the style of the LMAX Disruptor) which delivers every published object
+   *        to every consumer.
+   *
+   *        A slot of the ring holds a single reference to the published object,
+   *        the consumers read the slots in place through sequence barriers instead
+   *        of copying the retain_ptr. The reference held by a slot is released lazily
+   *        by the producer: the slots which all consumers have passed are released
+   *        when the producer finds the ring full or by an explicit release_consumed().
+   *        A consumed object therefore stays alive for at most capacity() further
+   *        publications. The reference count of a message is
+   *        touched twice (publish and release) regardless of the number of consumers.
+   * \tparam T the type of the object managed by the published retain_ptr
+   * \tparam Traits the traits suitable for type T
+   * \note the publish functions may be called by the single producer thread only,
+   *       poll(consumer, ...) may be called by the thread owning the consumer only
+   */
+  template<typename T, typename Traits = retain_traits<T>>
+  class broadcast_ring
+  {
+  public:
+    using value_type = retain_ptr<T, Traits>;
+    using size_type = std::size_t;
+    using sequence_type = std::uint64_t;
+
+    /// @name Construction
+    /// @{
+
+    /**
+     * \brief Constructs an empty ring
+     * \param capacity the capacity of the ring (rounded up to a power of two)
+     * \param consumer_count the number of consumers, the consumers are identified
+     *        by indices [0, consumer_count)
+     */
+    broadcast_ring(size_type capacity, size_type consumer_count)
+      : m_mask(detail::round_up_to_power_of_two(capacity) - 1)
+      , m_slots(std::make_unique<value_type[]>(m_mask + 1))
+      , m_consumer_count(consumer_count)
+      , m_consumers(std::make_unique<consumer_state[]>(consumer_count))
+    {
+    }
+
+    broadcast_ring(const broadcast_ring&) = delete;
+    broadcast_ring(broadcast_ring&&) = delete;
+    broadcast_ring& operator=(const broadcast_ring&) = delete;
+    broadcast_ring& operator=(broadcast_ring&&) = delete;
+
+    ~broadcast_ring() = default;
+
+    /// @}
+
+    /// @name Producer
+    /// @{
+
+    /**
+     * \brief publishes the object if the slowest consumer would not be overrun
+     * \param value the object to publish
+     * \return true if the object has been published (value is nullptr afterwards),
+     *         false if the ring is full (value is untouched)
+     */
+    bool try_publish(value_type&& value) noexcept
+    {
+      const auto cursor = m_producer.cursor;
+      if (cursor - m_producer.gate >= this->capacity())
+      {
+        this->release_consumed();
+        if (cursor - m_producer.gate >= this->capacity())
+        {
+          return false;
+        }
+      }
+
+      m_slots[cursor & m_mask] = std::move(value);
+      m_producer.cursor = cursor + 1;
+      m_cursor.store(cursor + 1, std::memory_order_release);
+      return true;
+    }
+
+    /**
+     * \brief publishes the object; waits (yields) while the slowest consumer would be overrun
+     * \param value the object to publish
+     */
+    void publish(value_type&& value) noexcept
+    {
+      while (!this->try_publish(std::move(value)))
+      {
+        std::this_thread::yield();
+      }
+    }
+
+    /**
+     * \brief releases the references held by the slots which all consumers have passed
+     * \note called implicitly when the ring looks full; calling it explicitly bounds the lifetime
+     *       of the consumed objects at the cost of reading the sequences of all consumers
+     */
+    void release_consumed() noexcept
+    {
+      auto gate = m_producer.cursor;
+      for (size_type i = 0; i < m_consumer_count; ++i)
+      {
+        const auto seq = m_consumers[i].seq.load(std::memory_order_acquire);
+        if (seq < gate)
+        {
+          gate = seq;
+        }
+      }
+
+      for (auto seq = m_producer.gate; seq != gate; ++seq)
+      {
+        m_slots[seq & m_mask].reset();
+      }
+      m_producer.gate = gate;
+    }
+
+    /// @}
+
+    /// @name Consumers
+    /// @{
+
+    /**
+     * \brief invokes f for the objects published since the last poll of the consumer,
+     *        in the order of publication, and then advances the sequence of the consumer
+     * \param consumer the index of the consumer
+     * \param f the function invoked with const value_type&; the reference is valid during the call only,
+     *        a copy of the retain_ptr extends the lifetime of the object
+     * \param max_count the maximum number of objects to process
+     * \return the number of processed objects
+     */
+    template<typename F>
+    size_type poll(size_type consumer, F&& f, size_type max_count = std::numeric_limits<size_type>::max())
+    {
+      auto& state = m_consumers[consumer];
+      const auto seq = state.seq.load(std::memory_order_relaxed);
+      if (state.cursor - seq < max_count)
+      {
+        state.cursor = m_cursor.load(std::memory_order_acquire);
+      }
+
+      const auto available = static_cast<size_type>(state.cursor - seq);
+      const auto count = available < max_count ? available : max_count;
+      for (size_type i = 0; i < count; ++i)
+      {
+        f(static_cast<const value_type&>(m_slots[(seq + i) & m_mask]));
+      }
+
+      if (count != 0)
+      {
+        state.seq.store(seq + count, std::memory_order_release);
+      }
+      return count;
+    }
+
+    /**
+     * \brief returns the number of objects published, but not processed yet by the consumer
+     * \param consumer the index of the consumer
+     */
+    [[nodiscard]]
+    size_type pending(size_type consumer) const noexcept
+    {
+      const auto seq = m_consumers[consumer].seq.load(std::memory_order_acquire);
+      return static_cast<size_type>(m_cursor.load(std::memory_order_acquire) - seq);
+    }
+
+    /// @}
+
+    /**
+     * \brief returns the sequence of the next published object
+     */
+    [[nodiscard]]
+    sequence_type cursor() const noexcept
+    {
+      return m_cursor.load(std::memory_order_acquire);
+    }
+
+    [[nodiscard]]
+    size_type capacity() const noexcept
+    {
+      return m_mask + 1;
+    }
+
+    [[nodiscard]]
+    size_type consumer_count() const noexcept
+    {
+      return m_consumer_count;
+    }
+
+  private:
+    struct alignas(cache_line_size) producer_state
+    {
+      sequence_type cursor{ 0 };
+      // all slots before the gate have been consumed and released
+      sequence_type gate{ 0 };
+    };
+
+    struct alignas(cache_line_size) consumer_state
+    {
+      std::atomic<sequence_type> seq{ 0 };
+      // the last observed cursor, private to the consumer
+      sequence_type cursor{ 0 };
+    };
+
+    const size_type m_mask;
+    const std::unique_ptr<value_type[]> m_slots;
+    const size_type m_consumer_count;
+    const std::unique_ptr<consumer_state[]> m_consumers;
+    producer_state m_producer;
+    alignas(cache_line_size) std::atomic<sequence_type> m_cursor{ 0 };
+  };
+} // end of namespace stdx
+
+#endif
@@ -0,0 +1,344 @@
+#ifndef STDX_CLOCK_CACHE_H
+#define STDX_CLOCK_CACHE_H
+
+#include "concurrent_map.h"
+#include "memory.h"
+#include "utils.h"
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+namespace stdx
+{
+  /**
+   * \brief the cost function of a clock_cache counting the entries
+   */
+  struct unit_cost
+  {
+    template<typename V>
+    [[nodiscard]]
+    constexpr std::size_t operator()(const V&) const noexcept
+    {
+      return 1;
+    }
+  };
+
+  namespace detail
+  {
+    /**
+     * \brief an entry of a clock_cache: the value, its cost and reference bit, and the links
+     *        of the clock of its shard (guarded by the mutex of the shard)
+     */
+    template<typename K, typename V, typename Traits>
+    struct clock_entry : atomic_reference_count<clock_entry<K, V, Traits>>
+    {
+      clock_entry(const K& k, retain_ptr<V, Traits> v, std::size_t c)
+        : key(k)
+        , value(std::move(v))
+        , cost(c)
+      {
+      }
+
+      const K key;
+      const retain_ptr<V, Traits> value;
+      const std::size_t cost;
+      std::atomic<bool> referenced{ false };
+      clock_entry* prev{ nullptr };
+      clock_entry* next{ nullptr };
+    };
+  } // end of namespace detail
+
+  /**
+   * \brief clock_cache is a sharded concurrent cache of retained values evicted by the CLOCK policy.
+   *
+   *        The entries are indexed by a concurrent_map: a hit is a lock-free lookup which sets the
+   *        reference bit of the entry and retains the value, without reordering any list.
+   *        The writers lock the shard of the key, which keeps its entries on a circular list swept
+   *        by the clock hand: the hand clears the reference bits of the entries it passes and evicts
+   *        the first entry found neither referenced nor retained outside of the cache (use_count()).
+   *        The capacity is the sum of the costs of the entries, split evenly across the shards.
+   * \tparam K the key type
+   * \tparam V the type of the retained values
+   * \tparam Hash the hash function of the key type
+   * \tparam KeyEqual the equality predicate of the key type
+   * \tparam Traits the traits suitable for type V
+   * \tparam Cost the cost function, invoked with (const V&)
+   * \note a shard may exceed its capacity while all its entries are retained outside of the cache
+   * \note the cache releases the evicted values once the epoch_domain reclaims their entries
+   */
+  template<typename K, typename V,
+    typename Hash = std::hash<K>,
+    typename KeyEqual = std::equal_to<K>,
+    typename Traits = retain_traits<V>,
+    typename Cost = unit_cost>
+  class clock_cache
+  {
+    using entry = detail::clock_entry<K, V, Traits>;
+
+  public:
+    using key_type = K;
+    using value_type = V;
+    using value_pointer = retain_ptr<V, Traits>;
+    using size_type = std::size_t;
+
+    /// @name Construction
+    /// @{
+
+    /**
+     * \brief Constructs an empty cache
+     * \param capacity the total cost of the entries kept by the cache
+     * \param shard_count the number of independently locked shards (rounded up to a power of two)
+     * \param cost the cost function
+     */
+    explicit clock_cache(size_type capacity, size_type shard_count = 16, const Cost& cost = Cost())
+      : m_shard_mask(detail::round_up_to_power_of_two(shard_count) - 1)
+      , m_shard_capacity((capacity + m_shard_mask) / (m_shard_mask + 1))
+      , m_shards(std::make_unique<shard[]>(m_shard_mask + 1))
+      , m_index(m_shard_mask + 1)
+      , m_cost(cost)
+    {
+    }
+
+    clock_cache(const clock_cache&) = delete;
+    clock_cache(clock_cache&&) = delete;
+    clock_cache& operator=(const clock_cache&) = delete;
+    clock_cache& operator=(clock_cache&&) = delete;
+
+    ~clock_cache() = default;
+
+    /// @}
+
+    /**
+     * \brief returns the cached value of the key and marks it referenced
+     * \return the retained value or nullptr if the key is not cached
+     */
+    [[nodiscard]]
+    value_pointer find(const key_type& key) const
+    {
+      value_pointer result;
+      m_index.visit(key, [&result](entry& e) {
+        // a hit writes the entry only the first time the hand finds it cleared
+        if (!e.referenced.load(std::memory_order_relaxed))
+        {
+          e.referenced.store(true, std::memory_order_relaxed);
+        }
+        result = e.value;
+      });
+      return result;
+    }
+
+    /**
+     * \brief checks whether the key is cached, without marking it referenced
+     */
+    [[nodiscard]]
+    bool contains(const key_type& key) const
+    {
+      return m_index.contains(key);
+    }
+
+    /**
+     * \brief caches the value if the key is not cached, evicting entries beyond the capacity
+     * \param key the key of the value
+     * \param value the value; requires value != nullptr
+     * \return true if the value has been inserted
+     */
+    bool insert(const key_type& key, value_pointer value)
+    {
+      auto& s = this->shard_of(key);
+      std::lock_guard lk(s.mutex);
+      if (m_index.contains(key))
+      {
+        return false;
+      }
+      this->insert_locked(s, key, std::move(value));
+      return true;
+    }
+
+    /**
+     * \brief caches the value or replaces the cached value of the key
+     * \param key the key of the value
+     * \param value the value; requires value != nullptr
+     */
+    void insert_or_assign(const key_type& key, value_pointer value)
+    {
+      auto& s = this->shard_of(key);
+      std::lock_guard lk(s.mutex);
+      const auto old = m_index.find(key);
+      this->insert_locked(s, key, std::move(value), old.get());
+    }
+
+    /**
+     * \brief removes the key from the cache
+     * \return true if the key has been removed
+     */
+    bool erase(const key_type& key)
+    {
+      auto& s = this->shard_of(key);
+      std::lock_guard lk(s.mutex);
+      auto old = m_index.find(key);
+      if (!old)
+      {
+        return false;
+      }
+      this->unlink(s, old.get());
+      return m_index.erase(key);
+    }
+
+    /**
+     * \brief removes all entries
+     */
+    void clear()
+    {
+      for (size_type i = 0; i <= m_shard_mask; ++i)
+      {
+        auto& s = m_shards[i];
+        std::lock_guard lk(s.mutex);
+        while (auto* e = s.hand)
+        {
+          this->unlink(s, e);
+          m_index.erase(e->key);
+        }
+      }
+    }
+
+    /**
+     * \brief returns the number of cached entries
+     */
+    [[nodiscard]]
+    size_type size() const noexcept
+    {
+      return this->sum(&shard::count);
+    }
+
+    /**
+     * \brief returns the sum of the costs of the cached entries
+     */
+    [[nodiscard]]
+    size_type total_cost() const noexcept
+    {
+      return this->sum(&shard::cost);
+    }
+
+    /**
+     * \brief returns the capacity of the cache
+     */
+    [[nodiscard]]
+    size_type capacity() const noexcept
+    {
+      return m_shard_capacity * (m_shard_mask + 1);
+    }
+
+  private:
+    struct alignas(cache_line_size) shard
+    {
+      std::mutex mutex;
+      // the clock hand, the entry inserted last precedes it
+      entry* hand{ nullptr };
+      std::atomic<size_type> count{ 0 };
+      std::atomic<size_type> cost{ 0 };
+    };
+
+    shard& shard_of(const key_type& key) noexcept
+    {
+      return m_shards[detail::mix_hash(Hash{}(key)) & m_shard_mask];
+    }
+
+    size_type sum(std::atomic<size_type> shard::*member) const noexcept
+    {
+      size_type result = 0;
+      for (size_type i = 0; i <= m_shard_mask; ++i)
+      {
+        result += (m_shards[i].*member).load(std::memory_order_relaxed);
+      }
+      return result;
+    }
+
+    // the entry is linked once the index holds it: a throwing insertion leaves the shard unchanged
+    void insert_locked(shard& s, const key_type& key, value_pointer value, entry* old = nullptr)
+    {
+      const size_type cost = m_cost(std::as_const(*value));
+      auto e = make_retain<entry>(key, std::move(value), cost);
+      auto* const raw = e.get();
+      m_index.insert_or_assign(key, std::move(e));
+      if (old)
+      {
+        this->unlink(s, old);
+      }
+      this->link(s, raw);
+      this->evict(s);
+    }
+
+    // the new entry is linked behind the hand, it is the last one the hand visits
+    void link(shard& s, entry* e) noexcept
+    {
+      if (!s.hand)
+      {
+        e->prev = e;
+        e->next = e;
+        s.hand = e;
+      }
+      else
+      {
+        e->next = s.hand;
+        e->prev = s.hand->prev;
+        s.hand->prev->next = e;
+        s.hand->prev = e;
+      }
+      s.count.store(s.count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+      s.cost.store(s.cost.load(std::memory_order_relaxed) + e->cost, std::memory_order_relaxed);
+    }
+
+    void unlink(shard& s, entry* e) noexcept
+    {
+      if (e->next == e)
+      {
+        s.hand = nullptr;
+      }
+      else
+      {
+        e->prev->next = e->next;
+        e->next->prev = e->prev;
+        if (s.hand == e)
+        {
+          s.hand = e->next;
+        }
+      }
+      e->prev = nullptr;
+      e->next = nullptr;
+      s.count.store(s.count.load(std::memory_order_relaxed) - 1, std::memory_order_relaxed);
+      s.cost.store(s.cost.load(std::memory_order_relaxed) - e->cost, std::memory_order_relaxed);
+    }
+
+    // two sweeps of the hand at most: the first one may only clear the reference bits
+    void evict(shard& s)
+    {
+      auto steps = 2 * s.count.load(std::memory_order_relaxed);
+      while (s.cost.load(std::memory_order_relaxed) > m_shard_capacity && s.hand && steps-- != 0)
+      {
+        auto* e = s.hand;
+        s.hand = e->next;
+        if (e->referenced.load(std::memory_order_relaxed))
+        {
+          e->referenced.store(false, std::memory_order_relaxed);
+        }
+        else if (e->value.use_count() == 1)
+        {
+          this->unlink(s, e);
+          m_index.erase(e->key);
+        }
+      }
+    }
+
+    const size_type m_shard_mask;
+    const size_type m_shard_capacity;
+    const std::unique_ptr<shard[]> m_shards;
+    concurrent_map<K, entry, Hash, KeyEqual> m_index;
+    Cost m_cost;
+  };
+} // end of namespace stdx
+
+#endif
@@ -0,0 +1,550 @@
+#ifndef STDX_CONCURRENT_MAP_H
+#define STDX_CONCURRENT_MAP_H
+
+#include "epoch.h"
+#include "memory.h"
+#include "utils.h"
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+namespace stdx
+{
+  /**
+   * \brief concurrent_map is a sharded concurrent hash map whose values are retained objects
+   *        (retain_ptr<V, Traits>).
+   *
+   *        The lookups are lock-free: a reader pins the epoch_domain, walks the chain of the bucket
+   *        and reads the value slot. Every node owns a reference of its value; a replaced or erased
+   *        value is retired to the epoch_domain, hence the reader may either use the value in place
+   *        (visit, borrow) or retain it (find) without any further synchronization.
+   *        The writers lock the shard of the key only. A shard doubles its buckets when its load factor
+   *        exceeds one; the buckets are rebuilt with new nodes while the readers keep walking the old ones.
+   *
+   *        A pointer keyed map (K = retain_ptr<U>) hashes the keys by the std::hash<stdx::retain_ptr>
+   *        specialization, i.e. by the address of the object. The hashes are mixed before they
+   *        select the shard and the bucket, the aligned addresses spread over all shards.
+   * \tparam K the key type
+   * \tparam V the type of the retained values
+   * \tparam Hash the hash function of the key type
+   * \tparam KeyEqual the equality predicate of the key type
+   * \tparam Traits the traits suitable for type V
+   * \note the reclamation of the nodes and of the released values is deferred by the epoch_domain
+   */
+  template<typename K, typename V,
+    typename Hash = std::hash<K>,
+    typename KeyEqual = std::equal_to<K>,
+    typename Traits = retain_traits<V>>
+  class concurrent_map
+  {
+  public:
+    using key_type = K;
+    using value_type = V;
+    using value_pointer = retain_ptr<V, Traits>;
+    using hasher = Hash;
+    using key_equal = KeyEqual;
+    using size_type = std::size_t;
+
+    class borrowed_ptr;
+
+    /// @name Construction
+    /// @{
+
+    /**
+     * \brief Constructs an empty map
+     * \param shard_count the number of independently locked shards (rounded up to a power of two)
+     */
+    explicit concurrent_map(size_type shard_count = 64)
+      : m_shard_mask(detail::round_up_to_power_of_two(shard_count) - 1)
+      , m_shard_shift(shift_of(m_shard_mask + 1))
+      , m_shards(std::make_unique<shard[]>(m_shard_mask + 1))
+    {
+    }
+
+    concurrent_map(const concurrent_map&) = delete;
+    concurrent_map(concurrent_map&&) = delete;
+    concurrent_map& operator=(const concurrent_map&) = delete;
+    concurrent_map& operator=(concurrent_map&&) = delete;
+
+    /**
+     * \brief destructor; requires no concurrent access to the map
+     */
+    ~concurrent_map()
+    {
+      for (size_type i = 0; i <= m_shard_mask; ++i)
+      {
+        auto* b = m_shards[i].buckets.load(std::memory_order_relaxed);
+        for (size_type j = 0; j <= b->mask; ++j)
+        {
+          auto* n = b->heads[j].load(std::memory_order_relaxed);
+          while (n)
+          {
+            auto* next = n->next.load(std::memory_order_relaxed);
+            delete_node(n);
+            n = next;
+          }
+        }
+        delete b;
+      }
+    }
+
+    /// @}
+
+    /// @name Writers
+    /// @{
+
+    /**
+     * \brief inserts the value if the key is not present
+     * \param key the key of the value
+     * \param value the value; requires value != nullptr
+     * \return true if the value has been inserted
+     */
+    bool insert(const key_type& key, value_pointer value)
+    {
+      const auto h = detail::mix_hash(hasher{}(key));
+      auto& s = this->shard_of(h);
+      const auto g = epoch_domain::instance().pin();
+      std::lock_guard lk(s.mutex);
+      if (find_node(s.buckets.load(std::memory_order_relaxed), h, key))
+      {
+        return false;
+      }
+      this->insert_locked(s, h, key, std::move(value));
+      return true;
+    }
+
+    /**
+     * \brief inserts the value or replaces the value of the key
+     * \param key the key of the value
+     * \param value the value; requires value != nullptr
+     * \return true if the value has been inserted, false if it has been replaced
+     */
+    bool insert_or_assign(const key_type& key, value_pointer value)
+    {
+      const auto h = detail::mix_hash(hasher{}(key));
+      auto& s = this->shard_of(h);
+      auto& domain = epoch_domain::instance();
+      const auto g = domain.pin();
+      std::lock_guard lk(s.mutex);
+      if (auto* n = find_node(s.buckets.load(std::memory_order_relaxed), h, key); n)
+      {
+        auto* old = n->value.exchange(value.release(), std::memory_order_acq_rel);
+        domain.retire(value_pointer(old, adopt_object));
+        return false;
+      }
+      this->insert_locked(s, h, key, std::move(value));
+      return true;
+    }
+
+    /**
+     * \brief removes the key
+     * \param key the key to remove
+     * \return true if the key has been removed
+     */
+    bool erase(const key_type& key)
+    {
+      const auto h = detail::mix_hash(hasher{}(key));
+      auto& s = this->shard_of(h);
+      const auto g = epoch_domain::instance().pin();
+      std::lock_guard lk(s.mutex);
+      auto& head = bucket_of(s.buckets.load(std::memory_order_relaxed), h);
+      auto* prev = &head;
+      for (auto* n = head.load(std::memory_order_relaxed); n; n = n->next.load(std::memory_order_relaxed))
+      {
+        if (n->hash == h && key_equal{}(n->key, key))
+        {
+          // the readers walking through the node continue with its successor
+          prev->store(n->next.load(std::memory_order_relaxed), std::memory_order_release);
+          s.size.fetch_sub(1, std::memory_order_relaxed);
+          epoch_domain::instance().retire(n, &reclaim_node);
+          return true;
+        }
+        prev = &n->next;
+      }
+      return false;
+    }
+
+    /**
+     * \brief removes all keys
+     */
+    void clear()
+    {
+      auto& domain = epoch_domain::instance();
+      const auto g = domain.pin();
+      for (size_type i = 0; i <= m_shard_mask; ++i)
+      {
+        auto& s = m_shards[i];
+        std::lock_guard lk(s.mutex);
+        auto* b = s.buckets.load(std::memory_order_relaxed);
+        for (size_type j = 0; j <= b->mask; ++j)
+        {
+          auto* n = b->heads[j].exchange(nullptr, std::memory_order_acq_rel);
+          while (n)
+          {
+            auto* next = n->next.load(std::memory_order_relaxed);
+            domain.retire(n, &reclaim_node);
+            n = next;
+          }
+        }
+        s.size.store(0, std::memory_order_relaxed);
+      }
+    }
+
+    /// @}
+
+    /// @name Readers
+    /// @{
+
+    /**
+     * \brief returns the value of the key
+     * \param key the key to look up
+     * \return the retained value or nullptr if the key is not present
+     */
+    [[nodiscard]]
+    value_pointer find(const key_type& key) const
+    {
+      const auto g = epoch_domain::instance().pin();
+      // the slot owns a reference which is released after the guard at the earliest
+      return value_pointer(this->lookup(key), retain_object);
+    }
+
+    /**
+     * \brief returns the borrowed value of the key
+     * \param key the key to look up
+     * \return the borrowed value (null if the key is not present), which pins the epoch_domain;
+     *         the reference count of the value is not touched
+     */
+    [[nodiscard]]
+    borrowed_ptr borrow(const key_type& key) const
+    {
+      auto g = epoch_domain::instance().pin();
+      auto* ptr = this->lookup(key);
+      return borrowed_ptr(std::move(g), ptr);
+    }
+
+    /**
+     * \brief invokes f with the value of the key, if present
+     * \param key the key to look up
+     * \param f the function invoked with (value_type&); the reference is valid during the call only
+     * \return true if the key is present and f has been invoked
+     * \note does not touch the reference count of the value
+     */
+    template<typename F>
+    bool visit(const key_type& key, F&& f) const
+    {
+      const auto g = epoch_domain::instance().pin();
+      if (auto* ptr = this->lookup(key); ptr)
+      {
+        std::forward<F>(f)(*ptr);
+        return true;
+      }
+      return false;
+    }
+
+    /**
+     * \brief checks whether the key is present
+     */
+    [[nodiscard]]
+    bool contains(const key_type& key) const
+    {
+      const auto g = epoch_domain::instance().pin();
+      return this->lookup(key) != nullptr;
+    }
+
+    /**
+     * \brief invokes f(key, value) for every key of the map
+     * \param f the function invoked with (const key_type&, value_type&)
+     * \note the traversal is weakly consistent: the concurrent writes may or may not be observed
+     */
+    template<typename F>
+    void for_each(F f) const
+    {
+      const auto g = epoch_domain::instance().pin();
+      for (size_type i = 0; i <= m_shard_mask; ++i)
+      {
+        const auto* b = m_shards[i].buckets.load(std::memory_order_acquire);
+        for (size_type j = 0; j <= b->mask; ++j)
+        {
+          for (auto* n = b->heads[j].load(std::memory_order_acquire); n; n = n->next.load(std::memory_order_acquire))
+          {
+            f(static_cast<const key_type&>(n->key), *n->value.load(std::memory_order_acquire));
+          }
+        }
+      }
+    }
+
+    /**
+     * \brief returns the approximate number of keys
+     */
+    [[nodiscard]]
+    size_type size() const noexcept
+    {
+      size_type result = 0;
+      for (size_type i = 0; i <= m_shard_mask; ++i)
+      {
+        result += m_shards[i].size.load(std::memory_order_relaxed);
+      }
+      return result;
+    }
+
+    [[nodiscard]]
+    bool empty() const noexcept
+    {
+      return this->size() == 0;
+    }
+
+    /**
+     * \brief returns the number of shards
+     */
+    [[nodiscard]]
+    size_type shard_count() const noexcept
+    {
+      return m_shard_mask + 1;
+    }
+
+    /**
+     * \brief returns the approximate number of keys of the shard i; requires i < shard_count()
+     */
+    [[nodiscard]]
+    size_type shard_size(size_type i) const noexcept
+    {
+      return m_shards[i].size.load(std::memory_order_relaxed);
+    }
+
+    /// @}
+
+  private:
+    using pointer = typename value_pointer::pointer;
+
+    static constexpr size_type initial_bucket_count = 8;
+
+    struct node
+    {
+      node(std::size_t h, const key_type& k, pointer v, node* n)
+        : hash(h)
+        , key(k)
+        , value(v)
+        , next(n)
+      {
+      }
+
+      const std::size_t hash;
+      const key_type key;
+      // owns a reference of the value
+      std::atomic<pointer> value;
+      std::atomic<node*> next;
+    };
+
+    struct bucket_array
+    {
+      explicit bucket_array(size_type count)
+        : mask(count - 1)
+        , heads(std::make_unique<std::atomic<node*>[]>(count))
+      {
+      }
+
+      const size_type mask;
+      const std::unique_ptr<std::atomic<node*>[]> heads;
+    };
+
+    struct alignas(cache_line_size) shard
+    {
+      shard()
+        : buckets(new bucket_array(initial_bucket_count))
+      {
+      }
+
+      std::atomic<bucket_array*> buckets;
+      std::atomic<size_type> size{ 0 };
+      std::mutex mutex;
+    };
+
+    static constexpr unsigned shift_of(size_type count) noexcept
+    {
+      unsigned shift = 0;
+      while ((size_type{ 1 } << shift) < count)
+      {
+        ++shift;
+      }
+      return shift;
+    }
+
+    static void delete_node(node* n) noexcept
+    {
+      Traits::decrement(n->value.load(std::memory_order_relaxed));
+      delete n;
+    }
+
+    // reclaims an erased node and releases its value
+    static void reclaim_node(void* ptr) noexcept
+    {
+      delete_node(static_cast<node*>(ptr));
+    }
+
+    // reclaims a node superseded by a rehash, its value is owned by the new node
+    static void reclaim_moved_node(void* ptr) noexcept
+    {
+      delete static_cast<node*>(ptr);
+    }
+
+    static void reclaim_bucket_array(void* ptr) noexcept
+    {
+      delete static_cast<bucket_array*>(ptr);
+    }
+
+    shard& shard_of(std::size_t h) const noexcept
+    {
+      return m_shards[h & m_shard_mask];
+    }
+
+    std::atomic<node*>& bucket_of(const bucket_array* b, std::size_t h) const noexcept
+    {
+      return b->heads[(h >> m_shard_shift) & b->mask];
+    }
+
+    node* find_node(const bucket_array* b, std::size_t h, const key_type& key) const
+    {
+      for (auto* n = this->bucket_of(b, h).load(std::memory_order_acquire); n; n = n->next.load(std::memory_order_acquire))
+      {
+        if (n->hash == h && key_equal{}(n->key, key))
+        {
+          return n;
+        }
+      }
+      return nullptr;
+    }
+
+    // requires a pinned epoch_domain
+    pointer lookup(const key_type& key) const
+    {
+      const auto h = detail::mix_hash(hasher{}(key));
+      const auto* b = this->shard_of(h).buckets.load(std::memory_order_acquire);
+      const auto* n = this->find_node(b, h, key);
+      return n ? n->value.load(std::memory_order_acquire) : nullptr;
+    }
+
+    void insert_locked(shard& s, std::size_t h, const key_type& key, value_pointer value)
+    {
+      auto* b = s.buckets.load(std::memory_order_relaxed);
+      auto& head = this->bucket_of(b, h);
+      head.store(new node(h, key, value.get(), head.load(std::memory_order_relaxed)), std::memory_order_release);
+      static_cast<void>(value.release());
+      if (s.size.fetch_add(1, std::memory_order_relaxed) + 1 > b->mask + 1)
+      {
+        this->rehash_locked(s, b);
+      }
+    }
+
+    // rebuilds the chains with new nodes; the readers walking the old chains are not disturbed.
+    // A throwing rebuild keeps the old chains: the insertion has already succeeded.
+    void rehash_locked(shard& s, bucket_array* b)
+    {
+      auto& domain = epoch_domain::instance();
+      std::unique_ptr<bucket_array> bigger;
+      try
+      {
+        bigger = std::make_unique<bucket_array>((b->mask + 1) * 2);
+        for (size_type j = 0; j <= b->mask; ++j)
+        {
+          for (auto* n = b->heads[j].load(std::memory_order_relaxed); n; n = n->next.load(std::memory_order_relaxed))
+          {
+            auto& head = this->bucket_of(bigger.get(), n->hash);
+            head.store(new node(n->hash, n->key, n->value.load(std::memory_order_relaxed), head.load(std::memory_order_relaxed)),
+              std::memory_order_relaxed);
+          }
+        }
+      }
+      catch (...)
+      {
+        for (size_type j = 0; bigger && j <= bigger->mask; ++j)
+        {
+          auto* n = bigger->heads[j].load(std::memory_order_relaxed);
+          while (n)
+          {
+            auto* next = n->next.load(std::memory_order_relaxed);
+            delete n;
+            n = next;
+          }
+        }
+        return;
+      }
+      s.buckets.store(bigger.release(), std::memory_order_release);
+
+      for (size_type j = 0; j <= b->mask; ++j)
+      {
+        auto* n = b->heads[j].load(std::memory_order_relaxed);
+        while (n)
+        {
+          auto* next = n->next.load(std::memory_order_relaxed);
+          domain.retire(n, &reclaim_moved_node);
+          n = next;
+        }
+      }
+      domain.retire(b, &reclaim_bucket_array);
+    }
+
+    const size_type m_shard_mask;
+    const unsigned m_shard_shift;
+    const std::unique_ptr<shard[]> m_shards;
+  };
+
+  /**
+   * \brief the borrowed value of a concurrent_map; pins the epoch_domain while it is alive
+   * \note must not outlive the thread which has created it
+   */
+  template<typename K, typename V, typename Hash, typename KeyEqual, typename Traits>
+  class concurrent_map<K, V, Hash, KeyEqual, Traits>::borrowed_ptr
+  {
+  public:
+    borrowed_ptr(borrowed_ptr&&) noexcept = default;
+    borrowed_ptr& operator=(borrowed_ptr&&) noexcept = default;
+
+    [[nodiscard]]
+    value_type* get() const noexcept
+    {
+      return m_ptr;
+    }
+
+    value_type& operator*() const noexcept
+    {
+      return *m_ptr;
+    }
+
+    value_type* operator->() const noexcept
+    {
+      return m_ptr;
+    }
+
+    explicit operator bool() const noexcept
+    {
+      return m_ptr != nullptr;
+    }
+
+    /**
+     * \brief retains the borrowed value
+     */
+    [[nodiscard]]
+    value_pointer retain() const
+    {
+      return value_pointer(m_ptr, retain_object);
+    }
+
+  private:
+    friend class concurrent_map;
+
+    borrowed_ptr(epoch_domain::guard g, value_type* ptr) noexcept
+      : m_guard(std::move(g))
+      , m_ptr(ptr)
+    {
+    }
+
+    epoch_domain::guard m_guard;
+    value_type* m_ptr;
+  };
+} // end of namespace stdx
+
+#endif
@@ -0,0 +1,657 @@
+#ifndef STDX_CONCURRENT_SKIPLIST_H
+#define STDX_CONCURRENT_SKIPLIST_H
+
+#include "epoch.h"
+#include "memory.h"
+#include "utils.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <new>
+#include <thread>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace stdx
+{
+  /**
+   * \brief concurrent_skiplist is a concurrent ordered map (the lazy skiplist of Herlihy, Lev,
+   *        Luchangco and Shavit) whose nodes are retained objects.
+   *
+   *        The lookups, lower_bound and the range scans are lock-free; insert and erase lock
+   *        the affected nodes only. Every link of the list owns a reference of the node it points to;
+   *        unlinking a node retires the reference of the link to the epoch_domain, hence a reader
+   *        may retain any node it reaches. An iterator holds a retain_ptr of its node: it stays valid
+   *        (and keeps advancing in key order) when the node is erased concurrently.
+   * \tparam K the key type
+   * \tparam V the mapped type; the mapped value of a node is immutable
+   * \tparam Compare the ordering of the keys
+   * \note an erased node keeps its successors alive as long as it is retained by an iterator
+   */
+  template<typename K, typename V, typename Compare = std::less<K>>
+  class concurrent_skiplist
+  {
+    struct node;
+
+  public:
+    using key_type = K;
+    using mapped_type = V;
+    using value_type = std::pair<const K, V>;
+    using key_compare = Compare;
+    using size_type = std::size_t;
+
+    class const_iterator;
+    using iterator = const_iterator;
+
+    static constexpr int max_height = 32;
+
+    /// @name Construction
+    /// @{
+
+    concurrent_skiplist() = default;
+
+    explicit concurrent_skiplist(const Compare& comp)
+      : m_comp(comp)
+    {
+    }
+
+    concurrent_skiplist(const concurrent_skiplist&) = delete;
+    concurrent_skiplist(concurrent_skiplist&&) = delete;
+    concurrent_skiplist& operator=(const concurrent_skiplist&) = delete;
+    concurrent_skiplist& operator=(concurrent_skiplist&&) = delete;
+
+    /**
+     * \brief destructor; requires no concurrent access to the list
+     * \note the outstanding iterators keep their nodes, but do not advance any more
+     */
+    ~concurrent_skiplist()
+    {
+      // cut all links first, hence the release of the nodes does not cascade
+      std::vector<node*> targets;
+      node_base* n = &m_head;
+      while (n)
+      {
+        auto* next = n->next[0].load(std::memory_order_relaxed);
+        for (int level = 0; level < n->height; ++level)
+        {
+          if (auto* target = n->next[level].exchange(nullptr, std::memory_order_relaxed); target)
+          {
+            targets.push_back(target);
+          }
+        }
+        n = next;
+      }
+
+      for (auto* target : targets)
+      {
+        release(target);
+      }
+    }
+
+    /// @}
+
+    /// @name Modifiers
+    /// @{
+
+    /**
+     * \brief inserts the key and the mapped value if the key is not present
+     * \return true if the key has been inserted
+     */
+    template<typename... Args>
+    bool emplace(const key_type& key, Args&&... args)
+    {
+      const auto g = epoch_domain::instance().pin();
+      const auto height = random_height();
+      node_base* preds[max_height];
+      node* succs[max_height];
+      // the node is constructed before any predecessor is locked, a throwing allocation or
+      // constructor leaves the list unlocked; it is reused by the retries
+      node* n = nullptr;
+      for (;;)
+      {
+        if (const auto found = this->find(key, preds, succs); found != -1)
+        {
+          const auto* existing = succs[found];
+          if (!existing->marked.load(std::memory_order_acquire))
+          {
+            // a concurrent insertion of the key is linearized once the node is fully linked
+            while (!existing->fully_linked.load(std::memory_order_acquire))
+            {
+              std::this_thread::yield();
+            }
+            if (n)
+            {
+              release(n);
+            }
+            return false;
+          }
+          // an erasure of the key is in progress
+          std::this_thread::yield();
+          continue;
+        }
+
+        if (!n)
+        {
+          n = node::create(height, key, std::forward<Args>(args)...);
+        }
+
+        int highest_locked = -1;
+        bool valid = true;
+        for (int level = 0; valid && level < height; ++level)
+        {
+          if (level == 0 || preds[level] != preds[level - 1])
+          {
+            preds[level]->lock();
+          }
+          highest_locked = level;
+          valid = !preds[level]->marked.load(std::memory_order_relaxed)
+            && preds[level]->next[level].load(std::memory_order_relaxed) == succs[level];
+        }
+
+        if (valid)
+        {
+          // the new node takes over the references of the predecessors to the successors,
+          // each predecessor link owns a new reference of the node (the initial one included)
+          for (int level = 0; level < height; ++level)
+          {
+            n->next[level].store(succs[level], std::memory_order_relaxed);
+          }
+          for (int level = 1; level < height; ++level)
+          {
+            retain(n);
+          }
+          for (int level = 0; level < height; ++level)
+          {
+            preds[level]->next[level].store(n, std::memory_order_release);
+          }
+          n->fully_linked.store(true, std::memory_order_release);
+          m_size.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        unlock(preds, highest_locked);
+        if (valid)
+        {
+          return true;
+        }
+      }
+    }
+
+    /**
+     * \brief inserts the value if its key is not present
+     * \return true if the value has been inserted
+     */
+    bool insert(const value_type& value)
+    {
+      return this->emplace(value.first, value.second);
+    }
+
+    /**
+     * \brief removes the key
+     * \return true if the key has been removed
+     */
+    bool erase(const key_type& key)
+    {
+      auto& domain = epoch_domain::instance();
+      const auto g = domain.pin();
+      node_base* preds[max_height];
+      node* succs[max_height];
+      node* victim = nullptr;
+      for (;;)
+      {
+        const auto found = this->find(key, preds, succs);
+        if (!victim)
+        {
+          if (found == -1)
+          {
+            return false;
+          }
+
+          auto* n = succs[found];
+          if (!n->fully_linked.load(std::memory_order_acquire) || n->height - 1 != found
+            || n->marked.load(std::memory_order_acquire))
+          {
+            // not linearized yet, or being erased by another thread
+            return false;
+          }
+
+          n->lock();
+          if (n->marked.load(std::memory_order_relaxed))
+          {
+            n->unlock();
+            return false;
+          }
+          n->marked.store(true, std::memory_order_release);
+          victim = n;
+        }
+
+        int highest_locked = -1;
+        bool valid = true;
+        for (int level = 0; valid && level < victim->height; ++level)
+        {
+          if (level == 0 || preds[level] != preds[level - 1])
+          {
+            preds[level]->lock();
+          }
+          highest_locked = level;
+          valid = !preds[level]->marked.load(std::memory_order_relaxed)
+            && preds[level]->next[level].load(std::memory_order_relaxed) == victim;
+        }
+
+        if (valid)
+        {
+          for (int level = victim->height - 1; level >= 0; --level)
+          {
+            // the predecessor takes a new reference of the successor, the victim keeps its own;
+            // the reference of the predecessor to the victim is released after the readers
+            auto* succ = victim->next[level].load(std::memory_order_relaxed);
+            if (succ)
+            {
+              retain(succ);
+            }
+            preds[level]->next[level].store(succ, std::memory_order_release);
+            domain.retire(victim, &reclaim_link);
+          }
+          m_size.fetch_sub(1, std::memory_order_relaxed);
+        }
+
+        unlock(preds, highest_locked);
+        if (valid)
+        {
+          victim->unlock();
+          return true;
+        }
+      }
+    }
+
+    /// @}
+
+    /// @name Lookup
+    /// @{
+
+    /**
+     * \brief returns the iterator to the key, or end() if the key is not present
+     */
+    [[nodiscard]]
+    const_iterator find(const key_type& key) const
+    {
+      auto it = this->lower_bound(key);
+      return it != this->end() && !m_comp(key, it->first) ? it : this->end();
+    }
+
+    /**
+     * \brief checks whether the key is present
+     */
+    [[nodiscard]]
+    bool contains(const key_type& key) const
+    {
+      const auto g = epoch_domain::instance().pin();
+      const auto* n = this->first_not_less(key);
+      return n && !m_comp(key, n->value.first);
+    }
+
+    /**
+     * \brief returns the iterator to the first key not less than the key
+     */
+    [[nodiscard]]
+    const_iterator lower_bound(const key_type& key) const
+    {
+      const auto g = epoch_domain::instance().pin();
+      return const_iterator(this->first_not_less(key));
+    }
+
+    /**
+     * \brief returns the iterator to the first key greater than the key
+     */
+    [[nodiscard]]
+    const_iterator upper_bound(const key_type& key) const
+    {
+      const auto g = epoch_domain::instance().pin();
+      auto* n = this->first_not_less(key);
+      if (n && !m_comp(key, n->value.first))
+      {
+        n = next_live(n);
+      }
+      return const_iterator(n);
+    }
+
+    /**
+     * \brief invokes f(value) for the keys in the range [first, last) in key order
+     * \param f the function invoked with const value_type&; the reference is valid during the call only
+     * \return the number of visited keys
+     * \note does not touch the reference counts of the nodes; the scan is weakly consistent
+     */
+    template<typename F>
+    size_type for_each_in_range(const key_type& first, const key_type& last, F f) const
+    {
+      const auto g = epoch_domain::instance().pin();
+      size_type count = 0;
+      for (auto* n = this->first_not_less(first); n && m_comp(n->value.first, last); n = next_live(n))
+      {
+        f(static_cast<const value_type&>(n->value));
+        ++count;
+      }
+      return count;
+    }
+
+    /// @}
+
+    /// @name Iterators
+    /// @{
+
+    [[nodiscard]]
+    const_iterator begin() const
+    {
+      const auto g = epoch_domain::instance().pin();
+      return const_iterator(next_live(&m_head));
+    }
+
+    [[nodiscard]]
+    const_iterator end() const noexcept
+    {
+      return const_iterator();
+    }
+
+    /// @}
+
+    /**
+     * \brief returns the approximate number of keys
+     */
+    [[nodiscard]]
+    size_type size() const noexcept
+    {
+      return m_size.load(std::memory_order_relaxed);
+    }
+
+    [[nodiscard]]
+    bool empty() const noexcept
+    {
+      return this->size() == 0;
+    }
+
+  private:
+    struct node_base
+    {
+      node_base(int h, std::atomic<node*>* links) noexcept
+        : next(links)
+        , height(h)
+      {
+      }
+
+      void lock() noexcept
+      {
+        while (m_lock.test_and_set(std::memory_order_acquire))
+        {
+          std::this_thread::yield();
+        }
+      }
+
+      void unlock() noexcept
+      {
+        m_lock.clear(std::memory_order_release);
+      }
+
+      // every non-null link owns a reference of the node it points to
+      std::atomic<node*>* const next;
+      const int height;
+      std::atomic<bool> marked{ false };
+      std::atomic<bool> fully_linked{ false };
+
+    private:
+      std::atomic_flag m_lock = ATOMIC_FLAG_INIT;
+    };
+
+    // the links of a node are allocated behind the node
+    struct node final
+      : node_base
+      , atomic_reference_count<node>
+    {
+      template<typename... Args>
+      static node* create(int height, const key_type& key, Args&&... args)
+      {
+        auto* mem = ::operator new(sizeof(node) + static_cast<std::size_t>(height) * sizeof(std::atomic<node*>));
+        auto* links = reinterpret_cast<std::atomic<node*>*>(static_cast<unsigned char*>(mem) + sizeof(node));
+        for (int level = 0; level < height; ++level)
+        {
+          ::new (static_cast<void*>(links + level)) std::atomic<node*>(nullptr);
+        }
+        try
+        {
+          return ::new (mem) node(height, links, key, std::forward<Args>(args)...);
+        }
+        catch (...)
+        {
+          ::operator delete(mem);
+          throw;
+        }
+      }
+
+      node(const node&) = delete;
+      node& operator=(const node&) = delete;
+
+      // the links of an unlinked node are released iteratively: destroying a chain of erased
+      // nodes, kept alive by an iterator, does not take one stack frame per node
+      ~node()
+      {
+        thread_local std::vector<node*> pending;
+        thread_local bool releasing = false;
+        for (int level = 0; level < this->height; ++level)
+        {
+          if (auto* n = this->next[level].load(std::memory_order_relaxed); n)
+          {
+            pending.push_back(n);
+          }
+        }
+        if (releasing)
+        {
+          return;
+        }
+        releasing = true;
+        while (!pending.empty())
+        {
+          auto* n = pending.back();
+          pending.pop_back();
+          release(n);
+        }
+        releasing = false;
+      }
+
+      static void operator delete(void* ptr) noexcept
+      {
+        ::operator delete(ptr);
+      }
+
+      value_type value;
+
+    private:
+      template<typename... Args>
+      node(int height, std::atomic<node*>* links, const key_type& key, Args&&... args)
+        : node_base(height, links)
+        , value(std::piecewise_construct, std::forward_as_tuple(key), std::forward_as_tuple(std::forward<Args>(args)...))
+      {
+      }
+    };
+
+    struct head_node : node_base
+    {
+      head_node() noexcept
+        : node_base(max_height, links)
+      {
+      }
+
+      std::atomic<node*> links[max_height] = {};
+    };
+
+    using traits_type = retain_traits<node>;
+
+    static void retain(node* n) noexcept
+    {
+      traits_type::increment(n);
+    }
+
+    static void release(node* n) noexcept
+    {
+      traits_type::decrement(n);
+    }
+
+    // releases the reference of an unlinked link
+    static void reclaim_link(void* ptr) noexcept
+    {
+      release(static_cast<node*>(ptr));
+    }
+
+    static int random_height() noexcept
+    {
+      thread_local auto state = static_cast<std::uint64_t>(std::hash<std::thread::id>{}(std::this_thread::get_id())) | 1U;
+      state ^= state << 13U;
+      state ^= state >> 7U;
+      state ^= state << 17U;
+      // geometric distribution, p = 1/2
+      auto bits = state;
+      int height = 1;
+      while ((bits & 1U) != 0 && height < max_height)
+      {
+        ++height;
+        bits >>= 1U;
+      }
+      return height;
+    }
+
+    static void unlock(node_base* const* preds, int highest_locked) noexcept
+    {
+      for (int level = 0; level <= highest_locked; ++level)
+      {
+        if (level == 0 || preds[level] != preds[level - 1])
+        {
+          preds[level]->unlock();
+        }
+      }
+    }
+
+    static bool live(const node* n) noexcept
+    {
+      return n->fully_linked.load(std::memory_order_acquire) && !n->marked.load(std::memory_order_acquire);
+    }
+
+    // requires a pinned epoch_domain
+    static node* next_live(const node_base* n) noexcept
+    {
+      auto* next = n->next[0].load(std::memory_order_acquire);
+      while (next && !live(next))
+      {
+        next = next->next[0].load(std::memory_order_acquire);
+      }
+      return next;
+    }
+
+    // requires a pinned epoch_domain; returns the highest level the key has been found at, or -1
+    int find(const key_type& key, node_base** preds, node** succs) const
+    {
+      int found = -1;
+      node_base* pred = const_cast<head_node*>(&m_head);
+      for (int level = max_height - 1; level >= 0; --level)
+      {
+        auto* curr = pred->next[level].load(std::memory_order_acquire);
+        while (curr && m_comp(curr->value.first, key))
+        {
+          pred = curr;
+          curr = pred->next[level].load(std::memory_order_acquire);
+        }
+        if (found == -1 && curr && !m_comp(key, curr->value.first))
+        {
+          found = level;
+        }
+        preds[level] = pred;
+        succs[level] = curr;
+      }
+      return found;
+    }
+
+    // requires a pinned epoch_domain
+    node* first_not_less(const key_type& key) const
+    {
+      const node_base* pred = &m_head;
+      node* curr = nullptr;
+      for (int level = max_height - 1; level >= 0; --level)
+      {
+        curr = pred->next[level].load(std::memory_order_acquire);
+        while (curr && m_comp(curr->value.first, key))
+        {
+          pred = curr;
+          curr = pred->next[level].load(std::memory_order_acquire);
+        }
+      }
+      return curr && !live(curr) ? next_live(curr) : curr;
+    }
+
+    head_node m_head;
+    Compare m_comp{};
+    alignas(cache_line_size) std::atomic<size_type> m_size{ 0 };
+  };
+
+  /**
+   * \brief the iterator of concurrent_skiplist; retains its node
+   */
+  template<typename K, typename V, typename Compare>
+  class concurrent_skiplist<K, V, Compare>::const_iterator
+  {
+  public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = typename concurrent_skiplist::value_type;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const value_type*;
+    using reference = const value_type&;
+
+    const_iterator() noexcept = default;
+
+    reference operator*() const noexcept
+    {
+      return m_node->value;
+    }
+
+    pointer operator->() const noexcept
+    {
+      return &m_node->value;
+    }
+
+    const_iterator& operator++()
+    {
+      const auto g = epoch_domain::instance().pin();
+      m_node = retain_ptr<node>(next_live(m_node.get()), retain_object);
+      return *this;
+    }
+
+    const_iterator operator++(int)
+    {
+      auto result = *this;
+      ++*this;
+      return result;
+    }
+
+    friend bool operator==(const const_iterator& lhs, const const_iterator& rhs) noexcept
+    {
+      return lhs.m_node == rhs.m_node;
+    }
+
+    friend bool operator!=(const const_iterator& lhs, const const_iterator& rhs) noexcept
+    {
+      return !(lhs == rhs);
+    }
+
+  private:
+    friend class concurrent_skiplist;
+
+    // requires a pinned epoch_domain
+    explicit const_iterator(node* n) noexcept
+      : m_node(n, retain_object)
+    {
+    }
+
+    retain_ptr<node> m_node;
+  };
+} // end of namespace stdx
+
+#endif
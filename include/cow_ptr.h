@@ -0,0 +1,186 @@
+#ifndef STDX_COW_PTR_H
+#define STDX_COW_PTR_H
+
+#include "memory.h"
+
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+namespace stdx
+{
+  namespace detail
+  {
+    template<typename T, typename Traits>
+    [[nodiscard]]
+    bool is_unique(const retain_ptr<T, Traits>& p) noexcept
+    {
+      if constexpr (is_detected_v<has_unique, Traits, typename retain_ptr<T, Traits>::pointer>)
+      {
+        return Traits::unique(p.get());
+      }
+      else
+      {
+        return p.use_count() == 1;
+      }
+    }
+  } // end of namespace detail
+
+  /**
+   * \brief makes p the only reference to its object and returns the object for modification.
+   *        The object is replaced by a copy if other references to it exist.
+   *
+   *        The uniqueness is checked by Traits::unique when it is defined (an acquire load for
+   *        the reference count mixins): the releases of the former owners happen before the
+   *        modification. Otherwise use_count() == 1 is checked.
+   * \param p the pointer to the object; requires p != nullptr
+   * \return the object uniquely referenced by p
+   * \note the copy is created by new T(const T&) and adopted by p
+   */
+  template<typename T, typename Traits>
+  T& make_mut(retain_ptr<T, Traits>& p)
+  {
+    static_assert(!std::is_const_v<T>, "make_mut: the element type must not be const");
+    if (!detail::is_unique(p))
+    {
+      p = retain_ptr<T, Traits>(new T(std::as_const(*p)), adopt_object);
+    }
+    return *p;
+  }
+
+  /**
+   * \brief cow_ptr<T> is a copy-on-write handle to a retained object of type T.
+   *
+   *        Copies of a cow_ptr share the object; read() grants const access without any check,
+   *        write() clones the object only if it is shared. The object returned by write() stays
+   *        unique until the cow_ptr is copied: a batch of modifications takes a single reference
+   *        to it and modifies it in place without atomic operations.
+   * \tparam T the type of the object, copy constructible
+   * \tparam Traits the traits suitable for type T
+   * \note a cow_ptr provides the same level of thread-safety as a retain_ptr
+   */
+  template<typename T, typename Traits = retain_traits<T>>
+  class cow_ptr
+  {
+  public:
+    using element_type = T;
+    using pointer_type = retain_ptr<T, Traits>;
+
+    /// @name Construction
+    /// @{
+
+    cow_ptr() noexcept = default;
+
+    explicit cow_ptr(pointer_type p) noexcept
+      : m_ptr(std::move(p))
+    {
+    }
+
+    cow_ptr(const cow_ptr&) = default;
+    cow_ptr(cow_ptr&&) noexcept = default;
+    cow_ptr& operator=(const cow_ptr&) = default;
+    cow_ptr& operator=(cow_ptr&&) noexcept = default;
+
+    ~cow_ptr() = default;
+
+    /// @}
+
+    /**
+     * \brief returns the shared object for reading
+     * \note requires *this != nullptr
+     */
+    [[nodiscard]]
+    const T& read() const noexcept
+    {
+      return *m_ptr;
+    }
+
+    /**
+     * \brief returns the object for modification, copies it first if it is shared
+     * \note requires *this != nullptr
+     */
+    [[nodiscard]]
+    T& write()
+    {
+      return make_mut(m_ptr);
+    }
+
+    const T& operator*() const noexcept
+    {
+      return *m_ptr;
+    }
+
+    const T* operator->() const noexcept
+    {
+      return m_ptr.get();
+    }
+
+    /**
+     * \brief checks whether this is the only reference to the object
+     */
+    [[nodiscard]]
+    bool unique() const noexcept
+    {
+      return m_ptr && detail::is_unique(m_ptr);
+    }
+
+    /**
+     * \brief returns the retained pointer, sharing the object
+     */
+    [[nodiscard]]
+    const pointer_type& get() const noexcept
+    {
+      return m_ptr;
+    }
+
+    explicit operator bool() const noexcept
+    {
+      return static_cast<bool>(m_ptr);
+    }
+
+    void reset() noexcept
+    {
+      m_ptr.reset();
+    }
+
+    void swap(cow_ptr& other) noexcept
+    {
+      m_ptr.swap(other.m_ptr);
+    }
+
+    friend bool operator==(const cow_ptr& lhs, const cow_ptr& rhs) noexcept
+    {
+      return lhs.m_ptr == rhs.m_ptr;
+    }
+
+    friend bool operator!=(const cow_ptr& lhs, const cow_ptr& rhs) noexcept
+    {
+      return lhs.m_ptr != rhs.m_ptr;
+    }
+
+    friend bool operator==(const cow_ptr& lhs, std::nullptr_t) noexcept
+    {
+      return !lhs;
+    }
+
+    friend bool operator!=(const cow_ptr& lhs, std::nullptr_t) noexcept
+    {
+      return static_cast<bool>(lhs);
+    }
+
+  private:
+    pointer_type m_ptr;
+  };
+
+  /**
+   * \brief creates a cow_ptr to a new object of type T constructed from args
+   */
+  template<typename T, typename... Args>
+  [[nodiscard]]
+  cow_ptr<T> make_cow(Args&&... args)
+  {
+    return cow_ptr<T>(make_retain<T>(std::forward<Args>(args)...));
+  }
+} // end of namespace stdx
+
+#endif
@@ -0,0 +1,461 @@
+#ifndef STDX_CYCLE_COLLECTOR_H
+#define STDX_CYCLE_COLLECTOR_H
+
+#include "memory.h"
+#include "utils.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <utility>
+#include <vector>
+
+namespace stdx
+{
+  class cycle_collector;
+  class collectable_base;
+
+  template<typename T>
+  struct cycle_traits;
+
+  /**
+   * \brief the visitor passed to the trace function of a collectable type, invoked with each
+   *        of its cycle_ptr members
+   */
+  class cycle_visitor
+  {
+  public:
+    template<typename U>
+    void operator()(const retain_ptr<U, cycle_traits<U>>& p)
+    {
+      if (p)
+      {
+        m_children.push_back(static_cast<const collectable_base*>(p.get()));
+      }
+    }
+
+  private:
+    friend class cycle_collector;
+
+    explicit cycle_visitor(std::vector<const collectable_base*>& children) noexcept
+      : m_children(children)
+    {
+    }
+
+    std::vector<const collectable_base*>& m_children;
+  };
+
+  /**
+   * \brief the part of the collectable objects managed by the cycle_collector: the reference
+   *        count, the color of the trial deletion and the slot of the object in the candidate roots
+   */
+  class collectable_base
+  {
+    friend class cycle_collector;
+
+    template<typename>
+    friend struct cycle_traits;
+
+  protected:
+    collectable_base() noexcept = default;
+
+    // a copy is a new object, the reference count is not copied
+    collectable_base(const collectable_base&) noexcept
+    {
+    }
+
+    collectable_base& operator=(const collectable_base&) noexcept
+    {
+      return *this;
+    }
+
+    virtual ~collectable_base() = default;
+
+  private:
+    enum class color : std::uint8_t
+    {
+      black,  // in use or free
+      gray,   // possible member of a cycle
+      white,  // member of a garbage cycle
+      purple, // possible root of a cycle
+      freed   // garbage being deleted by the collector
+    };
+
+    static constexpr std::size_t not_buffered = static_cast<std::size_t>(-1);
+
+    virtual void trace_children(cycle_visitor& visitor) const = 0;
+
+    mutable std::ptrdiff_t m_count{ 1 };
+    mutable color m_color{ color::black };
+    mutable std::size_t m_root_index{ not_buffered };
+  };
+
+  /**
+   * \brief collectable is the mixin type of the objects whose reference cycles are collected by
+   *        the cycle_collector. The type T deriving from collectable<T> defines
+   *        template<typename Visitor> void trace(Visitor& v) const, which invokes v(member) for
+   *        each of its cycle_ptr members.
+   * \tparam T the type deriving from collectable (CRTP)
+   */
+  template<typename T>
+  struct collectable : collectable_base
+  {
+  protected:
+    collectable() noexcept = default;
+
+  private:
+    void trace_children(cycle_visitor& visitor) const final
+    {
+      static_cast<const T*>(this)->trace(visitor);
+    }
+  };
+
+  /**
+   * \brief cycle_collector is a synchronous cycle collector of collectable objects, performing
+   *        the trial deletion of Bacon and Rajan (2001).
+   *
+   *        A release leaving a non-zero count buffers the object as a candidate root of a garbage
+   *        cycle. A collection subtracts the internal references of the subgraphs reachable from
+   *        the candidates: the objects left with a zero count are only referenced by each other and
+   *        are deleted, the others are restored. The candidates are collected in batches, when
+   *        their number reaches the threshold or by an explicit collect(). The graph is traversed
+   *        with explicit stacks, the depth of the graph does not grow the call stack.
+   * \note the collectable objects and their references must be used by a single thread, whose
+   *       collector is cycle_collector::instance()
+   */
+  class cycle_collector
+  {
+    using color = collectable_base::color;
+
+  public:
+    using size_type = std::size_t;
+
+    static constexpr size_type default_threshold = 4096;
+
+    cycle_collector(const cycle_collector&) = delete;
+    cycle_collector(cycle_collector&&) = delete;
+    cycle_collector& operator=(const cycle_collector&) = delete;
+    cycle_collector& operator=(cycle_collector&&) = delete;
+
+    // the candidates still alive are left uncollected
+    ~cycle_collector()
+    {
+      this->collect();
+      for (const auto* root : m_roots)
+      {
+        root->m_root_index = collectable_base::not_buffered;
+      }
+    }
+
+    /**
+     * \brief returns the collector of the calling thread
+     */
+    [[nodiscard]]
+    static cycle_collector& instance()
+    {
+      thread_local cycle_collector collector;
+      return collector;
+    }
+
+    /**
+     * \brief deletes the garbage cycles reachable from the candidate roots
+     * \return the number of deleted objects
+     */
+    size_type collect()
+    {
+      if (m_collecting || m_roots.empty())
+      {
+        return 0;
+      }
+      m_collecting = true;
+      auto roots = std::exchange(m_roots, {});
+
+      // mark: the candidates released since their buffering are purple
+      for (auto& root : roots)
+      {
+        if (root->m_color == color::purple)
+        {
+          this->mark_gray(root);
+        }
+        else
+        {
+          root->m_root_index = collectable_base::not_buffered;
+          root = nullptr;
+        }
+      }
+      // scan: the gray objects still referenced from the outside are restored
+      for (const auto* root : roots)
+      {
+        if (root)
+        {
+          this->scan(root);
+        }
+      }
+      // collect: the white objects are deleted
+      for (const auto* root : roots)
+      {
+        if (root)
+        {
+          root->m_root_index = collectable_base::not_buffered;
+        }
+      }
+      for (const auto* root : roots)
+      {
+        if (root)
+        {
+          this->collect_white(root);
+        }
+      }
+      std::sort(m_garbage.begin(), m_garbage.end(), std::less<>());
+      for (const auto* n : m_garbage)
+      {
+        delete n;
+      }
+      const auto collected = m_garbage.size();
+      m_garbage.clear();
+      m_collecting = false;
+      return collected;
+    }
+
+    /**
+     * \brief returns the number of candidate roots buffered since the last collection
+     */
+    [[nodiscard]]
+    size_type candidates() const noexcept
+    {
+      return m_roots.size();
+    }
+
+    /**
+     * \brief sets the number of candidates triggering a collection, 0 disables the automatic collection
+     */
+    void set_threshold(size_type threshold) noexcept
+    {
+      m_threshold = threshold;
+    }
+
+    [[nodiscard]]
+    size_type threshold() const noexcept
+    {
+      return m_threshold;
+    }
+
+  private:
+    template<typename>
+    friend struct cycle_traits;
+
+    cycle_collector() = default;
+
+    static void increment(const collectable_base* n) noexcept
+    {
+      ++n->m_count;
+      n->m_color = color::black;
+    }
+
+    void decrement(const collectable_base* n)
+    {
+      // the destructors of the garbage release each other, the garbage may be already deleted
+      if (m_collecting && std::binary_search(m_garbage.begin(), m_garbage.end(), n, std::less<>()))
+      {
+        return;
+      }
+      if (--n->m_count == 0)
+      {
+        this->unbuffer(n);
+        delete n;
+      }
+      else if (n->m_color != color::purple)
+      {
+        n->m_color = color::purple;
+        if (n->m_root_index == collectable_base::not_buffered)
+        {
+          n->m_root_index = m_roots.size();
+          m_roots.push_back(n);
+          if (m_threshold != 0 && m_roots.size() >= m_threshold)
+          {
+            this->collect();
+          }
+        }
+      }
+    }
+
+    // a deleted candidate leaves the buffer, its slot is taken by the last candidate
+    void unbuffer(const collectable_base* n) noexcept
+    {
+      const auto i = n->m_root_index;
+      if (i == collectable_base::not_buffered)
+      {
+        return;
+      }
+      m_roots[i] = m_roots.back();
+      m_roots[i]->m_root_index = i;
+      m_roots.pop_back();
+      n->m_root_index = collectable_base::not_buffered;
+    }
+
+    template<typename F>
+    void for_each_child(const collectable_base* n, F f)
+    {
+      const auto first = m_children.size();
+      cycle_visitor visitor(m_children);
+      n->trace_children(visitor);
+      const auto last = m_children.size();
+      for (auto i = first; i < last; ++i)
+      {
+        f(m_children[i]);
+      }
+      m_children.resize(first);
+    }
+
+    // the internal references of the subgraph are subtracted
+    void mark_gray(const collectable_base* root)
+    {
+      if (root->m_color == color::gray)
+      {
+        return;
+      }
+      root->m_color = color::gray;
+      m_stack.push_back(root);
+      while (!m_stack.empty())
+      {
+        const auto* n = m_stack.back();
+        m_stack.pop_back();
+        this->for_each_child(n, [this](const collectable_base* child) {
+          --child->m_count;
+          if (child->m_color != color::gray)
+          {
+            child->m_color = color::gray;
+            m_stack.push_back(child);
+          }
+        });
+      }
+    }
+
+    void scan(const collectable_base* root)
+    {
+      m_stack.push_back(root);
+      while (!m_stack.empty())
+      {
+        const auto* n = m_stack.back();
+        m_stack.pop_back();
+        if (n->m_color != color::gray)
+        {
+          continue;
+        }
+        if (n->m_count > 0)
+        {
+          this->scan_black(n);
+        }
+        else
+        {
+          n->m_color = color::white;
+          this->for_each_child(n, [this](const collectable_base* child) { m_stack.push_back(child); });
+        }
+      }
+    }
+
+    // the internal references of the subgraph referenced from the outside are restored
+    void scan_black(const collectable_base* root)
+    {
+      std::vector<const collectable_base*> stack{ root };
+      root->m_color = color::black;
+      while (!stack.empty())
+      {
+        const auto* n = stack.back();
+        stack.pop_back();
+        this->for_each_child(n, [&stack](const collectable_base* child) {
+          ++child->m_count;
+          if (child->m_color != color::black)
+          {
+            child->m_color = color::black;
+            stack.push_back(child);
+          }
+        });
+      }
+    }
+
+    // the garbage is marked freed before its deletion: the releases between garbage objects are
+    // ignored, the references from garbage to live objects, subtracted by mark_gray, are restored
+    // as the destructors of the garbage release them
+    void collect_white(const collectable_base* root)
+    {
+      if (root->m_color != color::white)
+      {
+        return;
+      }
+      root->m_color = color::freed;
+      m_garbage.push_back(root);
+      m_stack.push_back(root);
+      while (!m_stack.empty())
+      {
+        const auto* n = m_stack.back();
+        m_stack.pop_back();
+        this->for_each_child(n, [this](const collectable_base* child) {
+          if (child->m_color == color::white)
+          {
+            child->m_color = color::freed;
+            m_garbage.push_back(child);
+            m_stack.push_back(child);
+          }
+          else if (child->m_color != color::freed)
+          {
+            ++child->m_count;
+          }
+        });
+      }
+    }
+
+    std::vector<const collectable_base*> m_roots;
+    std::vector<const collectable_base*> m_stack;
+    std::vector<const collectable_base*> m_children;
+    // the objects being deleted by the collection, sorted by address
+    std::vector<const collectable_base*> m_garbage;
+    size_type m_threshold{ default_threshold };
+    bool m_collecting{ false };
+  };
+
+  /**
+   * \brief The traits of the pointers to collectable objects: the releases are reported to the
+   *        cycle_collector of the calling thread.
+   * \tparam T the type of the object, deriving from collectable<T>; it may be incomplete where
+   *        the cycle_ptr<T> is declared, so that the types of a cycle may reference each other
+   */
+  template<typename T>
+  struct cycle_traits final
+  {
+    static void increment(const T* ptr) noexcept
+    {
+      cycle_collector::increment(ptr);
+    }
+
+    static void decrement(const T* ptr)
+    {
+      cycle_collector::instance().decrement(ptr);
+    }
+
+    [[nodiscard]]
+    static std::ptrdiff_t use_count(const T* ptr) noexcept
+    {
+      return static_cast<const collectable_base*>(ptr)->m_count;
+    }
+  };
+
+  /**
+   * \brief the retain_ptr to a collectable object
+   */
+  template<typename T>
+  using cycle_ptr = retain_ptr<T, cycle_traits<T>>;
+
+  /**
+   * \brief constructs a collectable object of type T and returns the cycle_ptr to it
+   */
+  template<typename T, typename... Args>
+  [[nodiscard]]
+  cycle_ptr<T> make_collectable(Args&&... args)
+  {
+    return cycle_ptr<T>(new T(std::forward<Args>(args)...), adopt_object);
+  }
+} // end of namespace stdx
+
+#endif
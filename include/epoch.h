@@ -0,0 +1,393 @@
+#ifndef STDX_EPOCH_H
+#define STDX_EPOCH_H
+
+#include "memory.h"
+#include "utils.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace stdx
+{
+  /**
+   * \brief epoch_domain is the process-wide epoch-based reclamation (EBR) domain used by the
+   *        lock-free readers of the concurrent containers.
+   *
+   *        A reader pins the current global epoch for the duration of a guard, an object unlinked
+   *        from a shared structure is retired instead of being released immediately. A retired
+   *        object is reclaimed once the global epoch has advanced three times past the epoch pinned
+   *        by the retiring thread, i.e. once every guard which could have observed it is gone.
+   *        Retiring a retain_ptr defers the release of its reference: a reader pinning the domain
+   *        may safely retain any object it has read from a slot owning a reference.
+   *
+   *        Every thread owns a record of the domain (the pinned epoch and the retired objects);
+   *        the objects retired by an exiting thread are handed over to the domain.
+   * \note a guard must be released by the thread which has pinned the domain
+   * \note a guard blocks the reclamation of all objects retired in the meantime,
+   *       a long lived guard increases the memory footprint
+   */
+  class epoch_domain
+  {
+  public:
+    using epoch_type = std::uint64_t;
+    using reclaim_function = void (*)(void*);
+
+    class guard;
+
+    epoch_domain(const epoch_domain&) = delete;
+    epoch_domain(epoch_domain&&) = delete;
+    epoch_domain& operator=(const epoch_domain&) = delete;
+    epoch_domain& operator=(epoch_domain&&) = delete;
+
+    /**
+     * \brief returns the process-wide domain
+     */
+    [[nodiscard]]
+    static epoch_domain& instance()
+    {
+      static epoch_domain domain;
+      return domain;
+    }
+
+    /**
+     * \brief pins the current epoch on the calling thread; the guards may be nested
+     * \return the guard unpinning the epoch on destruction
+     */
+    [[nodiscard]]
+    guard pin();
+
+    /**
+     * \brief retires the object, reclaim(ptr) is invoked once no guard may observe the object any more
+     * \param ptr the object unlinked from the shared structure
+     * \param reclaim the function reclaiming the object
+     * \note requires the calling thread to have pinned the domain while unlinking the object
+     */
+    void retire(void* ptr, reclaim_function reclaim)
+    {
+      auto& r = this->local();
+      const auto e = r.nesting != 0 ? r.epoch.load(std::memory_order_relaxed) : m_epoch.load(std::memory_order_seq_cst);
+      r.bag.push_back({ e, ptr, reclaim });
+      if (r.bag.size() % collect_threshold == 0)
+      {
+        this->collect(r);
+      }
+    }
+
+    /**
+     * \brief retires the reference of the retain_ptr, the release of the reference is deferred
+     *        until no guard may observe the object any more
+     * \param ptr the reference unlinked from the shared structure
+     * \note requires the calling thread to have pinned the domain while unlinking the reference
+     */
+    template<typename T, typename Traits>
+    void retire(retain_ptr<T, Traits> ptr)
+    {
+      if (ptr)
+      {
+        this->retire(const_cast<std::remove_cv_t<T>*>(ptr.release()), &release_reference<T, Traits>);
+      }
+    }
+
+    /**
+     * \brief attempts to advance the global epoch and reclaims the objects retired by the calling thread
+     *        (and by the exited threads) which are not observable any more
+     */
+    void collect()
+    {
+      this->collect(this->local());
+    }
+
+    /**
+     * \brief waits until all objects retired by the calling thread (and by the exited threads) are reclaimed
+     * \note requires the calling thread not to pin the domain; waits for the guards of the other threads
+     */
+    void synchronize()
+    {
+      auto& r = this->local();
+      for (;;)
+      {
+        this->collect(r);
+        if (r.bag.empty())
+        {
+          std::lock_guard lk(m_orphans_mutex);
+          if (m_orphans.empty())
+          {
+            return;
+          }
+        }
+        std::this_thread::yield();
+      }
+    }
+
+    /**
+     * \brief returns the global epoch
+     */
+    [[nodiscard]]
+    epoch_type epoch() const noexcept
+    {
+      return m_epoch.load(std::memory_order_acquire);
+    }
+
+  private:
+    static constexpr epoch_type inactive = std::numeric_limits<epoch_type>::max();
+    static constexpr std::size_t collect_threshold = 128;
+
+    struct retired
+    {
+      epoch_type epoch;
+      void* ptr;
+      reclaim_function reclaim;
+    };
+
+    struct alignas(cache_line_size) record
+    {
+      std::atomic<epoch_type> epoch{ inactive };
+      std::atomic<bool> used{ true };
+      record* next{ nullptr };
+      // touched by the owning thread only
+      std::size_t nesting{ 0 };
+      std::vector<retired> bag;
+    };
+
+    // the record of the calling thread; hands the record back to the domain when the thread exits
+    class local_record
+    {
+    public:
+      explicit local_record(epoch_domain& domain)
+        : m_domain(domain)
+        , m_record(domain.acquire_record())
+      {
+      }
+
+      local_record(const local_record&) = delete;
+      local_record& operator=(const local_record&) = delete;
+
+      ~local_record()
+      {
+        m_domain.release_record(m_record);
+      }
+
+      record& get() const noexcept
+      {
+        return *m_record;
+      }
+
+    private:
+      epoch_domain& m_domain;
+      record* const m_record;
+    };
+
+    epoch_domain() = default;
+
+    ~epoch_domain()
+    {
+      // no thread is supposed to use the domain any more
+      for (auto& o : m_orphans)
+      {
+        o.reclaim(o.ptr);
+      }
+
+      auto* r = m_records.load(std::memory_order_acquire);
+      while (r)
+      {
+        auto* next = r->next;
+        for (auto& o : r->bag)
+        {
+          o.reclaim(o.ptr);
+        }
+        delete r;
+        r = next;
+      }
+    }
+
+    template<typename T, typename Traits>
+    static void release_reference(void* ptr) noexcept
+    {
+      Traits::decrement(static_cast<T*>(ptr));
+    }
+
+    record& local()
+    {
+      thread_local local_record r(*this);
+      return r.get();
+    }
+
+    record* acquire_record()
+    {
+      for (auto* r = m_records.load(std::memory_order_acquire); r; r = r->next)
+      {
+        if (!r->used.load(std::memory_order_relaxed) && !r->used.exchange(true, std::memory_order_acquire))
+        {
+          return r;
+        }
+      }
+
+      auto* r = new record;
+      auto* head = m_records.load(std::memory_order_relaxed);
+      do
+      {
+        r->next = head;
+      } while (!m_records.compare_exchange_weak(head, r, std::memory_order_release, std::memory_order_relaxed));
+      return r;
+    }
+
+    void release_record(record* r)
+    {
+      if (!r->bag.empty())
+      {
+        std::lock_guard lk(m_orphans_mutex);
+        m_orphans.insert(m_orphans.end(), r->bag.begin(), r->bag.end());
+        r->bag.clear();
+      }
+      r->used.store(false, std::memory_order_release);
+    }
+
+    void enter(record& r)
+    {
+      if (r.nesting++ != 0)
+      {
+        return;
+      }
+
+      // publish the pinned epoch and validate it; a collector which has not observed
+      // the pin has not advanced the epoch past the pinned one
+      auto e = m_epoch.load(std::memory_order_seq_cst);
+      for (;;)
+      {
+        r.epoch.store(e, std::memory_order_seq_cst);
+        const auto current = m_epoch.load(std::memory_order_seq_cst);
+        if (current == e)
+        {
+          return;
+        }
+        e = current;
+      }
+    }
+
+    static void leave(record& r) noexcept
+    {
+      if (--r.nesting == 0)
+      {
+        r.epoch.store(inactive, std::memory_order_release);
+      }
+    }
+
+    // advances the global epoch if all pinned records have observed it
+    void try_advance() noexcept
+    {
+      auto e = m_epoch.load(std::memory_order_seq_cst);
+      for (auto* r = m_records.load(std::memory_order_acquire); r; r = r->next)
+      {
+        const auto pinned = r->epoch.load(std::memory_order_seq_cst);
+        if (pinned != inactive && pinned != e)
+        {
+          return;
+        }
+      }
+      m_epoch.compare_exchange_strong(e, e + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+    }
+
+    // the retiring thread pinned o.epoch, hence the global epoch was at most o.epoch + 1 when the object
+    // has been unlinked; a guard which observed the object pins o.epoch + 1 at most and blocks o.epoch + 3
+    static bool reclaimable(const retired& o, epoch_type e) noexcept
+    {
+      return o.epoch + 3 <= e;
+    }
+
+    void collect(record& r)
+    {
+      this->try_advance();
+      const auto e = m_epoch.load(std::memory_order_acquire);
+
+      // the reclaim functions may retire further objects, the reclaimable ones are moved out first;
+      // the bag of a thread is ordered by the epoch
+      const auto last = std::find_if(r.bag.begin(), r.bag.end(), [e](const retired& o) { return !reclaimable(o, e); });
+      std::vector<retired> ready(r.bag.begin(), last);
+      r.bag.erase(r.bag.begin(), last);
+
+      if (std::unique_lock lk(m_orphans_mutex, std::try_to_lock); lk && !m_orphans.empty())
+      {
+        const auto it = std::stable_partition(m_orphans.begin(), m_orphans.end(), [e](const retired& o) { return !reclaimable(o, e); });
+        ready.insert(ready.end(), it, m_orphans.end());
+        m_orphans.erase(it, m_orphans.end());
+      }
+
+      for (auto& o : ready)
+      {
+        o.reclaim(o.ptr);
+      }
+    }
+
+    alignas(cache_line_size) std::atomic<epoch_type> m_epoch{ 0 };
+    std::atomic<record*> m_records{ nullptr };
+    alignas(cache_line_size) std::mutex m_orphans_mutex;
+    std::vector<retired> m_orphans;
+  };
+
+  /**
+   * \brief pins the epoch of the domain on the calling thread for its lifetime
+   */
+  class epoch_domain::guard
+  {
+  public:
+    guard(const guard&) = delete;
+    guard& operator=(const guard&) = delete;
+
+    guard(guard&& other) noexcept
+      : m_record(std::exchange(other.m_record, nullptr))
+    {
+    }
+
+    guard& operator=(guard&& other) noexcept
+    {
+      if (&other != this)
+      {
+        this->reset();
+        m_record = std::exchange(other.m_record, nullptr);
+      }
+      return *this;
+    }
+
+    ~guard()
+    {
+      this->reset();
+    }
+
+    /**
+     * \brief unpins the epoch before the end of the lifetime of the guard
+     */
+    void reset() noexcept
+    {
+      if (m_record)
+      {
+        leave(*m_record);
+        m_record = nullptr;
+      }
+    }
+
+  private:
+    friend class epoch_domain;
+
+    explicit guard(record& r) noexcept
+      : m_record(&r)
+    {
+    }
+
+    record* m_record;
+  };
+
+  inline epoch_domain::guard epoch_domain::pin()
+  {
+    auto& r = this->local();
+    this->enter(r);
+    return guard(r);
+  }
+} // end of namespace stdx
+
+#endif
@@ -0,0 +1,446 @@
+#ifndef STDX_EXECUTOR_H
+#define STDX_EXECUTOR_H
+
+#include "memory.h"
+#include "mpsc_queue.h"
+#include "utils.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace stdx
+{
+  /**
+   * \brief work_item is the base type of the tasks executed by work_stealing_executor.
+   *        A work item is an intrusively retained object, it is handed over to the executor
+   *        by transferring a retain_ptr<work_item>; the executor keeps the transferred
+   *        reference until the item has been run.
+   * \note the item must not be submitted again before it has started running
+   */
+  class work_item
+    : public atomic_reference_count<work_item>
+    , public queue_hook
+  {
+  public:
+    work_item(const work_item&) = delete;
+    work_item& operator=(const work_item&) = delete;
+
+    virtual ~work_item() = default;
+
+    /**
+     * \brief executes the work
+     * \note an exception escaping run() terminates the program
+     */
+    virtual void run() = 0;
+
+  protected:
+    work_item() noexcept = default;
+  };
+
+  namespace detail
+  {
+    template<typename F>
+    class function_work_item final : public work_item
+    {
+    public:
+      explicit function_work_item(F f)
+        : m_f(std::move(f))
+      {
+      }
+
+      void run() override
+      {
+        m_f();
+      }
+
+    private:
+      F m_f;
+    };
+
+    /**
+     * \brief Chase-Lev work-stealing deque (N. M. Le et al., "Correct and Efficient
+     *        Work-Stealing for Weak Memory Models") of raw pointers.
+     *        The owner pushes and takes at the bottom, the thieves steal at the top.
+     * \tparam T the element type of the stored pointers
+     */
+    template<typename T>
+    class chase_lev_deque
+    {
+    public:
+      explicit chase_lev_deque(std::int64_t capacity = 256)
+      {
+        auto a = std::make_unique<ring>(capacity);
+        m_array.store(a.get(), std::memory_order_relaxed);
+        m_arrays.push_back(std::move(a));
+      }
+
+      chase_lev_deque(const chase_lev_deque&) = delete;
+      chase_lev_deque& operator=(const chase_lev_deque&) = delete;
+
+      ~chase_lev_deque() = default;
+
+      // owner only
+      void push(T* value)
+      {
+        const auto b = m_bottom.load(std::memory_order_relaxed);
+        const auto t = m_top.load(std::memory_order_acquire);
+        auto* a = m_array.load(std::memory_order_relaxed);
+        if (b - t > a->capacity - 1)
+        {
+          a = this->grow(a, t, b);
+        }
+        a->put(b, value);
+        m_bottom.store(b + 1, std::memory_order_release);
+      }
+
+      // owner only
+      T* take() noexcept
+      {
+        const auto b = m_bottom.load(std::memory_order_relaxed) - 1;
+        auto* a = m_array.load(std::memory_order_relaxed);
+        m_bottom.store(b, std::memory_order_seq_cst);
+        auto t = m_top.load(std::memory_order_seq_cst);
+        if (t > b)
+        {
+          m_bottom.store(b + 1, std::memory_order_relaxed);
+          return nullptr;
+        }
+
+        auto* value = a->get(b);
+        if (t == b)
+        {
+          // the last element; races with the thieves
+          if (!m_top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+          {
+            value = nullptr;
+          }
+          m_bottom.store(b + 1, std::memory_order_relaxed);
+        }
+        return value;
+      }
+
+      // any thread
+      T* steal() noexcept
+      {
+        auto t = m_top.load(std::memory_order_seq_cst);
+        const auto b = m_bottom.load(std::memory_order_seq_cst);
+        if (t >= b)
+        {
+          return nullptr;
+        }
+
+        auto* value = m_array.load(std::memory_order_acquire)->get(t);
+        if (!m_top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+        {
+          return nullptr;
+        }
+        return value;
+      }
+
+      [[nodiscard]]
+      bool empty() const noexcept
+      {
+        return m_bottom.load(std::memory_order_acquire) <= m_top.load(std::memory_order_acquire);
+      }
+
+    private:
+      struct ring
+      {
+        explicit ring(std::int64_t c)
+          : capacity(c)
+          , mask(c - 1)
+          , slots(std::make_unique<std::atomic<T*>[]>(static_cast<std::size_t>(c)))
+        {
+        }
+
+        T* get(std::int64_t i) const noexcept
+        {
+          return slots[static_cast<std::size_t>(i & mask)].load(std::memory_order_relaxed);
+        }
+
+        void put(std::int64_t i, T* value) noexcept
+        {
+          slots[static_cast<std::size_t>(i & mask)].store(value, std::memory_order_relaxed);
+        }
+
+        const std::int64_t capacity;
+        const std::int64_t mask;
+        const std::unique_ptr<std::atomic<T*>[]> slots;
+      };
+
+      ring* grow(ring* a, std::int64_t t, std::int64_t b)
+      {
+        auto bigger = std::make_unique<ring>(a->capacity * 2);
+        for (auto i = t; i != b; ++i)
+        {
+          bigger->put(i, a->get(i));
+        }
+        auto* result = bigger.get();
+        // the smaller arrays may still be read by the thieves, they are kept until destruction
+        m_arrays.push_back(std::move(bigger));
+        m_array.store(result, std::memory_order_release);
+        return result;
+      }
+
+      alignas(cache_line_size) std::atomic<std::int64_t> m_top{ 0 };
+      alignas(cache_line_size) std::atomic<std::int64_t> m_bottom{ 0 };
+      std::atomic<ring*> m_array{ nullptr };
+      std::vector<std::unique_ptr<ring>> m_arrays;
+    };
+  } // end of namespace detail
+
+  /**
+   * \brief creates a work item invoking f
+   * \param f the function to invoke; f must not throw
+   * \return the retained work item
+   * \note the function is stored within the work item (a single allocation)
+   */
+  template<typename F>
+  [[nodiscard]]
+  retain_ptr<work_item> make_work_item(F&& f)
+  {
+    return retain_ptr<work_item>(new detail::function_work_item<std::decay_t<F>>(std::forward<F>(f)), adopt_object);
+  }
+
+  /**
+   * \brief work_stealing_executor is a thread pool executing retained work items.
+   *
+   *        Every worker owns a Chase-Lev deque; the items submitted from a worker
+   *        are pushed onto its own deque (LIFO for the owner, FIFO for the thieves),
+   *        the items submitted from other threads are pushed onto the global injection
+   *        queue (an intrusive mpsc_queue). An idle worker steals from the other workers.
+   *        Submitting an item transfers the reference of the retain_ptr to the executor:
+   *        there is no allocation and no reference count operation per submit.
+   * \note the destructor runs all submitted work items (including the ones submitted
+   *       by the running items) before it joins the workers
+   */
+  class work_stealing_executor
+  {
+  public:
+    /// @name Construction
+    /// @{
+
+    /**
+     * \brief Constructs the executor and starts the workers
+     * \param thread_count the number of workers; 0 selects std::thread::hardware_concurrency()
+     */
+    explicit work_stealing_executor(std::size_t thread_count = 0)
+    {
+      if (thread_count == 0)
+      {
+        thread_count = std::thread::hardware_concurrency();
+      }
+      if (thread_count == 0)
+      {
+        thread_count = 1;
+      }
+
+      m_workers.reserve(thread_count);
+      for (std::size_t i = 0; i < thread_count; ++i)
+      {
+        m_workers.push_back(std::make_unique<worker>());
+      }
+      for (std::size_t i = 0; i < thread_count; ++i)
+      {
+        m_workers[i]->thread = std::thread([this, i] { this->worker_loop(i); });
+      }
+    }
+
+    work_stealing_executor(const work_stealing_executor&) = delete;
+    work_stealing_executor(work_stealing_executor&&) = delete;
+    work_stealing_executor& operator=(const work_stealing_executor&) = delete;
+    work_stealing_executor& operator=(work_stealing_executor&&) = delete;
+
+    /**
+     * \brief destructor; runs the pending work items and joins the workers
+     */
+    ~work_stealing_executor()
+    {
+      m_stop.store(true, std::memory_order_seq_cst);
+      {
+        std::lock_guard lk(m_mutex);
+        m_wakeup.notify_all();
+      }
+      for (auto& w : m_workers)
+      {
+        w->thread.join();
+      }
+    }
+
+    /// @}
+
+    /**
+     * \brief hands the work item over to the executor
+     * \param item the item to execute; requires item != nullptr
+     */
+    void submit(retain_ptr<work_item> item)
+    {
+      if (t_current.executor == this)
+      {
+        // the item keeps its reference until the deque holds it, a failed growth does not leak it
+        m_workers[t_current.index]->deque.push(item.get());
+        static_cast<void>(item.release());
+      }
+      else
+      {
+        m_injected.push(std::move(item));
+      }
+      this->notify();
+    }
+
+    /**
+     * \brief creates a work item invoking f and hands it over to the executor
+     * \param f the function to invoke; f must not throw
+     */
+    template<typename F>
+    void post(F&& f)
+    {
+      this->submit(make_work_item(std::forward<F>(f)));
+    }
+
+    /**
+     * \brief runs one pending work item on the calling thread, if there is any
+     * \return true if an item has been run
+     * \note intended for the threads waiting for the completion of work (fork/join),
+     *       which help the executor instead of blocking
+     */
+    bool try_run_one()
+    {
+      const auto index = t_current.executor == this ? t_current.index : m_workers.size();
+      if (auto item = this->find_work(index); item)
+      {
+        item->run();
+        return true;
+      }
+      return false;
+    }
+
+    /**
+     * \brief returns the number of workers
+     */
+    [[nodiscard]]
+    std::size_t thread_count() const noexcept
+    {
+      return m_workers.size();
+    }
+
+  private:
+    struct worker
+    {
+      detail::chase_lev_deque<work_item> deque;
+      std::thread thread;
+    };
+
+    struct current_worker
+    {
+      const work_stealing_executor* executor;
+      std::size_t index;
+    };
+
+    static inline thread_local current_worker t_current{ nullptr, 0 };
+
+    void notify()
+    {
+      m_epoch.fetch_add(1, std::memory_order_seq_cst);
+      if (m_sleepers.load(std::memory_order_seq_cst) != 0)
+      {
+        std::lock_guard lk(m_mutex);
+        m_wakeup.notify_one();
+      }
+    }
+
+    retain_ptr<work_item> find_work(std::size_t index)
+    {
+      const auto count = m_workers.size();
+      if (index < count)
+      {
+        if (auto* raw = m_workers[index]->deque.take(); raw)
+        {
+          return retain_ptr<work_item>(raw, adopt_object);
+        }
+      }
+
+      if (!m_injected_lock.test_and_set(std::memory_order_acquire))
+      {
+        auto item = m_injected.pop();
+        m_injected_lock.clear(std::memory_order_release);
+        if (item)
+        {
+          return item;
+        }
+      }
+
+      // steal from the other workers, starting at a pseudo-random victim
+      thread_local auto seed = static_cast<std::uint32_t>(std::hash<std::thread::id>{}(std::this_thread::get_id())) | 1U;
+      seed ^= seed << 13U;
+      seed ^= seed >> 17U;
+      seed ^= seed << 5U;
+      const auto start = static_cast<std::size_t>(seed) % count;
+      for (std::size_t i = 0; i < count; ++i)
+      {
+        const auto victim = (start + i) % count;
+        if (victim == index)
+        {
+          continue;
+        }
+        if (auto* raw = m_workers[victim]->deque.steal(); raw)
+        {
+          return retain_ptr<work_item>(raw, adopt_object);
+        }
+      }
+      return {};
+    }
+
+    void worker_loop(std::size_t index)
+    {
+      t_current = { this, index };
+      for (;;)
+      {
+        if (auto item = this->find_work(index); item)
+        {
+          item->run();
+          continue;
+        }
+
+        const auto epoch = m_epoch.load(std::memory_order_seq_cst);
+        if (auto item = this->find_work(index); item)
+        {
+          item->run();
+          continue;
+        }
+
+        if (m_stop.load(std::memory_order_seq_cst))
+        {
+          break;
+        }
+
+        std::unique_lock lk(m_mutex);
+        m_sleepers.fetch_add(1, std::memory_order_seq_cst);
+        m_wakeup.wait(lk, [this, epoch] {
+          return m_stop.load(std::memory_order_seq_cst) || m_epoch.load(std::memory_order_seq_cst) != epoch;
+        });
+        m_sleepers.fetch_sub(1, std::memory_order_relaxed);
+      }
+      t_current = { nullptr, 0 };
+    }
+
+    std::vector<std::unique_ptr<worker>> m_workers;
+    mpsc_queue<work_item> m_injected;
+    alignas(cache_line_size) std::atomic_flag m_injected_lock = ATOMIC_FLAG_INIT;
+    alignas(cache_line_size) std::atomic<std::uint64_t> m_epoch{ 0 };
+    std::atomic<std::size_t> m_sleepers{ 0 };
+    std::atomic<bool> m_stop{ false };
+    std::mutex m_mutex;
+    std::condition_variable m_wakeup;
+  };
+} // end of namespace stdx
+
+#endif
@@ -0,0 +1,457 @@
+#ifndef STDX_FUTURE_H
+#define STDX_FUTURE_H
+
+#include "memory.h"
+#include "memory_pool.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+namespace stdx
+{
+  template<typename T>
+  class future;
+
+  template<typename T>
+  class promise;
+
+  namespace detail
+  {
+    template<typename T>
+    class future_state;
+
+    /**
+     * \brief the value stored by the shared state of a future<void>
+     */
+    struct future_void
+    {
+    };
+
+    /**
+     * \brief a continuation attached to a shared state; invoke is called once the state is ready
+     *        and disposes of the continuation
+     */
+    template<typename T>
+    class future_continuation
+    {
+    public:
+      virtual void invoke(retain_ptr<future_state<T>> state) noexcept = 0;
+
+    protected:
+      ~future_continuation() = default;
+    };
+
+    /**
+     * \brief the shared state of a future and its promise, retained by both of them
+     */
+    template<typename T>
+    class future_state final
+      : public atomic_reference_count<future_state<T>>
+      , public pool_allocated
+    {
+    public:
+      using value_type = std::conditional_t<std::is_void_v<T>, future_void, T>;
+
+      future_state() noexcept = default;
+      future_state(const future_state&) = delete;
+      future_state& operator=(const future_state&) = delete;
+
+      template<typename... Args>
+      void set_value(Args&&... args)
+      {
+        m_value.emplace(std::forward<Args>(args)...);
+        this->complete();
+      }
+
+      void set_exception(std::exception_ptr e) noexcept
+      {
+        m_exception = std::move(e);
+        this->complete();
+      }
+
+      [[nodiscard]]
+      bool is_ready() const noexcept
+      {
+        return m_state.load(std::memory_order_acquire) == ready;
+      }
+
+      /**
+       * \brief attaches the continuation, invokes it at once if the state is already ready
+       * \note at most one continuation may be attached
+       */
+      void attach(future_continuation<T>* continuation) noexcept
+      {
+        m_continuation = continuation;
+        auto expected = pending;
+        if (!m_state.compare_exchange_strong(expected, attached, std::memory_order_acq_rel, std::memory_order_acquire))
+        {
+          m_continuation = nullptr;
+          continuation->invoke(retain_ptr<future_state>(this, retain_object));
+        }
+      }
+
+      /**
+       * \brief blocks until the state is ready; the mutex is taken only when the state is pending
+       */
+      void wait()
+      {
+        if (this->is_ready())
+        {
+          return;
+        }
+
+        sync_waiter waiter;
+        this->attach(&waiter);
+        std::unique_lock lk(waiter.mutex);
+        waiter.completed.wait(lk, [&waiter] { return waiter.done; });
+      }
+
+      value_type take()
+      {
+        if (m_exception)
+        {
+          std::rethrow_exception(m_exception);
+        }
+        return std::move(*m_value);
+      }
+
+    private:
+      enum state : unsigned char
+      {
+        pending,
+        attached,
+        ready
+      };
+
+      struct sync_waiter final : future_continuation<T>
+      {
+        void invoke(retain_ptr<future_state>) noexcept override
+        {
+          std::lock_guard lk(mutex);
+          done = true;
+          completed.notify_all();
+        }
+
+        std::mutex mutex;
+        std::condition_variable completed;
+        bool done{ false };
+      };
+
+      // the continuation is read by the completing thread only if it has been attached before
+      void complete() noexcept
+      {
+        if (m_state.exchange(ready, std::memory_order_acq_rel) == attached)
+        {
+          auto* continuation = std::exchange(m_continuation, nullptr);
+          continuation->invoke(retain_ptr<future_state>(this, retain_object));
+        }
+      }
+
+      std::atomic<state> m_state{ pending };
+      future_continuation<T>* m_continuation{ nullptr };
+      std::optional<value_type> m_value;
+      std::exception_ptr m_exception;
+    };
+
+    template<typename T, typename F>
+    class then_continuation;
+  } // end of namespace detail
+
+  /**
+   * \brief future<T> is the receiving side of a one-shot value produced by a promise<T>.
+   *
+   *        The future and its promise retain a single shared state, derived from
+   *        atomic_reference_count and allocated from the memory_pool. The completion is an atomic
+   *        state machine: setting the value or attaching a continuation costs a single atomic
+   *        operation; only a blocking wait on a pending state takes a mutex.
+   * \tparam T the type of the value, void if the promise does not provide a value
+   * \note the continuation attached by then() runs on the thread completing the promise,
+   *       or on the calling thread if the future is already ready
+   */
+  template<typename T>
+  class future
+  {
+    static_assert(!std::is_reference_v<T>, "future<T>: T must not be a reference type");
+
+  public:
+    using value_type = T;
+    using state_pointer = retain_ptr<detail::future_state<T>>;
+
+    /// @name Construction
+    /// @{
+
+    future() noexcept = default;
+
+    explicit future(state_pointer state) noexcept
+      : m_state(std::move(state))
+    {
+    }
+
+    future(future&&) noexcept = default;
+    future& operator=(future&&) noexcept = default;
+
+    future(const future&) = delete;
+    future& operator=(const future&) = delete;
+
+    ~future() = default;
+
+    /// @}
+
+    /**
+     * \brief checks whether the future refers to a shared state
+     */
+    [[nodiscard]]
+    bool valid() const noexcept
+    {
+      return static_cast<bool>(m_state);
+    }
+
+    /**
+     * \brief checks whether the value or the exception is available
+     * \note requires valid()
+     */
+    [[nodiscard]]
+    bool is_ready() const noexcept
+    {
+      return m_state->is_ready();
+    }
+
+    /**
+     * \brief blocks until the value or the exception is available
+     * \note requires valid(); a pending future must not be waited for by several threads
+     */
+    void wait() const
+    {
+      m_state->wait();
+    }
+
+    /**
+     * \brief waits for the value and returns it, the future is not valid anymore
+     * \note rethrows the exception stored by the promise
+     * \note requires valid()
+     */
+    T get()
+    {
+      auto state = std::move(m_state);
+      state->wait();
+      if constexpr (std::is_void_v<T>)
+      {
+        state->take();
+      }
+      else
+      {
+        return state->take();
+      }
+    }
+
+    /**
+     * \brief attaches a continuation invoked with the ready future, the future is not valid anymore
+     * \param f the function invoked with a future<T> once this future is ready
+     * \return the future of the result of f; it stores the exception escaping f
+     * \note requires valid()
+     */
+    template<typename F>
+    auto then(F&& f) && -> future<std::invoke_result_t<std::decay_t<F>, future<T>>>
+    {
+      auto* continuation = new detail::then_continuation<T, std::decay_t<F>>(std::forward<F>(f));
+      auto result = continuation->get_future();
+      auto state = std::move(m_state);
+      state->attach(continuation);
+      return result;
+    }
+
+  private:
+    state_pointer m_state;
+  };
+
+  /**
+   * \brief promise<T> is the producing side of a future<T>.
+   *
+   *        A promise destroyed before it has been satisfied stores a std::future_error
+   *        with the broken_promise error code.
+   * \tparam T the type of the value, void if the promise does not provide a value
+   */
+  template<typename T>
+  class promise
+  {
+  public:
+    using value_type = T;
+
+    /// @name Construction
+    /// @{
+
+    promise()
+      : m_state(new detail::future_state<T>, adopt_object)
+    {
+    }
+
+    promise(promise&& other) noexcept
+      : m_state(std::move(other.m_state))
+      , m_satisfied(std::exchange(other.m_satisfied, false))
+      , m_retrieved(std::exchange(other.m_retrieved, false))
+    {
+    }
+
+    promise& operator=(promise&& other) noexcept
+    {
+      if (this != &other)
+      {
+        this->abandon();
+        m_state = std::move(other.m_state);
+        m_satisfied = std::exchange(other.m_satisfied, false);
+        m_retrieved = std::exchange(other.m_retrieved, false);
+      }
+      return *this;
+    }
+
+    promise(const promise&) = delete;
+    promise& operator=(const promise&) = delete;
+
+    ~promise()
+    {
+      this->abandon();
+    }
+
+    /// @}
+
+    /**
+     * \brief returns the future sharing the state of the promise
+     * \note throws std::future_error if the future has already been retrieved
+     */
+    future<T> get_future()
+    {
+      this->check_state();
+      if (m_retrieved)
+      {
+        throw std::future_error(std::future_errc::future_already_retrieved);
+      }
+      m_retrieved = true;
+      return future<T>(m_state);
+    }
+
+    /**
+     * \brief stores the value constructed from args, makes the state ready and runs the continuation
+     * \note throws std::future_error if the promise has already been satisfied
+     */
+    template<typename... Args
+      requires_T(std::is_constructible_v<typename detail::future_state<T>::value_type, Args&&...>)
+    >
+    void set_value(Args&&... args)
+    {
+      this->check_satisfiable();
+      m_state->set_value(std::forward<Args>(args)...);
+      m_satisfied = true;
+    }
+
+    /**
+     * \brief stores the exception, makes the state ready and runs the continuation
+     * \note throws std::future_error if the promise has already been satisfied
+     */
+    void set_exception(std::exception_ptr e)
+    {
+      this->check_satisfiable();
+      m_satisfied = true;
+      m_state->set_exception(std::move(e));
+    }
+
+  private:
+    void check_state() const
+    {
+      if (!m_state)
+      {
+        throw std::future_error(std::future_errc::no_state);
+      }
+    }
+
+    void check_satisfiable() const
+    {
+      this->check_state();
+      if (m_satisfied)
+      {
+        throw std::future_error(std::future_errc::promise_already_satisfied);
+      }
+    }
+
+    void abandon() noexcept
+    {
+      if (m_state && !m_satisfied)
+      {
+        m_satisfied = true;
+        m_state->set_exception(std::make_exception_ptr(std::future_error(std::future_errc::broken_promise)));
+      }
+    }
+
+    retain_ptr<detail::future_state<T>> m_state;
+    bool m_satisfied{ false };
+    bool m_retrieved{ false };
+  };
+
+  namespace detail
+  {
+    template<typename T, typename F>
+    class then_continuation final
+      : public future_continuation<T>
+      , public pool_allocated
+    {
+    public:
+      using result_type = std::invoke_result_t<F, future<T>>;
+
+      explicit then_continuation(F f)
+        : m_f(std::move(f))
+      {
+      }
+
+      future<result_type> get_future()
+      {
+        return m_promise.get_future();
+      }
+
+      void invoke(retain_ptr<future_state<T>> state) noexcept override
+      {
+        try
+        {
+          if constexpr (std::is_void_v<result_type>)
+          {
+            std::invoke(m_f, future<T>(std::move(state)));
+            m_promise.set_value();
+          }
+          else
+          {
+            m_promise.set_value(std::invoke(m_f, future<T>(std::move(state))));
+          }
+        }
+        catch (...)
+        {
+          m_promise.set_exception(std::current_exception());
+        }
+        delete this;
+      }
+
+    private:
+      F m_f;
+      promise<result_type> m_promise;
+    };
+  } // end of namespace detail
+
+  /**
+   * \brief returns a ready future holding the value constructed from args
+   */
+  template<typename T, typename... Args>
+  [[nodiscard]]
+  future<T> make_ready_future(Args&&... args)
+  {
+    promise<T> p;
+    auto f = p.get_future();
+    p.set_value(std::forward<Args>(args)...);
+    return f;
+  }
+} // end of namespace stdx
+
+#endif
@@ -0,0 +1,299 @@
+#ifndef STDX_INTERN_TABLE_H
+#define STDX_INTERN_TABLE_H
+
+#include "memory.h"
+#include "utils.h"
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+
+namespace stdx
+{
+  namespace detail
+  {
+    template<typename T>
+    struct interned_node;
+
+    /**
+     * \brief the part of a shard of an intern_table its nodes release themselves to
+     */
+    template<typename T>
+    class intern_shard_base
+    {
+    public:
+      /**
+       * \brief removes the node whose last reference has been released and deletes it
+       */
+      virtual void release(const interned_node<T>* node) noexcept = 0;
+
+    protected:
+      ~intern_shard_base() = default;
+    };
+
+    /**
+     * \brief a value held by a table without being owned by it: the value followed by its
+     *        reference count, its hash and its shard
+     * \note the nodes of the tables storing a key besides the value derive from interned_node
+     */
+    template<typename T>
+    struct interned_node : T
+    {
+      template<typename... Args>
+      interned_node(std::size_t h, intern_shard_base<T>* s, Args&&... args)
+        : T(std::forward<Args>(args)...)
+        , hash(h)
+        , shard(s)
+      {
+      }
+
+      interned_node(const interned_node&) = delete;
+      interned_node& operator=(const interned_node&) = delete;
+
+      virtual ~interned_node() = default;
+
+      /**
+       * \brief increments the reference count unless it has already dropped to zero
+       */
+      [[nodiscard]]
+      bool try_retain() const noexcept
+      {
+        auto c = count.load(std::memory_order_relaxed);
+        while (c != 0)
+        {
+          if (count.compare_exchange_weak(c, c + 1, std::memory_order_relaxed))
+          {
+            return true;
+          }
+        }
+        return false;
+      }
+
+      mutable std::atomic<std::ptrdiff_t> count{ 1 };
+      const std::size_t hash;
+      // reset when the table is destroyed before the node
+      intern_shard_base<T>* shard;
+    };
+  } // end of namespace detail
+
+  /**
+   * \brief The traits of the pointers to the values held by an intern_table or a weak_cache:
+   *        the value is removed from its table and deleted when its last reference is released.
+   */
+  template<typename T>
+  struct intern_traits final
+  {
+    using node_type = detail::interned_node<T>;
+
+    static void increment(const T* ptr) noexcept
+    {
+      static_cast<const node_type*>(ptr)->count.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    static void decrement(const T* ptr) noexcept
+    {
+      const auto* node = static_cast<const node_type*>(ptr);
+      if (node->count.fetch_sub(1, std::memory_order_acq_rel) == 1)
+      {
+        if (node->shard)
+        {
+          node->shard->release(node);
+        }
+        else
+        {
+          delete node;
+        }
+      }
+    }
+
+    [[nodiscard]]
+    static std::ptrdiff_t use_count(const T* ptr) noexcept
+    {
+      return static_cast<const node_type*>(ptr)->count.load(std::memory_order_relaxed);
+    }
+  };
+
+  /**
+   * \brief intern_table returns the canonical retained instance of the structurally equal values
+   *        (hash-consing): interning equal values returns pointers comparing equal.
+   *
+   *        The table is sharded by the hash of the values, each shard is locked independently.
+   *        The table does not own its values: a value is removed from the table when its last
+   *        reference is released. A lookup retains a found value only if its reference count has
+   *        not yet dropped to zero; a dying value is replaced by a new canonical instance.
+   * \tparam T the type of the values, a non-final class type
+   * \tparam Hash the hash function of T
+   * \tparam KeyEqual the equality predicate of T
+   * \note the pointers may outlive the table, but must not be released while the table is destroyed
+   */
+  template<typename T,
+    typename Hash = std::hash<T>,
+    typename KeyEqual = std::equal_to<T>>
+  class intern_table
+  {
+    static_assert(std::is_class_v<T> && !std::is_final_v<T>, "intern_table<T>: T must be a non-final class type");
+
+    using node = detail::interned_node<T>;
+
+  public:
+    using value_type = T;
+    using pointer = retain_ptr<const T, intern_traits<T>>;
+    using hasher = Hash;
+    using key_equal = KeyEqual;
+    using size_type = std::size_t;
+
+    /// @name Construction
+    /// @{
+
+    /**
+     * \brief Constructs an empty table
+     * \param shard_count the number of independently locked shards (rounded up to a power of two)
+     */
+    explicit intern_table(size_type shard_count = 64, const Hash& hash = Hash(), const KeyEqual& equal = KeyEqual())
+      : m_shard_mask(detail::round_up_to_power_of_two(shard_count) - 1)
+      , m_shards(std::make_unique<shard[]>(m_shard_mask + 1))
+      , m_hash(hash)
+      , m_equal(equal)
+    {
+    }
+
+    intern_table(const intern_table&) = delete;
+    intern_table(intern_table&&) = delete;
+    intern_table& operator=(const intern_table&) = delete;
+    intern_table& operator=(intern_table&&) = delete;
+
+    // the values still referenced are detached, their last release deletes them
+    ~intern_table()
+    {
+      for (size_type i = 0; i <= m_shard_mask; ++i)
+      {
+        auto& s = m_shards[i];
+        std::lock_guard lk(s.mutex);
+        for (auto& [h, n] : s.nodes)
+        {
+          n->shard = nullptr;
+        }
+      }
+    }
+
+    /// @}
+
+    /**
+     * \brief returns the canonical instance of value, interning a copy of value if there is none
+     */
+    template<typename U
+      requires_T(std::is_same_v<std::decay_t<U>, T>)
+    >
+    [[nodiscard]]
+    pointer intern(U&& value)
+    {
+      const auto h = m_hash(value);
+      auto& s = this->shard_of(h);
+      std::lock_guard lk(s.mutex);
+      const auto [first, last] = s.nodes.equal_range(h);
+      for (auto it = first; it != last; ++it)
+      {
+        if (m_equal(static_cast<const T&>(*it->second), value))
+        {
+          if (it->second->try_retain())
+          {
+            return pointer(it->second, adopt_object);
+          }
+          // the dying node is released by its last owner, which finds it replaced
+          it->second = new node(h, &s, std::forward<U>(value));
+          return pointer(it->second, adopt_object);
+        }
+      }
+      auto* n = new node(h, &s, std::forward<U>(value));
+      s.nodes.emplace(h, n);
+      return pointer(n, adopt_object);
+    }
+
+    /**
+     * \brief returns the canonical instance of value, nullptr if value is not interned
+     */
+    [[nodiscard]]
+    pointer find(const T& value) const
+    {
+      const auto h = m_hash(value);
+      auto& s = this->shard_of(h);
+      std::lock_guard lk(s.mutex);
+      const auto [first, last] = s.nodes.equal_range(h);
+      for (auto it = first; it != last; ++it)
+      {
+        if (m_equal(static_cast<const T&>(*it->second), value) && it->second->try_retain())
+        {
+          return pointer(it->second, adopt_object);
+        }
+      }
+      return nullptr;
+    }
+
+    /**
+     * \brief returns the number of interned values, including the ones being released
+     */
+    [[nodiscard]]
+    size_type size() const
+    {
+      size_type result = 0;
+      for (size_type i = 0; i <= m_shard_mask; ++i)
+      {
+        auto& s = m_shards[i];
+        std::lock_guard lk(s.mutex);
+        result += s.nodes.size();
+      }
+      return result;
+    }
+
+    /**
+     * \brief returns the number of shards
+     */
+    [[nodiscard]]
+    size_type shard_count() const noexcept
+    {
+      return m_shard_mask + 1;
+    }
+
+  private:
+    struct alignas(cache_line_size) shard final : detail::intern_shard_base<T>
+    {
+      void release(const node* n) noexcept override
+      {
+        {
+          std::lock_guard lk(mutex);
+          const auto [first, last] = nodes.equal_range(n->hash);
+          for (auto it = first; it != last; ++it)
+          {
+            if (it->second == n)
+            {
+              nodes.erase(it);
+              break;
+            }
+          }
+        }
+        delete n;
+      }
+
+      std::mutex mutex;
+      // the nodes by their hash
+      std::unordered_multimap<std::size_t, node*> nodes;
+    };
+
+    shard& shard_of(std::size_t h) const noexcept
+    {
+      return m_shards[h & m_shard_mask];
+    }
+
+    const size_type m_shard_mask;
+    const std::unique_ptr<shard[]> m_shards;
+    Hash m_hash;
+    KeyEqual m_equal;
+  };
+} // end of namespace stdx
+
+#endif
@@ -0,0 +1,377 @@
+#ifndef STDX_MEMOIZE_H
+#define STDX_MEMOIZE_H
+
+#include "memory.h"
+#include "utils.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace stdx
+{
+  template<typename R, typename... Ts>
+  class memo_cache;
+
+  namespace detail
+  {
+    class memo_subject;
+
+    /**
+     * \brief the part of a memo_cache the dying subjects report to
+     */
+    class memo_observer
+    {
+    public:
+      /**
+       * \brief drops the entries keyed by the dying subject
+       * \note invoked with the registry mutex locked
+       */
+      virtual void forget(const memo_subject* subject) = 0;
+
+    protected:
+      ~memo_observer() = default;
+    };
+
+    /**
+     * \brief the mutex guarding the observers of all subjects; it is recursive since dropping
+     *        a result may release the last reference of another subject
+     */
+    inline std::recursive_mutex& memo_registry_mutex()
+    {
+      static std::recursive_mutex mutex;
+      return mutex;
+    }
+
+    /**
+     * \brief the object observed by the memo_caches holding entries keyed by it
+     */
+    class memo_subject
+    {
+      template<typename R, typename... Ts>
+      friend class stdx::memo_cache;
+
+    protected:
+      memo_subject() noexcept = default;
+
+      // a copy is a new object, the observers are not copied
+      memo_subject(const memo_subject&) noexcept
+      {
+      }
+
+      memo_subject& operator=(const memo_subject&) noexcept
+      {
+        return *this;
+      }
+
+      // the zero path: the entries keyed by the subject are dropped before its address is reused
+      ~memo_subject()
+      {
+        if (!m_observed.load(std::memory_order_acquire))
+        {
+          return;
+        }
+        std::lock_guard lk(memo_registry_mutex());
+        auto observers = std::move(m_observers);
+        m_observed.store(false, std::memory_order_relaxed);
+        for (auto* observer : observers)
+        {
+          observer->forget(this);
+        }
+      }
+
+    private:
+      // requires the registry mutex
+      void observe(memo_observer* observer) const
+      {
+        m_observers.push_back(observer);
+        m_observed.store(true, std::memory_order_release);
+      }
+
+      // requires the registry mutex
+      void unobserve(memo_observer* observer) const noexcept
+      {
+        m_observers.erase(std::find(m_observers.begin(), m_observers.end(), observer));
+        m_observed.store(!m_observers.empty(), std::memory_order_release);
+      }
+
+      mutable std::vector<memo_observer*> m_observers;
+      mutable std::atomic<bool> m_observed{ false };
+    };
+  } // end of namespace detail
+
+  /**
+   * \brief memoizable is the mixin type of the retained objects which may key the entries of a
+   *        memo_cache: its reference count is the one of atomic_reference_count, its destruction
+   *        drops the entries keyed by the object.
+   * \tparam T the type deriving from memoizable (CRTP)
+   */
+  template<typename T>
+  struct memoizable : atomic_reference_count<T>, detail::memo_subject
+  {
+  protected:
+    memoizable() noexcept = default;
+  };
+
+  /**
+   * \brief memo_cache memoizes a pure function of retained objects, keyed by the identities of
+   *        its arguments (hashed by std::hash<retain_ptr<T>>), without hashing their contents.
+   *
+   *        The cache does not retain the arguments: an entry is dropped when one of its arguments
+   *        is destroyed (the destructor of memoizable) or, with a non-zero capacity, when it is the
+   *        least recently used entry beyond the capacity. A miss invokes the function without
+   *        holding any lock; the inserts and the destructions of the observed objects are
+   *        serialized by a process-wide registry mutex, the hits only lock the cache.
+   * \tparam R the result type, copyable
+   * \tparam Ts the types of the objects of the arguments, deriving from memoizable
+   * \note the arguments must not be null
+   */
+  template<typename R, typename... Ts>
+  class memo_cache final : detail::memo_observer
+  {
+    static_assert(sizeof...(Ts) > 0, "memo_cache: the function takes at least one argument");
+
+    using subject = detail::memo_subject;
+    using key_type = std::array<const subject*, sizeof...(Ts)>;
+
+    struct entry
+    {
+      std::size_t hash;
+      key_type keys;
+      R result;
+    };
+
+    // the most recently used entry first
+    using entry_list = std::list<entry>;
+    using entry_iterator = typename entry_list::iterator;
+
+  public:
+    using result_type = R;
+    using function_type = std::function<R(const retain_ptr<Ts>&...)>;
+    using size_type = std::size_t;
+
+    /// @name Construction
+    /// @{
+
+    /**
+     * \brief Constructs an empty cache of the results of f
+     * \param capacity the maximum number of entries, 0 bounds the entries by the live arguments only
+     */
+    explicit memo_cache(function_type f, size_type capacity = 0)
+      : m_function(std::move(f))
+      , m_capacity(capacity)
+    {
+    }
+
+    memo_cache(const memo_cache&) = delete;
+    memo_cache(memo_cache&&) = delete;
+    memo_cache& operator=(const memo_cache&) = delete;
+    memo_cache& operator=(memo_cache&&) = delete;
+
+    ~memo_cache()
+    {
+      this->clear();
+    }
+
+    /// @}
+
+    /**
+     * \brief returns the memoized result of the function, invoking it on a miss
+     */
+    R operator()(const retain_ptr<Ts>&... args)
+    {
+      const key_type keys{ static_cast<const subject*>(args.get())... };
+      const auto hash = hash_of(args...);
+      if (auto result = this->lookup(hash, keys))
+      {
+        return std::move(*result);
+      }
+      R result = m_function(args...);
+      this->insert(hash, keys, result);
+      return result;
+    }
+
+    /**
+     * \brief returns the memoized result, std::nullopt on a miss; never invokes the function
+     */
+    [[nodiscard]]
+    std::optional<R> find(const retain_ptr<Ts>&... args)
+    {
+      return this->lookup(hash_of(args...), key_type{ static_cast<const subject*>(args.get())... });
+    }
+
+    /**
+     * \brief drops all entries
+     */
+    void clear()
+    {
+      std::lock_guard reg(detail::memo_registry_mutex());
+      entry_list trash;
+      {
+        std::lock_guard lk(m_mutex);
+        for (auto& [s, entries] : m_by_subject)
+        {
+          s->unobserve(this);
+        }
+        m_by_subject.clear();
+        m_index.clear();
+        trash.swap(m_entries);
+      }
+    }
+
+    [[nodiscard]]
+    size_type size() const
+    {
+      std::lock_guard lk(m_mutex);
+      return m_entries.size();
+    }
+
+    [[nodiscard]]
+    size_type capacity() const noexcept
+    {
+      return m_capacity;
+    }
+
+  private:
+    [[nodiscard]]
+    static std::size_t hash_of(const retain_ptr<Ts>&... args) noexcept
+    {
+      std::size_t h = 0;
+      ((h = h * 31 + std::hash<retain_ptr<Ts>>{}(args)), ...);
+      return h;
+    }
+
+    // requires the lock of the cache
+    entry_iterator find_locked(std::size_t hash, const key_type& keys)
+    {
+      const auto [first, last] = m_index.equal_range(hash);
+      for (auto it = first; it != last; ++it)
+      {
+        if (it->second->keys == keys)
+        {
+          return it->second;
+        }
+      }
+      return m_entries.end();
+    }
+
+    std::optional<R> lookup(std::size_t hash, const key_type& keys)
+    {
+      std::lock_guard lk(m_mutex);
+      const auto it = this->find_locked(hash, keys);
+      if (it == m_entries.end())
+      {
+        return std::nullopt;
+      }
+      m_entries.splice(m_entries.begin(), m_entries, it);
+      return it->result;
+    }
+
+    // the dropped results are destroyed after the lock of the cache is unlocked
+    void insert(std::size_t hash, const key_type& keys, const R& result)
+    {
+      std::lock_guard reg(detail::memo_registry_mutex());
+      entry_list trash;
+      {
+        std::lock_guard lk(m_mutex);
+        if (this->find_locked(hash, keys) != m_entries.end())
+        {
+          return;
+        }
+        m_entries.push_front(entry{ hash, keys, result });
+        const auto it = m_entries.begin();
+        m_index.emplace(hash, it);
+        for (std::size_t i = 0; i < keys.size(); ++i)
+        {
+          if (is_first_occurrence(keys, i))
+          {
+            auto& entries = m_by_subject[keys[i]];
+            if (entries.empty())
+            {
+              keys[i]->observe(this);
+            }
+            entries.push_back(it);
+          }
+        }
+        while (m_capacity != 0 && m_entries.size() > m_capacity)
+        {
+          this->unlink(std::prev(m_entries.end()), nullptr, trash);
+        }
+      }
+    }
+
+    void forget(const subject* dying) override
+    {
+      entry_list trash;
+      {
+        std::lock_guard lk(m_mutex);
+        const auto found = m_by_subject.find(dying);
+        if (found == m_by_subject.end())
+        {
+          return;
+        }
+        auto entries = std::move(found->second);
+        m_by_subject.erase(found);
+        for (const auto it : entries)
+        {
+          this->unlink(it, dying, trash);
+        }
+      }
+    }
+
+    // requires the registry mutex and the lock of the cache; the dying subject is not observed any more
+    void unlink(entry_iterator it, const subject* dying, entry_list& trash)
+    {
+      const auto [first, last] = m_index.equal_range(it->hash);
+      for (auto i = first; i != last; ++i)
+      {
+        if (i->second == it)
+        {
+          m_index.erase(i);
+          break;
+        }
+      }
+      for (std::size_t i = 0; i < it->keys.size(); ++i)
+      {
+        const auto* s = it->keys[i];
+        if (s == dying || !is_first_occurrence(it->keys, i))
+        {
+          continue;
+        }
+        const auto found = m_by_subject.find(s);
+        auto& entries = found->second;
+        entries.erase(std::find(entries.begin(), entries.end(), it));
+        if (entries.empty())
+        {
+          m_by_subject.erase(found);
+          s->unobserve(this);
+        }
+      }
+      trash.splice(trash.end(), m_entries, it);
+    }
+
+    [[nodiscard]]
+    static bool is_first_occurrence(const key_type& keys, std::size_t i) noexcept
+    {
+      return std::find(keys.begin(), keys.begin() + static_cast<std::ptrdiff_t>(i), keys[i]) == keys.begin() + static_cast<std::ptrdiff_t>(i);
+    }
+
+    const function_type m_function;
+    const size_type m_capacity;
+    mutable std::mutex m_mutex;
+    entry_list m_entries;
+    std::unordered_multimap<std::size_t, entry_iterator> m_index;
+    std::unordered_map<const subject*, std::vector<entry_iterator>> m_by_subject;
+  };
+} // end of namespace stdx
+
+#endif
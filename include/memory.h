@@ -62,6 +62,14 @@ namespace stdx
      */
     template<typename Traits, typename P>
     using has_decrement = decltype(Traits::decrement(std::declval<P>()));
+
+    /**
+     * \brief helps to detects whether template parameter Traits defines a function unique
+     * \tparam Traits template type parameter
+     * \note the signature of unique: bool unique(pointer type)
+     */
+    template<typename Traits, typename P>
+    using has_unique = decltype(Traits::unique(std::declval<P>()));
   } // end of namespace detail
 
   template<typename T> struct retain_traits;
@@ -84,8 +92,18 @@ namespace stdx
   protected:
     constexpr atomic_reference_count() noexcept = default;
 
+    // a copy is a new object, the reference count is not copied
+    constexpr atomic_reference_count(const atomic_reference_count&) noexcept
+    {
+    }
+
+    constexpr atomic_reference_count& operator=(const atomic_reference_count&) noexcept
+    {
+      return *this;
+    }
+
   private:
-    std::atomic<size_type> m_count{ 1 };
+    mutable std::atomic<size_type> m_count{ 1 };
   };
 
   /**
@@ -106,8 +124,18 @@ namespace stdx
   protected:
     constexpr reference_count() noexcept = default;
 
+    // a copy is a new object, the reference count is not copied
+    constexpr reference_count(const reference_count&) noexcept
+    {
+    }
+
+    constexpr reference_count& operator=(const reference_count&) noexcept
+    {
+      return *this;
+    }
+
   private:
-    size_type m_count{ 1 };
+    mutable size_type m_count{ 1 };
   };
 
   /**
@@ -136,6 +164,8 @@ namespace stdx
    *        atomic_reference_count<T> or reference_count. In the event that
    *        retain_traits is specialized for a type, the template parameter
    *        T may be an incomplete type.
+   *        The reference count is not a part of the observable state of the object,
+   *        hence T may be const qualified (e.g. retain_ptr<const T>).
    * \tparam T template type parameter
    * \note any user specialization of traits needs to define at least increment and decrement functions
    */
@@ -148,7 +178,7 @@ namespace stdx
     template<typename U
       requires_T(std::is_base_of_v<U, T>)
     >
-    static void increment(atomic_reference_count<U>* ptr) noexcept
+    static void increment(const atomic_reference_count<U>* ptr) noexcept
     {
       ptr->m_count.fetch_add(1, std::memory_order_relaxed);
     }
@@ -156,11 +186,11 @@ namespace stdx
     template<typename U
       requires_T(std::is_base_of_v<U, T>)
     >
-    static void decrement(atomic_reference_count<U>* ptr) noexcept
+    static void decrement(const atomic_reference_count<U>* ptr) noexcept
     {
       // gcc 12.1 complains about dereferencing a deleted ptr
-      // the static cast to T* is required before the first ptr->
-      auto t_ptr = static_cast<T*>(ptr);
+      // the static cast to const T* is required before the first ptr->
+      auto t_ptr = static_cast<const T*>(ptr);
       if (ptr->m_count.fetch_sub(1, std::memory_order_acq_rel) == 1)
       {
         delete t_ptr;
@@ -176,10 +206,23 @@ namespace stdx
       return ptr->m_count.load(std::memory_order_relaxed);
     }
 
+    /**
+     * \brief checks whether ptr is the only reference; the releases of the other references
+     *        happen before the return, the object may then be modified without synchronization
+     */
     template<typename U
       requires_T(std::is_base_of_v<U, T>)
     >
-    static void increment(reference_count<U>* ptr) noexcept
+    [[nodiscard]]
+    static bool unique(const atomic_reference_count<U>* ptr) noexcept
+    {
+      return ptr->m_count.load(std::memory_order_acquire) == 1;
+    }
+
+    template<typename U
+      requires_T(std::is_base_of_v<U, T>)
+    >
+    static void increment(const reference_count<U>* ptr) noexcept
     {
       ++ptr->m_count;
     }
@@ -187,11 +230,11 @@ namespace stdx
     template<typename U
       requires_T(std::is_base_of_v<U, T>)
     >
-    static void decrement(reference_count<U>* ptr) noexcept
+    static void decrement(const reference_count<U>* ptr) noexcept
     {
       // gcc 12.1 complains about dereferencing a deleted ptr
-      // the static cast to T* is required before the first ptr->
-      auto t_ptr = static_cast<T*>(ptr);
+      // the static cast to const T* is required before the first ptr->
+      auto t_ptr = static_cast<const T*>(ptr);
       if (--ptr->m_count == 0)
       {
         delete t_ptr;
@@ -205,6 +248,15 @@ namespace stdx
     {
       return ptr->m_count;
     }
+
+    template<typename U
+      requires_T(std::is_base_of_v<U, T>)
+    >
+    [[nodiscard]]
+    static bool unique(const reference_count<U>* ptr) noexcept
+    {
+      return ptr->m_count == 1;
+    }
   };
 
   /**
@@ -848,6 +900,16 @@ namespace stdx
   template<typename T>
   inline constexpr auto is_retain_ptr_v = is_retain_ptr<stdx::remove_cvref_t<T>>::value;
 
+  /**
+   * \brief retain_ptr holds a single pointer, moving it transfers the pointer and leaves the
+   *        source null: a retain_ptr may be relocated by copying its bytes if its pointer may be
+   */
+  template<typename T, typename Traits>
+  struct is_trivially_relocatable<retain_ptr<T, Traits>>
+    : is_trivially_relocatable<typename retain_ptr<T, Traits>::pointer>
+  {
+  };
+
   template<typename T, typename... Args>
   [[nodiscard]]
   retain_ptr<T> make_retain(Args&&... args)
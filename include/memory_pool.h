@@ -0,0 +1,156 @@
+#ifndef STDX_MEMORY_POOL_H
+#define STDX_MEMORY_POOL_H
+
+#include <cstddef>
+#include <new>
+
+namespace stdx
+{
+  /**
+   * \brief memory_pool is a size-class allocator with per-thread caches of free blocks,
+   *        intended for the small, frequently allocated control blocks (coroutine frames,
+   *        shared states of futures).
+   *
+   *        The sizes are rounded up to the granularity; a block freed by a thread is cached
+   *        by that thread and handed out again by its next allocation of the same size class,
+   *        without any synchronization. The blocks beyond the capacity of a cache, the blocks
+   *        larger than max_pooled_size and the blocks cached by an exiting thread are returned
+   *        to the global operator delete.
+   * \note a block may be freed by any thread, the size passed to deallocate must be the allocated one
+   */
+  class memory_pool
+  {
+  public:
+    static constexpr std::size_t granularity = 16;
+    static constexpr std::size_t max_pooled_size = 1024;
+    static constexpr std::size_t max_cached_blocks = 64;
+
+    memory_pool() = delete;
+
+    /**
+     * \brief allocates a block of at least size bytes, aligned as by the global operator new
+     */
+    [[nodiscard]]
+    static void* allocate(std::size_t size)
+    {
+      if (size <= max_pooled_size)
+      {
+        if (auto* c = cache(); c)
+        {
+          auto& list = c->lists[class_of(size)];
+          if (auto* block = list.head; block)
+          {
+            list.head = block->next;
+            --list.count;
+            return block;
+          }
+        }
+        return ::operator new(rounded(size));
+      }
+      return ::operator new(size);
+    }
+
+    /**
+     * \brief frees the block allocated by allocate(size)
+     */
+    static void deallocate(void* ptr, std::size_t size) noexcept
+    {
+      if (size <= max_pooled_size)
+      {
+        if (auto* c = cache(); c)
+        {
+          auto& list = c->lists[class_of(size)];
+          if (list.count < max_cached_blocks)
+          {
+            list.head = ::new (ptr) free_block{ list.head };
+            ++list.count;
+            return;
+          }
+        }
+      }
+      ::operator delete(ptr);
+    }
+
+  private:
+    static constexpr std::size_t class_count = max_pooled_size / granularity;
+
+    struct free_block
+    {
+      free_block* next;
+    };
+
+    struct free_list
+    {
+      free_block* head{ nullptr };
+      std::size_t count{ 0 };
+    };
+
+    struct thread_cache
+    {
+      thread_cache() = default;
+      thread_cache(const thread_cache&) = delete;
+      thread_cache& operator=(const thread_cache&) = delete;
+
+      ~thread_cache()
+      {
+        t_cache = nullptr;
+        t_exited = true;
+        for (auto& list : lists)
+        {
+          while (auto* block = list.head)
+          {
+            list.head = block->next;
+            ::operator delete(block);
+          }
+        }
+      }
+
+      free_list lists[class_count];
+    };
+
+    static constexpr std::size_t rounded(std::size_t size) noexcept
+    {
+      return size == 0 ? granularity : (size + granularity - 1) / granularity * granularity;
+    }
+
+    static constexpr std::size_t class_of(std::size_t size) noexcept
+    {
+      return rounded(size) / granularity - 1;
+    }
+
+    // the blocks freed during the destruction of the thread locals bypass the cache
+    static thread_cache* cache() noexcept
+    {
+      if (t_cache || t_exited)
+      {
+        return t_cache;
+      }
+      thread_local thread_cache c;
+      t_cache = &c;
+      return t_cache;
+    }
+
+    static inline thread_local thread_cache* t_cache = nullptr;
+    static inline thread_local bool t_exited = false;
+  };
+
+  /**
+   * \brief pool_allocated is a mixin type, provided for user defined types whose instances
+   *        are allocated from the memory_pool by new and delete.
+   */
+  struct pool_allocated
+  {
+    [[nodiscard]]
+    static void* operator new(std::size_t size)
+    {
+      return memory_pool::allocate(size);
+    }
+
+    static void operator delete(void* ptr, std::size_t size) noexcept
+    {
+      memory_pool::deallocate(ptr, size);
+    }
+  };
+} // end of namespace stdx
+
+#endif
@@ -0,0 +1,183 @@
+#ifndef STDX_MPSC_QUEUE_H
+#define STDX_MPSC_QUEUE_H
+
+#include "memory.h"
+#include "utils.h"
+
+#include <atomic>
+#include <type_traits>
+
+namespace stdx
+{
+  template<typename T, typename Traits> class mpsc_queue;
+
+  /**
+   * \brief queue_hook is an opt-in mixin type, which provides the link field
+   *        of the intrusive mpsc_queue. The link lives inside the retained object,
+   *        hence enqueueing the object requires no allocation.
+   * \note an object can be linked into one queue at a time
+   * \note the link is not a part of the value of the object; copying an object
+   *       does not copy its link
+   */
+  class queue_hook
+  {
+  public:
+    template<typename, typename>
+    friend class mpsc_queue;
+
+  protected:
+    constexpr queue_hook() noexcept = default;
+
+    queue_hook(const queue_hook&) noexcept
+    {
+    }
+
+    queue_hook& operator=(const queue_hook&) noexcept
+    {
+      return *this;
+    }
+
+    ~queue_hook() = default;
+
+  private:
+    std::atomic<queue_hook*> m_next{ nullptr };
+  };
+
+  /**
+   * \brief mpsc_queue is an intrusive, unbounded, lock-free multi-producer single-consumer
+   *        FIFO queue of retained objects (D. Vyukov's intrusive MPSC node-based queue).
+   *
+   *        push() transfers the ownership of the object from the retain_ptr to the queue
+   *        (retain_ptr::release()), pop() transfers it back (adopt_object). Enqueueing
+   *        neither allocates nor touches the reference count and costs a single atomic
+   *        exchange.
+   * \tparam T the type of the queued objects; T must derive from queue_hook
+   * \tparam Traits the traits suitable for type T
+   * \note pop() and empty() may be called by the single consumer thread only
+   * \note pop() may return nullptr while a concurrent push() is in progress
+   *       (the queue is not linearizable for the consumer)
+   */
+  template<typename T, typename Traits = retain_traits<T>>
+  class mpsc_queue
+  {
+    static_assert(std::is_base_of_v<queue_hook, T>,
+      "type T needs to derive from queue_hook.");
+
+  public:
+    using value_type = retain_ptr<T, Traits>;
+
+    /// @name Construction
+    /// @{
+
+    mpsc_queue() noexcept
+      : m_head(&m_stub)
+      , m_tail(&m_stub)
+    {
+    }
+
+    mpsc_queue(const mpsc_queue&) = delete;
+    mpsc_queue(mpsc_queue&&) = delete;
+    mpsc_queue& operator=(const mpsc_queue&) = delete;
+    mpsc_queue& operator=(mpsc_queue&&) = delete;
+
+    /**
+     * \brief destructor; releases all queued objects
+     */
+    ~mpsc_queue()
+    {
+      while (this->pop())
+      {
+      }
+    }
+
+    /// @}
+
+    /**
+     * \brief enqueues the object; the ownership is transferred to the queue
+     * \param value the object to enqueue; requires value != nullptr
+     * \note may be called by any thread
+     */
+    void push(value_type&& value) noexcept
+    {
+      this->push_hook(static_cast<queue_hook*>(value.release()));
+    }
+
+    /**
+     * \brief dequeues the oldest object; the ownership is transferred to the caller
+     * \return the dequeued object or nullptr if the queue is empty
+     */
+    [[nodiscard]]
+    value_type pop() noexcept
+    {
+      auto* tail = m_tail;
+      auto* next = tail->m_next.load(std::memory_order_acquire);
+      if (tail == &m_stub)
+      {
+        if (!next)
+        {
+          return {};
+        }
+        m_tail = next;
+        tail = next;
+        next = next->m_next.load(std::memory_order_acquire);
+      }
+
+      if (next)
+      {
+        m_tail = next;
+        return adopt(tail);
+      }
+
+      if (tail != m_head.load(std::memory_order_acquire))
+      {
+        // a producer has exchanged the head, but not linked its object yet
+        return {};
+      }
+
+      // tail is the last object; the stub is re-inserted to keep the queue non-empty
+      this->push_hook(&m_stub);
+      next = tail->m_next.load(std::memory_order_acquire);
+      if (next)
+      {
+        m_tail = next;
+        return adopt(tail);
+      }
+      return {};
+    }
+
+    /**
+     * \brief checks whether the queue is empty
+     * \note a concurrent push() may not be observed
+     */
+    [[nodiscard]]
+    bool empty() const noexcept
+    {
+      return m_tail == &m_stub && m_stub.m_next.load(std::memory_order_acquire) == nullptr;
+    }
+
+  private:
+    struct stub_hook : queue_hook
+    {
+    };
+
+    static value_type adopt(queue_hook* hook) noexcept
+    {
+      return value_type(static_cast<T*>(hook), adopt_object);
+    }
+
+    void push_hook(queue_hook* hook) noexcept
+    {
+      hook->m_next.store(nullptr, std::memory_order_relaxed);
+      auto* prev = m_head.exchange(hook, std::memory_order_acq_rel);
+      prev->m_next.store(hook, std::memory_order_release);
+    }
+
+    // written by the producers
+    alignas(cache_line_size) std::atomic<queue_hook*> m_head;
+    // owned by the consumer
+    alignas(cache_line_size) queue_hook* m_tail;
+    stub_hook m_stub;
+  };
+} // end of namespace stdx
+
+#endif
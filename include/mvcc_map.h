@@ -0,0 +1,539 @@
+#ifndef STDX_MVCC_MAP_H
+#define STDX_MVCC_MAP_H
+
+#include "memory.h"
+#include "utils.h"
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace stdx
+{
+  /**
+   * \brief mvcc_map is a multi-version concurrent map whose values are immutable
+   *        retained objects (retain_ptr<const V, Traits>).
+   *
+   *        Every commit stamps the written values with a new commit sequence.
+   *        A reader pins a sequence by taking a snapshot and observes the state
+   *        of the map as of that sequence: the lookups of a snapshot neither take
+   *        a lock nor block the writers, and the writers never block the snapshots.
+   *
+   *        The writers are serialized. After a commit the versions superseded before
+   *        the oldest pinned sequence (the collection horizon) are released; a version
+   *        newer than the horizon is kept until the snapshots pinning the horizon are gone.
+   * \tparam K the key type
+   * \tparam V the type of the retained values
+   * \tparam Hash the hash function of the key type
+   * \tparam KeyEqual the equality predicate of the key type
+   * \tparam Traits the traits suitable for type const V
+   * \note the number of buckets is fixed at construction (the index is never rehashed)
+   * \note keys are never removed from the index, an erased key is represented by a null version
+   * \note a snapshot must not outlive the map it was taken from
+   */
+  template<typename K, typename V,
+    typename Hash = std::hash<K>,
+    typename KeyEqual = std::equal_to<K>,
+    typename Traits = retain_traits<const V>>
+  class mvcc_map
+  {
+  public:
+    using key_type = K;
+    using value_type = V;
+    using value_pointer = retain_ptr<const V, Traits>;
+    using hasher = Hash;
+    using key_equal = KeyEqual;
+    using size_type = std::size_t;
+    using sequence_type = std::uint64_t;
+
+    class snapshot;
+    class write_batch;
+
+    /// @name Construction
+    /// @{
+
+    /**
+     * \brief Constructs an empty map
+     * \param bucket_count the number of buckets of the index (rounded up to a power of two)
+     */
+    explicit mvcc_map(size_type bucket_count = 1024)
+      : m_mask(detail::round_up_to_power_of_two(bucket_count) - 1)
+      , m_buckets(std::make_unique<std::atomic<entry*>[]>(m_mask + 1))
+    {
+    }
+
+    mvcc_map(const mvcc_map&) = delete;
+    mvcc_map(mvcc_map&&) = delete;
+    mvcc_map& operator=(const mvcc_map&) = delete;
+    mvcc_map& operator=(mvcc_map&&) = delete;
+
+    ~mvcc_map()
+    {
+      for (size_type i = 0; i <= m_mask; ++i)
+      {
+        auto* e = m_buckets[i].load(std::memory_order_relaxed);
+        while (e)
+        {
+          auto* next = e->next;
+          delete_versions(e->head.load(std::memory_order_relaxed));
+          delete e;
+          e = next;
+        }
+      }
+
+      auto* r = m_pins.load(std::memory_order_relaxed);
+      while (r)
+      {
+        auto* next = r->next;
+        delete r;
+        r = next;
+      }
+    }
+
+    /// @}
+
+    /// @name Writers
+    /// @{
+
+    /**
+     * \brief atomically commits all writes of the batch
+     * \param batch the writes to commit
+     * \return the commit sequence of the batch
+     */
+    sequence_type commit(write_batch batch)
+    {
+      std::lock_guard lk(m_write_mutex);
+      const auto seq = m_committed.load(std::memory_order_relaxed) + 1;
+      for (auto& [key, value] : batch.m_writes)
+      {
+        auto* e = this->find_or_insert(key);
+        auto* head = e->head.load(std::memory_order_relaxed);
+        e->head.store(new version{ seq, std::move(value), head }, std::memory_order_release);
+        if (head && !e->pending)
+        {
+          e->pending = true;
+          m_pending.push_back(e);
+        }
+      }
+      // publishes the commit; the snapshots taken from now on observe all writes of the batch
+      m_committed.store(seq, std::memory_order_seq_cst);
+      this->collect_locked();
+      return seq;
+    }
+
+    /**
+     * \brief commits a single write
+     * \param key the key of the value
+     * \param value the value; nullptr erases the key
+     * \return the commit sequence of the write
+     */
+    sequence_type put(const key_type& key, value_pointer value)
+    {
+      write_batch batch;
+      batch.put(key, std::move(value));
+      return this->commit(std::move(batch));
+    }
+
+    /**
+     * \brief commits an erasure of the key
+     * \param key the key to erase
+     * \return the commit sequence of the erasure
+     */
+    sequence_type erase(const key_type& key)
+    {
+      return this->put(key, nullptr);
+    }
+
+    /**
+     * \brief releases the versions superseded before the oldest pinned sequence
+     * \note called implicitly by every commit
+     */
+    void collect()
+    {
+      std::lock_guard lk(m_write_mutex);
+      this->collect_locked();
+    }
+
+    /// @}
+
+    /// @name Readers
+    /// @{
+
+    /**
+     * \brief pins the last committed sequence
+     * \return the snapshot of the map as of the last commit
+     */
+    [[nodiscard]]
+    snapshot make_snapshot() const
+    {
+      return snapshot(*this);
+    }
+
+    /**
+     * \brief returns the last committed value of the key
+     * \param key the key to look up
+     * \return the value or nullptr if the key is not present
+     */
+    [[nodiscard]]
+    value_pointer get(const key_type& key) const
+    {
+      return this->make_snapshot().get(key);
+    }
+
+    /**
+     * \brief returns the sequence of the last commit
+     */
+    [[nodiscard]]
+    sequence_type committed() const noexcept
+    {
+      return m_committed.load(std::memory_order_acquire);
+    }
+
+    /// @}
+
+  private:
+    static constexpr sequence_type unpinned = std::numeric_limits<sequence_type>::max();
+
+    struct version
+    {
+      sequence_type seq;
+      value_pointer value;
+      std::atomic<version*> older;
+    };
+
+    struct entry
+    {
+      entry(const key_type& k, entry* n)
+        : key(k)
+        , next(n)
+      {
+      }
+
+      const key_type key;
+      std::atomic<version*> head{ nullptr };
+      entry* const next;
+      // touched by the (serialized) writers only
+      bool pending{ false };
+    };
+
+    struct alignas(cache_line_size) pin_record
+    {
+      std::atomic<sequence_type> seq{ unpinned };
+      std::atomic<bool> used{ true };
+      pin_record* next{ nullptr };
+    };
+
+    static void delete_versions(version* v) noexcept
+    {
+      while (v)
+      {
+        auto* older = v->older.load(std::memory_order_relaxed);
+        delete v;
+        v = older;
+      }
+    }
+
+    std::atomic<entry*>& bucket(const key_type& key) const
+    {
+      return m_buckets[hasher{}(key) & m_mask];
+    }
+
+    const entry* find(const key_type& key) const
+    {
+      for (auto* e = this->bucket(key).load(std::memory_order_acquire); e; e = e->next)
+      {
+        if (key_equal{}(e->key, key))
+        {
+          return e;
+        }
+      }
+      return nullptr;
+    }
+
+    entry* find_or_insert(const key_type& key)
+    {
+      auto& b = this->bucket(key);
+      auto* first = b.load(std::memory_order_relaxed);
+      for (auto* e = first; e; e = e->next)
+      {
+        if (key_equal{}(e->key, key))
+        {
+          return e;
+        }
+      }
+      auto* e = new entry(key, first);
+      b.store(e, std::memory_order_release);
+      return e;
+    }
+
+    pin_record* pin() const
+    {
+      pin_record* record = nullptr;
+      for (auto* r = m_pins.load(std::memory_order_acquire); r; r = r->next)
+      {
+        if (!r->used.load(std::memory_order_relaxed) && !r->used.exchange(true, std::memory_order_acquire))
+        {
+          record = r;
+          break;
+        }
+      }
+
+      if (!record)
+      {
+        record = new pin_record;
+        auto* head = m_pins.load(std::memory_order_relaxed);
+        do
+        {
+          record->next = head;
+        } while (!m_pins.compare_exchange_weak(head, record, std::memory_order_release, std::memory_order_relaxed));
+      }
+
+      // publish the pin and validate it against the commit sequence; a collector
+      // which has not observed the pin has read a commit sequence not newer than it
+      auto seq = m_committed.load(std::memory_order_seq_cst);
+      for (;;)
+      {
+        record->seq.store(seq, std::memory_order_seq_cst);
+        const auto current = m_committed.load(std::memory_order_seq_cst);
+        if (current == seq)
+        {
+          return record;
+        }
+        seq = current;
+      }
+    }
+
+    static void unpin(pin_record* record) noexcept
+    {
+      record->seq.store(unpinned, std::memory_order_release);
+      record->used.store(false, std::memory_order_release);
+    }
+
+    void collect_locked()
+    {
+      auto threshold = m_committed.load(std::memory_order_seq_cst);
+      for (auto* r = m_pins.load(std::memory_order_acquire); r; r = r->next)
+      {
+        const auto seq = r->seq.load(std::memory_order_seq_cst);
+        if (seq < threshold)
+        {
+          threshold = seq;
+        }
+      }
+
+      auto it = m_pending.begin();
+      while (it != m_pending.end())
+      {
+        auto* e = *it;
+        // the first version observable by the oldest snapshot; the older ones are not observable at all
+        auto* v = e->head.load(std::memory_order_relaxed);
+        while (v && v->seq > threshold)
+        {
+          v = v->older.load(std::memory_order_relaxed);
+        }
+
+        if (v)
+        {
+          delete_versions(v->older.exchange(nullptr, std::memory_order_relaxed));
+        }
+
+        if (e->head.load(std::memory_order_relaxed)->older.load(std::memory_order_relaxed) == nullptr)
+        {
+          e->pending = false;
+          *it = m_pending.back();
+          m_pending.pop_back();
+        }
+        else
+        {
+          ++it;
+        }
+      }
+    }
+
+    const size_type m_mask;
+    const std::unique_ptr<std::atomic<entry*>[]> m_buckets;
+    alignas(cache_line_size) std::atomic<sequence_type> m_committed{ 0 };
+    mutable std::atomic<pin_record*> m_pins{ nullptr };
+    alignas(cache_line_size) std::mutex m_write_mutex;
+    std::vector<entry*> m_pending;
+  };
+
+  /**
+   * \brief the set of writes committed atomically by mvcc_map::commit
+   */
+  template<typename K, typename V, typename Hash, typename KeyEqual, typename Traits>
+  class mvcc_map<K, V, Hash, KeyEqual, Traits>::write_batch
+  {
+  public:
+    /**
+     * \brief records a write of the value
+     * \param key the key of the value
+     * \param value the value; nullptr erases the key
+     */
+    void put(key_type key, value_pointer value)
+    {
+      m_writes.emplace_back(std::move(key), std::move(value));
+    }
+
+    /**
+     * \brief records an erasure of the key
+     * \param key the key to erase
+     */
+    void erase(key_type key)
+    {
+      m_writes.emplace_back(std::move(key), nullptr);
+    }
+
+    [[nodiscard]]
+    bool empty() const noexcept
+    {
+      return m_writes.empty();
+    }
+
+    [[nodiscard]]
+    size_type size() const noexcept
+    {
+      return m_writes.size();
+    }
+
+  private:
+    friend class mvcc_map;
+
+    std::vector<std::pair<key_type, value_pointer>> m_writes;
+  };
+
+  /**
+   * \brief the consistent view of the map as of the pinned commit sequence
+   */
+  template<typename K, typename V, typename Hash, typename KeyEqual, typename Traits>
+  class mvcc_map<K, V, Hash, KeyEqual, Traits>::snapshot
+  {
+  public:
+    snapshot(const snapshot&) = delete;
+    snapshot& operator=(const snapshot&) = delete;
+
+    snapshot(snapshot&& other) noexcept
+      : m_map(other.m_map)
+      , m_record(std::exchange(other.m_record, nullptr))
+      , m_seq(other.m_seq)
+    {
+    }
+
+    snapshot& operator=(snapshot&& other) noexcept
+    {
+      if (&other != this)
+      {
+        this->release();
+        m_map = other.m_map;
+        m_record = std::exchange(other.m_record, nullptr);
+        m_seq = other.m_seq;
+      }
+      return *this;
+    }
+
+    ~snapshot()
+    {
+      this->release();
+    }
+
+    /**
+     * \brief returns the pinned commit sequence
+     */
+    [[nodiscard]]
+    sequence_type sequence() const noexcept
+    {
+      return m_seq;
+    }
+
+    /**
+     * \brief returns the value of the key as of the pinned sequence
+     * \param key the key to look up
+     * \return the value or nullptr if the key is not present
+     */
+    [[nodiscard]]
+    value_pointer get(const key_type& key) const
+    {
+      const auto* v = this->find_version(key);
+      return v ? v->value : value_pointer{};
+    }
+
+    /**
+     * \brief returns the borrowed value of the key as of the pinned sequence
+     * \param key the key to look up
+     * \return the pointer to the value or nullptr if the key is not present;
+     *         the pointer is valid as long as the snapshot
+     * \note does not touch the reference count of the value
+     */
+    [[nodiscard]]
+    const value_type* find(const key_type& key) const
+    {
+      const auto* v = this->find_version(key);
+      return v ? v->value.get() : nullptr;
+    }
+
+    /**
+     * \brief invokes f(key, value) for every key present as of the pinned sequence
+     * \param f the function invoked with (const key_type&, const value_type&)
+     */
+    template<typename F>
+    void for_each(F f) const
+    {
+      for (size_type i = 0; i <= m_map->m_mask; ++i)
+      {
+        for (auto* e = m_map->m_buckets[i].load(std::memory_order_acquire); e; e = e->next)
+        {
+          if (const auto* v = this->visible(e); v && v->value)
+          {
+            f(e->key, *v->value);
+          }
+        }
+      }
+    }
+
+  private:
+    friend class mvcc_map;
+
+    explicit snapshot(const mvcc_map& map)
+      : m_map(&map)
+      , m_record(map.pin())
+      , m_seq(m_record->seq.load(std::memory_order_relaxed))
+    {
+    }
+
+    const version* visible(const entry* e) const noexcept
+    {
+      auto* v = e->head.load(std::memory_order_acquire);
+      while (v && v->seq > m_seq)
+      {
+        v = v->older.load(std::memory_order_acquire);
+      }
+      return v;
+    }
+
+    const version* find_version(const key_type& key) const
+    {
+      const auto* e = m_map->find(key);
+      return e ? this->visible(e) : nullptr;
+    }
+
+    void release() noexcept
+    {
+      if (m_record)
+      {
+        unpin(m_record);
+        m_record = nullptr;
+      }
+    }
+
+    const mvcc_map* m_map;
+    pin_record* m_record;
+    sequence_type m_seq;
+  };
+} // end of namespace stdx
+
+#endif
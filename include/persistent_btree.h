@@ -0,0 +1,844 @@
+#ifndef STDX_PERSISTENT_BTREE_H
+#define STDX_PERSISTENT_BTREE_H
+
+#include "cow_ptr.h"
+#include "memory.h"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <new>
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace stdx
+{
+  namespace detail
+  {
+    /**
+     * \brief a vector of at most N elements stored inline
+     * \note the insertions require size() < N
+     */
+    template<typename T, std::size_t N>
+    class static_vector
+    {
+    public:
+      using value_type = T;
+      using size_type = std::size_t;
+      using iterator = T*;
+      using const_iterator = const T*;
+
+      static_vector() noexcept = default;
+
+      static_vector(const static_vector& other)
+      {
+        for (const auto& value : other)
+        {
+          this->emplace_back(value);
+        }
+      }
+
+      static_vector& operator=(const static_vector&) = delete;
+
+      ~static_vector()
+      {
+        this->clear();
+      }
+
+      [[nodiscard]]
+      size_type size() const noexcept
+      {
+        return m_size;
+      }
+
+      [[nodiscard]]
+      bool empty() const noexcept
+      {
+        return m_size == 0;
+      }
+
+      [[nodiscard]]
+      T* data() noexcept
+      {
+        return std::launder(reinterpret_cast<T*>(m_storage));
+      }
+
+      [[nodiscard]]
+      const T* data() const noexcept
+      {
+        return std::launder(reinterpret_cast<const T*>(m_storage));
+      }
+
+      iterator begin() noexcept
+      {
+        return this->data();
+      }
+
+      iterator end() noexcept
+      {
+        return this->data() + m_size;
+      }
+
+      const_iterator begin() const noexcept
+      {
+        return this->data();
+      }
+
+      const_iterator end() const noexcept
+      {
+        return this->data() + m_size;
+      }
+
+      T& operator[](size_type i) noexcept
+      {
+        return this->data()[i];
+      }
+
+      const T& operator[](size_type i) const noexcept
+      {
+        return this->data()[i];
+      }
+
+      T& front() noexcept
+      {
+        return this->data()[0];
+      }
+
+      const T& front() const noexcept
+      {
+        return this->data()[0];
+      }
+
+      T& back() noexcept
+      {
+        return this->data()[m_size - 1];
+      }
+
+      const T& back() const noexcept
+      {
+        return this->data()[m_size - 1];
+      }
+
+      template<typename... Args>
+      T& emplace_back(Args&&... args)
+      {
+        auto* p = ::new (static_cast<void*>(this->end())) T(std::forward<Args>(args)...);
+        ++m_size;
+        return *p;
+      }
+
+      void push_back(const T& value)
+      {
+        this->emplace_back(value);
+      }
+
+      void push_back(T&& value)
+      {
+        this->emplace_back(std::move(value));
+      }
+
+      void pop_back() noexcept
+      {
+        --m_size;
+        this->end()->~T();
+      }
+
+      template<typename... Args>
+      iterator emplace(const_iterator pos, Args&&... args)
+      {
+        const auto i = static_cast<size_type>(pos - this->begin());
+        T value(std::forward<Args>(args)...);
+        if (i == m_size)
+        {
+          this->emplace_back(std::move(value));
+        }
+        else
+        {
+          this->emplace_back(std::move(this->back()));
+          std::move_backward(this->begin() + i, this->end() - 2, this->end() - 1);
+          (*this)[i] = std::move(value);
+        }
+        return this->begin() + i;
+      }
+
+      iterator insert(const_iterator pos, T&& value)
+      {
+        return this->emplace(pos, std::move(value));
+      }
+
+      iterator erase(const_iterator pos)
+      {
+        return this->erase(pos, pos + 1);
+      }
+
+      iterator erase(const_iterator first, const_iterator last)
+      {
+        const auto f = this->begin() + (first - this->begin());
+        const auto new_end = std::move(this->begin() + (last - this->begin()), this->end(), f);
+        while (this->end() != new_end)
+        {
+          this->pop_back();
+        }
+        return f;
+      }
+
+      template<typename InputIt>
+      void assign(InputIt first, InputIt last)
+      {
+        this->clear();
+        for (; first != last; ++first)
+        {
+          this->emplace_back(*first);
+        }
+      }
+
+      void clear() noexcept
+      {
+        while (m_size != 0)
+        {
+          this->pop_back();
+        }
+      }
+
+    private:
+      size_type m_size{ 0 };
+      alignas(T) unsigned char m_storage[N * sizeof(T)];
+    };
+
+    /**
+     * \brief a node of a B+tree: a leaf holds the sorted entries, an internal node holds
+     *        its children and the separator keys, keys[i] being the smallest key of children[i + 1].
+     *        The entries, or the keys and the children, are stored inline: a node is a single
+     *        allocation and a search does not leave it before descending to the next node.
+     */
+    template<typename K, typename V>
+    struct btree_node : atomic_reference_count<btree_node<K, V>>
+    {
+      using node_pointer = retain_ptr<btree_node>;
+
+      static constexpr std::size_t max_size = 32;
+      // a node overflows by one element before it is split
+      static constexpr std::size_t capacity = max_size + 1;
+
+      using entries_type = static_vector<std::pair<K, V>, capacity>;
+
+      struct inner_part
+      {
+        static_vector<K, capacity> keys;
+        static_vector<node_pointer, capacity> children;
+      };
+
+      explicit btree_node(bool is_leaf) noexcept
+        : leaf(is_leaf)
+      {
+        if (leaf)
+        {
+          ::new (static_cast<void*>(&entries)) entries_type();
+        }
+        else
+        {
+          ::new (static_cast<void*>(&inner)) inner_part();
+        }
+      }
+
+      btree_node(const btree_node& other)
+        : atomic_reference_count<btree_node>(other)
+        , leaf(other.leaf)
+      {
+        if (leaf)
+        {
+          ::new (static_cast<void*>(&entries)) entries_type(other.entries);
+        }
+        else
+        {
+          ::new (static_cast<void*>(&inner)) inner_part(other.inner);
+        }
+      }
+
+      btree_node& operator=(const btree_node&) = delete;
+
+      ~btree_node()
+      {
+        if (leaf)
+        {
+          entries.~entries_type();
+        }
+        else
+        {
+          inner.~inner_part();
+        }
+      }
+
+      [[nodiscard]]
+      std::size_t size() const noexcept
+      {
+        return leaf ? entries.size() : inner.children.size();
+      }
+
+      const bool leaf;
+      union
+      {
+        entries_type entries;
+        inner_part inner;
+      };
+    };
+  } // end of namespace detail
+
+  /**
+   * \brief persistent_btree is an immutable ordered map implemented as a B+tree of retained nodes.
+   *
+   *        The nodes hold up to 32 entries or children inline, each node being a single allocation.
+   *        An update copies the nodes on the path to the key (and the sibling it rebalances with)
+   *        and shares all other nodes with the previous version; copying a map (a snapshot) is O(1). The iterators walk the tree by plain
+   *        pointers and do not retain the nodes they visit.
+   * \tparam K the key type
+   * \tparam V the mapped type
+   * \tparam Compare the ordering of the keys
+   * \note an iterator is valid as long as the version it was obtained from is alive
+   * \note the versions may be read concurrently
+   */
+  template<typename K, typename V, typename Compare = std::less<K>>
+  class persistent_btree
+  {
+    using node = detail::btree_node<K, V>;
+    using node_pointer = typename node::node_pointer;
+
+    static constexpr std::size_t max_size = node::max_size;
+    static constexpr std::size_t min_size = max_size / 2;
+    // the depth of a tree with min_size children per node exceeds the addressable size first
+    static constexpr std::size_t max_depth = 16;
+
+  public:
+    using key_type = K;
+    using mapped_type = V;
+    using value_type = std::pair<K, V>;
+    using key_compare = Compare;
+    using size_type = std::size_t;
+
+    class const_iterator;
+    using iterator = const_iterator;
+
+    /// @name Construction
+    /// @{
+
+    explicit persistent_btree(const Compare& less = Compare())
+      : m_less(less)
+    {
+    }
+
+    persistent_btree(const persistent_btree&) = default;
+    persistent_btree(persistent_btree&&) noexcept = default;
+    persistent_btree& operator=(const persistent_btree&) = default;
+    persistent_btree& operator=(persistent_btree&&) noexcept = default;
+
+    ~persistent_btree() = default;
+
+    /// @}
+
+    /**
+     * \brief builds a map from the entries of [first, last) bottom-up, the nodes being filled evenly
+     * \param first, last the range of entries convertible to value_type;
+     *        requires the keys to be sorted and unique with respect to less
+     * \param less the ordering of the keys
+     */
+    template<typename InputIt>
+    [[nodiscard]]
+    static persistent_btree from_sorted(InputIt first, InputIt last, const Compare& less = Compare())
+    {
+      persistent_btree result(less);
+      std::vector<value_type> entries(first, last);
+      result.m_size = entries.size();
+      if (entries.empty())
+      {
+        return result;
+      }
+
+      // the level being built: the nodes and their smallest keys
+      std::vector<std::pair<node_pointer, K>> level;
+      const auto leaf_count = (entries.size() + max_size - 1) / max_size;
+      auto it = std::make_move_iterator(entries.begin());
+      for (std::size_t i = 0; i < leaf_count; ++i)
+      {
+        auto leaf = make_retain<node>(true);
+        const auto count = entries.size() / leaf_count + (i < entries.size() % leaf_count ? 1 : 0);
+        leaf->entries.assign(it, it + static_cast<std::ptrdiff_t>(count));
+        it += static_cast<std::ptrdiff_t>(count);
+        auto first_key = leaf->entries.front().first;
+        level.emplace_back(std::move(leaf), std::move(first_key));
+      }
+
+      while (level.size() > 1)
+      {
+        std::vector<std::pair<node_pointer, K>> parents;
+        const auto parent_count = (level.size() + max_size - 1) / max_size;
+        auto child = level.begin();
+        for (std::size_t i = 0; i < parent_count; ++i)
+        {
+          auto parent = make_retain<node>(false);
+          const auto count = level.size() / parent_count + (i < level.size() % parent_count ? 1 : 0);
+          auto first_key = child->second;
+          for (std::size_t c = 0; c < count; ++c, ++child)
+          {
+            if (c != 0)
+            {
+              parent->inner.keys.push_back(std::move(child->second));
+            }
+            parent->inner.children.push_back(std::move(child->first));
+          }
+          parents.emplace_back(std::move(parent), std::move(first_key));
+        }
+        level = std::move(parents);
+      }
+      result.m_root = std::move(level.front().first);
+      return result;
+    }
+
+    /**
+     * \brief returns the version of the map with key mapped to value
+     */
+    [[nodiscard]]
+    persistent_btree set(K key, V value) const
+    {
+      auto result = *this;
+      result.assign(std::move(key), std::move(value));
+      return result;
+    }
+
+    /**
+     * \brief returns the version of the map without key
+     */
+    [[nodiscard]]
+    persistent_btree erase(const K& key) const
+    {
+      auto result = *this;
+      result.remove(key);
+      return result;
+    }
+
+    /**
+     * \brief returns the value mapped to key, nullptr if the key is not in the map
+     * \note the pointer is valid as long as this version of the map is alive
+     */
+    [[nodiscard]]
+    const V* find(const K& key) const
+    {
+      const auto* n = m_root.get();
+      if (!n)
+      {
+        return nullptr;
+      }
+      while (!n->leaf)
+      {
+        n = n->inner.children[this->child_index(*n, key)].get();
+      }
+      const auto it = this->leaf_lower_bound(*n, key);
+      return it != n->entries.end() && !m_less(key, it->first) ? &it->second : nullptr;
+    }
+
+    [[nodiscard]]
+    bool contains(const K& key) const
+    {
+      return this->find(key) != nullptr;
+    }
+
+    [[nodiscard]]
+    const_iterator begin() const noexcept
+    {
+      const_iterator it;
+      if (m_root)
+      {
+        it.descend_leftmost(m_root.get());
+        it.skip_exhausted_leaf();
+      }
+      return it;
+    }
+
+    [[nodiscard]]
+    const_iterator end() const noexcept
+    {
+      return const_iterator();
+    }
+
+    /**
+     * \brief returns the iterator to the first entry whose key is not less than key
+     */
+    [[nodiscard]]
+    const_iterator lower_bound(const K& key) const
+    {
+      return this->seek(key, false);
+    }
+
+    /**
+     * \brief returns the iterator to the first entry whose key is greater than key
+     */
+    [[nodiscard]]
+    const_iterator upper_bound(const K& key) const
+    {
+      return this->seek(key, true);
+    }
+
+    /**
+     * \brief invokes f(key, value) for the entries whose keys are in [first, last), in order
+     */
+    template<typename F>
+    void for_each_in_range(const K& first, const K& last, F f) const
+    {
+      for (auto it = this->lower_bound(first); it != this->end() && m_less(it->first, last); ++it)
+      {
+        f(it->first, it->second);
+      }
+    }
+
+    [[nodiscard]]
+    size_type size() const noexcept
+    {
+      return m_size;
+    }
+
+    [[nodiscard]]
+    bool empty() const noexcept
+    {
+      return m_size == 0;
+    }
+
+    /**
+     * \brief checks whether the map shares its root with other
+     */
+    [[nodiscard]]
+    bool shares_root_with(const persistent_btree& other) const noexcept
+    {
+      return m_root == other.m_root;
+    }
+
+  private:
+    struct split_result
+    {
+      node_pointer right;
+      K separator;
+    };
+
+    [[nodiscard]]
+    std::size_t child_index(const node& n, const K& key) const
+    {
+      return static_cast<std::size_t>(std::upper_bound(n.inner.keys.begin(), n.inner.keys.end(), key, m_less) - n.inner.keys.begin());
+    }
+
+    template<typename Node>
+    [[nodiscard]]
+    auto leaf_lower_bound(Node& n, const K& key) const
+    {
+      return std::lower_bound(n.entries.begin(), n.entries.end(), key,
+        [this](const value_type& e, const K& k) { return m_less(e.first, k); });
+    }
+
+    [[nodiscard]]
+    const_iterator seek(const K& key, bool past_equal) const
+    {
+      const_iterator it;
+      const auto* n = m_root.get();
+      if (!n)
+      {
+        return it;
+      }
+      while (!n->leaf)
+      {
+        const auto i = this->child_index(*n, key);
+        it.push(n, i);
+        n = n->inner.children[i].get();
+      }
+      auto pos = this->leaf_lower_bound(*n, key);
+      if (past_equal && pos != n->entries.end() && !m_less(key, pos->first))
+      {
+        ++pos;
+      }
+      it.push(n, static_cast<std::size_t>(pos - n->entries.begin()));
+      it.skip_exhausted_leaf();
+      return it;
+    }
+
+    // the nodes on the path are made unique by make_mut: a node shared with another version
+    // is copied, a node owned by this map only is modified in place
+    void assign(K key, V value)
+    {
+      if (!m_root)
+      {
+        m_root = make_retain<node>(true);
+      }
+      bool inserted = false;
+      if (auto split = this->assign(m_root, std::move(key), std::move(value), inserted); split)
+      {
+        auto root = make_retain<node>(false);
+        root->inner.keys.push_back(std::move(split->separator));
+        root->inner.children.push_back(std::move(m_root));
+        root->inner.children.push_back(std::move(split->right));
+        m_root = std::move(root);
+      }
+      if (inserted)
+      {
+        ++m_size;
+      }
+    }
+
+    std::optional<split_result> assign(node_pointer& slot, K&& key, V&& value, bool& inserted)
+    {
+      auto& n = make_mut(slot);
+      if (n.leaf)
+      {
+        const auto pos = this->leaf_lower_bound(n, key);
+        if (pos != n.entries.end() && !m_less(key, pos->first))
+        {
+          pos->second = std::move(value);
+          return std::nullopt;
+        }
+        n.entries.emplace(pos, std::move(key), std::move(value));
+        inserted = true;
+        if (n.entries.size() <= max_size)
+        {
+          return std::nullopt;
+        }
+
+        auto right = make_retain<node>(true);
+        const auto half = static_cast<std::ptrdiff_t>(n.entries.size() / 2);
+        right->entries.assign(std::make_move_iterator(n.entries.begin() + half), std::make_move_iterator(n.entries.end()));
+        n.entries.erase(n.entries.begin() + half, n.entries.end());
+        auto separator = right->entries.front().first;
+        return split_result{ std::move(right), std::move(separator) };
+      }
+
+      const auto i = this->child_index(n, key);
+      auto split = this->assign(n.inner.children[i], std::move(key), std::move(value), inserted);
+      if (!split)
+      {
+        return std::nullopt;
+      }
+      n.inner.keys.insert(n.inner.keys.begin() + static_cast<std::ptrdiff_t>(i), std::move(split->separator));
+      n.inner.children.insert(n.inner.children.begin() + static_cast<std::ptrdiff_t>(i + 1), std::move(split->right));
+      if (n.inner.children.size() <= max_size)
+      {
+        return std::nullopt;
+      }
+
+      // the left node keeps half of the children, the key between the halves moves up
+      auto right = make_retain<node>(false);
+      const auto half = static_cast<std::ptrdiff_t>(n.inner.children.size() / 2);
+      right->inner.children.assign(std::make_move_iterator(n.inner.children.begin() + half), std::make_move_iterator(n.inner.children.end()));
+      right->inner.keys.assign(std::make_move_iterator(n.inner.keys.begin() + half), std::make_move_iterator(n.inner.keys.end()));
+      auto separator = std::move(n.inner.keys[static_cast<std::size_t>(half - 1)]);
+      n.inner.children.erase(n.inner.children.begin() + half, n.inner.children.end());
+      n.inner.keys.erase(n.inner.keys.begin() + half - 1, n.inner.keys.end());
+      return split_result{ std::move(right), std::move(separator) };
+    }
+
+    void remove(const K& key)
+    {
+      if (!this->contains(key))
+      {
+        return;
+      }
+      this->remove(m_root, key);
+      --m_size;
+      if (m_root->leaf && m_root->entries.empty())
+      {
+        m_root.reset();
+      }
+      else if (!m_root->leaf && m_root->inner.children.size() == 1)
+      {
+        auto child = std::move(m_root->inner.children.front());
+        m_root = std::move(child);
+      }
+    }
+
+    // requires the key to be in the subtree of slot
+    void remove(node_pointer& slot, const K& key)
+    {
+      auto& n = make_mut(slot);
+      if (n.leaf)
+      {
+        n.entries.erase(this->leaf_lower_bound(n, key));
+        return;
+      }
+
+      const auto i = this->child_index(n, key);
+      this->remove(n.inner.children[i], key);
+      if (n.inner.children[i]->size() < min_size)
+      {
+        this->rebalance(n, i);
+      }
+    }
+
+    // refills the underflowing child i from a sibling or merges it with the sibling
+    void rebalance(node& parent, std::size_t i)
+    {
+      const auto left_index = i > 0 ? i - 1 : i;
+      auto& left = make_mut(parent.inner.children[left_index]);
+      auto& right = make_mut(parent.inner.children[left_index + 1]);
+      auto& separator = parent.inner.keys[left_index];
+
+      if (left.size() + right.size() <= max_size)
+      {
+        if (left.leaf)
+        {
+          std::move(right.entries.begin(), right.entries.end(), std::back_inserter(left.entries));
+        }
+        else
+        {
+          left.inner.keys.push_back(std::move(separator));
+          std::move(right.inner.keys.begin(), right.inner.keys.end(), std::back_inserter(left.inner.keys));
+          std::move(right.inner.children.begin(), right.inner.children.end(), std::back_inserter(left.inner.children));
+        }
+        parent.inner.keys.erase(parent.inner.keys.begin() + static_cast<std::ptrdiff_t>(left_index));
+        parent.inner.children.erase(parent.inner.children.begin() + static_cast<std::ptrdiff_t>(left_index + 1));
+        return;
+      }
+
+      if (left.size() > right.size())
+      {
+        // moves the last entry or child of left to the front of right
+        if (left.leaf)
+        {
+          right.entries.insert(right.entries.begin(), std::move(left.entries.back()));
+          left.entries.pop_back();
+          separator = right.entries.front().first;
+        }
+        else
+        {
+          right.inner.keys.insert(right.inner.keys.begin(), std::move(separator));
+          right.inner.children.insert(right.inner.children.begin(), std::move(left.inner.children.back()));
+          separator = std::move(left.inner.keys.back());
+          left.inner.keys.pop_back();
+          left.inner.children.pop_back();
+        }
+      }
+      else
+      {
+        // moves the first entry or child of right to the back of left
+        if (left.leaf)
+        {
+          left.entries.push_back(std::move(right.entries.front()));
+          right.entries.erase(right.entries.begin());
+          separator = right.entries.front().first;
+        }
+        else
+        {
+          left.inner.keys.push_back(std::move(separator));
+          left.inner.children.push_back(std::move(right.inner.children.front()));
+          separator = std::move(right.inner.keys.front());
+          right.inner.keys.erase(right.inner.keys.begin());
+          right.inner.children.erase(right.inner.children.begin());
+        }
+      }
+    }
+
+    node_pointer m_root;
+    size_type m_size{ 0 };
+    Compare m_less;
+  };
+
+  /**
+   * \brief the forward iterator of a persistent_btree, the path from the root to the current
+   *        leaf is kept by plain pointers
+   */
+  template<typename K, typename V, typename Compare>
+  class persistent_btree<K, V, Compare>::const_iterator
+  {
+  public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = typename persistent_btree::value_type;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const value_type*;
+    using reference = const value_type&;
+
+    const_iterator() noexcept = default;
+
+    reference operator*() const noexcept
+    {
+      const auto& f = m_path[m_depth - 1];
+      return f.n->entries[f.index];
+    }
+
+    pointer operator->() const noexcept
+    {
+      return &**this;
+    }
+
+    const_iterator& operator++() noexcept
+    {
+      ++m_path[m_depth - 1].index;
+      this->skip_exhausted_leaf();
+      return *this;
+    }
+
+    const_iterator operator++(int) noexcept
+    {
+      auto tmp = *this;
+      ++*this;
+      return tmp;
+    }
+
+    friend bool operator==(const const_iterator& lhs, const const_iterator& rhs) noexcept
+    {
+      if (lhs.m_depth != rhs.m_depth)
+      {
+        return false;
+      }
+      return lhs.m_depth == 0
+        || (lhs.m_path[lhs.m_depth - 1].n == rhs.m_path[rhs.m_depth - 1].n
+          && lhs.m_path[lhs.m_depth - 1].index == rhs.m_path[rhs.m_depth - 1].index);
+    }
+
+    friend bool operator!=(const const_iterator& lhs, const const_iterator& rhs) noexcept
+    {
+      return !(lhs == rhs);
+    }
+
+  private:
+    friend class persistent_btree;
+
+    struct frame
+    {
+      const node* n;
+      std::size_t index;
+    };
+
+    void push(const node* n, std::size_t index) noexcept
+    {
+      m_path[m_depth++] = frame{ n, index };
+    }
+
+    void descend_leftmost(const node* n) noexcept
+    {
+      while (!n->leaf)
+      {
+        this->push(n, 0);
+        n = n->inner.children.front().get();
+      }
+      this->push(n, 0);
+    }
+
+    // moves past the end of the current leaf to the first entry of the next leaf, or to the end
+    void skip_exhausted_leaf() noexcept
+    {
+      if (m_path[m_depth - 1].index < m_path[m_depth - 1].n->entries.size())
+      {
+        return;
+      }
+      while (--m_depth != 0)
+      {
+        auto& parent = m_path[m_depth - 1];
+        if (++parent.index < parent.n->inner.children.size())
+        {
+          this->descend_leftmost(parent.n->inner.children[parent.index].get());
+          return;
+        }
+      }
+    }
+
+    std::array<frame, max_depth> m_path{};
+    std::size_t m_depth{ 0 };
+  };
+} // end of namespace stdx
+
+#endif
@@ -0,0 +1,652 @@
+#ifndef STDX_PERSISTENT_HASH_MAP_H
+#define STDX_PERSISTENT_HASH_MAP_H
+
+#include "cow_ptr.h"
+#include "memory.h"
+#include "utils.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <new>
+#include <utility>
+
+namespace stdx
+{
+  namespace detail
+  {
+    /**
+     * \brief a node of a hash array mapped trie: the entries and the children stored at this level
+     *        are indexed by the bits of the datamap and of the nodemap, a slot being in at most one
+     *        of them. Below the last level of hash bits, a node holds its colliding entries unordered.
+     *
+     *        The entries and the children are stored behind the node, in a single allocation sized
+     *        by the bitmaps: adding or removing a slot rebuilds the node.
+     */
+    template<typename K, typename V>
+    struct hamt_node final : atomic_reference_count<hamt_node<K, V>>
+    {
+      struct entry
+      {
+        std::size_t hash;
+        K key;
+        V value;
+      };
+
+      using node_pointer = retain_ptr<hamt_node>;
+
+      [[nodiscard]]
+      static std::size_t index(std::uint32_t bitmap, std::uint32_t bit) noexcept
+      {
+        return popcount(bitmap & (bit - 1U));
+      }
+
+      /**
+       * \brief creates a node without entries and children
+       */
+      [[nodiscard]]
+      static node_pointer create()
+      {
+        return allocate(0, 0, 0, 0);
+      }
+
+      /**
+       * \brief returns a copy of the node
+       */
+      [[nodiscard]]
+      static node_pointer copy(const node_pointer& source)
+      {
+        return rebuild(source, source->datamap, source->nodemap, edit{});
+      }
+
+      /**
+       * \brief returns the node with the entry added at position at
+       */
+      [[nodiscard]]
+      static node_pointer with_entry(const node_pointer& source, std::uint32_t datamap, std::size_t at, entry&& added)
+      {
+        edit e;
+        e.added_entry = &added;
+        e.added_entry_at = at;
+        return rebuild(source, datamap, source->nodemap, std::move(e));
+      }
+
+      /**
+       * \brief returns the node without the entry at position at
+       */
+      [[nodiscard]]
+      static node_pointer without_entry(const node_pointer& source, std::uint32_t datamap, std::size_t at)
+      {
+        edit e;
+        e.erased_entry = at;
+        return rebuild(source, datamap, source->nodemap, std::move(e));
+      }
+
+      /**
+       * \brief returns the node with the entry at position entry_at replaced by the child added at
+       *        position child_at
+       */
+      [[nodiscard]]
+      static node_pointer with_child_for_entry(const node_pointer& source, std::uint32_t datamap, std::uint32_t nodemap,
+        std::size_t entry_at, std::size_t child_at, node_pointer added)
+      {
+        edit e;
+        e.erased_entry = entry_at;
+        e.added_child = &added;
+        e.added_child_at = child_at;
+        return rebuild(source, datamap, nodemap, std::move(e));
+      }
+
+      /**
+       * \brief returns the node with the child at position child_at replaced by the entry added at
+       *        position entry_at
+       */
+      [[nodiscard]]
+      static node_pointer with_entry_for_child(const node_pointer& source, std::uint32_t datamap, std::uint32_t nodemap,
+        std::size_t child_at, std::size_t entry_at, entry&& added)
+      {
+        edit e;
+        e.erased_child = child_at;
+        e.added_entry = &added;
+        e.added_entry_at = entry_at;
+        return rebuild(source, datamap, nodemap, std::move(e));
+      }
+
+      hamt_node(const hamt_node&) = delete;
+      hamt_node& operator=(const hamt_node&) = delete;
+
+      ~hamt_node()
+      {
+        std::destroy_n(this->children(), m_child_count);
+        std::destroy_n(this->entries(), m_entry_count);
+      }
+
+      static void operator delete(void* ptr) noexcept
+      {
+        ::operator delete(ptr);
+      }
+
+      [[nodiscard]]
+      entry* entries() noexcept
+      {
+        return reinterpret_cast<entry*>(reinterpret_cast<unsigned char*>(this) + entries_offset());
+      }
+
+      [[nodiscard]]
+      const entry* entries() const noexcept
+      {
+        return reinterpret_cast<const entry*>(reinterpret_cast<const unsigned char*>(this) + entries_offset());
+      }
+
+      [[nodiscard]]
+      node_pointer* children() noexcept
+      {
+        return reinterpret_cast<node_pointer*>(reinterpret_cast<unsigned char*>(this) + children_offset(m_entry_capacity));
+      }
+
+      [[nodiscard]]
+      const node_pointer* children() const noexcept
+      {
+        return reinterpret_cast<const node_pointer*>(reinterpret_cast<const unsigned char*>(this) + children_offset(m_entry_capacity));
+      }
+
+      [[nodiscard]]
+      std::size_t entry_count() const noexcept
+      {
+        return m_entry_count;
+      }
+
+      [[nodiscard]]
+      std::size_t child_count() const noexcept
+      {
+        return m_child_count;
+      }
+
+      const std::uint32_t datamap;
+      const std::uint32_t nodemap;
+
+    private:
+      static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+
+      // the slots removed from the source node (positions in the source) and added to the
+      // rebuilt node (positions in the result)
+      struct edit
+      {
+        std::size_t erased_entry{ npos };
+        entry* added_entry{ nullptr };
+        std::size_t added_entry_at{ 0 };
+        std::size_t erased_child{ npos };
+        node_pointer* added_child{ nullptr };
+        std::size_t added_child_at{ 0 };
+      };
+
+      hamt_node(std::uint32_t d, std::uint32_t n, std::size_t entry_capacity) noexcept
+        : datamap(d)
+        , nodemap(n)
+        , m_entry_capacity(entry_capacity)
+      {
+      }
+
+      [[nodiscard]]
+      static constexpr std::size_t round_up(std::size_t size, std::size_t alignment) noexcept
+      {
+        return (size + alignment - 1) / alignment * alignment;
+      }
+
+      [[nodiscard]]
+      static constexpr std::size_t entries_offset() noexcept
+      {
+        return round_up(sizeof(hamt_node), alignof(entry));
+      }
+
+      [[nodiscard]]
+      static constexpr std::size_t children_offset(std::size_t entry_capacity) noexcept
+      {
+        return round_up(entries_offset() + entry_capacity * sizeof(entry), alignof(node_pointer));
+      }
+
+      [[nodiscard]]
+      static node_pointer allocate(std::uint32_t datamap, std::uint32_t nodemap, std::size_t entry_capacity, std::size_t child_capacity)
+      {
+        static_assert(alignof(entry) <= __STDCPP_DEFAULT_NEW_ALIGNMENT__, "hamt_node: the entries must not be over-aligned");
+        void* mem = ::operator new(children_offset(entry_capacity) + child_capacity * sizeof(node_pointer));
+        return node_pointer(::new (mem) hamt_node(datamap, nodemap, entry_capacity), adopt_object);
+      }
+
+      // the slots of a unique source are moved (unless their move may throw), the source is
+      // left unchanged if the allocation or a copy throws
+      [[nodiscard]]
+      static node_pointer rebuild(const node_pointer& source, std::uint32_t datamap, std::uint32_t nodemap, edit&& e)
+      {
+        auto& s = *source;
+        const auto entry_count = s.m_entry_count - (e.erased_entry != npos ? 1 : 0) + (e.added_entry ? 1 : 0);
+        const auto child_count = s.m_child_count - (e.erased_child != npos ? 1 : 0) + (e.added_child ? 1 : 0);
+        auto result = allocate(datamap, nodemap, entry_count, child_count);
+        const bool steal = is_unique(source);
+        transfer(s.entries(), result->entries(), result->m_entry_count, entry_count, steal, e.erased_entry, e.added_entry, e.added_entry_at);
+        transfer(s.children(), result->children(), result->m_child_count, child_count, steal, e.erased_child, e.added_child, e.added_child_at);
+        return result;
+      }
+
+      template<typename T>
+      static void transfer(T* source, T* target, std::size_t& constructed, std::size_t count, bool steal, std::size_t erased, T* added,
+        std::size_t added_at)
+      {
+        for (std::size_t i = 0; constructed < count; ++constructed)
+        {
+          auto* slot = static_cast<void*>(target + constructed);
+          if (added && constructed == added_at)
+          {
+            ::new (slot) T(std::move(*added));
+            continue;
+          }
+          if (i == erased)
+          {
+            ++i;
+          }
+          if (steal)
+          {
+            ::new (slot) T(std::move_if_noexcept(source[i]));
+          }
+          else
+          {
+            ::new (slot) T(std::as_const(source[i]));
+          }
+          ++i;
+        }
+      }
+
+      const std::size_t m_entry_capacity;
+      std::size_t m_entry_count{ 0 };
+      std::size_t m_child_count{ 0 };
+    };
+  } // end of namespace detail
+
+  /**
+   * \brief persistent_hash_map is an immutable hash map implemented as a hash array mapped trie
+   *        whose nodes are retained objects.
+   *
+   *        A node holds up to 32 entries and children indexed by 5 bits of the hash through bitmaps,
+   *        stored behind the node in a single allocation. An update copies the O(log n) nodes on the
+   *        path to the key and shares all other nodes with the previous version; copying a map (a
+   *        snapshot) is O(1). A transient edits a map in place: the nodes it owns uniquely are
+   *        modified or rebuilt by moving their slots, the shared ones are copied once.
+   * \tparam K the key type
+   * \tparam V the mapped type
+   * \tparam Hash the hash function of the key type
+   * \tparam KeyEqual the equality predicate of the key type
+   * \note the versions may be read concurrently, a transient must not be shared between threads
+   */
+  template<typename K, typename V,
+    typename Hash = std::hash<K>,
+    typename KeyEqual = std::equal_to<K>>
+  class persistent_hash_map
+  {
+    using node = detail::hamt_node<K, V>;
+    using node_pointer = typename node::node_pointer;
+    using entry = typename node::entry;
+
+    static constexpr unsigned bits_per_level = 5;
+    static constexpr std::size_t level_mask = (std::size_t{ 1 } << bits_per_level) - 1;
+    static constexpr unsigned hash_bits = std::numeric_limits<std::size_t>::digits;
+
+  public:
+    using key_type = K;
+    using mapped_type = V;
+    using hasher = Hash;
+    using key_equal = KeyEqual;
+    using size_type = std::size_t;
+
+    class transient;
+
+    /// @name Construction
+    /// @{
+
+    explicit persistent_hash_map(const Hash& hash = Hash(), const KeyEqual& equal = KeyEqual())
+      : m_hash(hash)
+      , m_equal(equal)
+    {
+    }
+
+    persistent_hash_map(const persistent_hash_map&) = default;
+    persistent_hash_map(persistent_hash_map&&) noexcept = default;
+    persistent_hash_map& operator=(const persistent_hash_map&) = default;
+    persistent_hash_map& operator=(persistent_hash_map&&) noexcept = default;
+
+    ~persistent_hash_map() = default;
+
+    /// @}
+
+    /**
+     * \brief returns the version of the map with key mapped to value
+     */
+    [[nodiscard]]
+    persistent_hash_map set(K key, V value) const
+    {
+      auto result = *this;
+      result.assign(std::move(key), std::move(value));
+      return result;
+    }
+
+    /**
+     * \brief returns the version of the map without key
+     */
+    [[nodiscard]]
+    persistent_hash_map erase(const K& key) const
+    {
+      auto result = *this;
+      result.remove(key);
+      return result;
+    }
+
+    /**
+     * \brief returns the value mapped to key, nullptr if the key is not in the map
+     * \note the pointer is valid as long as this version of the map is alive
+     */
+    [[nodiscard]]
+    const V* find(const K& key) const
+    {
+      const auto hash = m_hash(key);
+      const auto* n = m_root.get();
+      for (unsigned shift = 0; n; shift += bits_per_level)
+      {
+        if (shift >= hash_bits)
+        {
+          const auto* entries = n->entries();
+          for (std::size_t i = 0; i < n->entry_count(); ++i)
+          {
+            if (m_equal(entries[i].key, key))
+            {
+              return &entries[i].value;
+            }
+          }
+          return nullptr;
+        }
+
+        const auto bit = bit_of(hash, shift);
+        if (n->datamap & bit)
+        {
+          const auto& e = n->entries()[node::index(n->datamap, bit)];
+          return e.hash == hash && m_equal(e.key, key) ? &e.value : nullptr;
+        }
+        if (!(n->nodemap & bit))
+        {
+          return nullptr;
+        }
+        n = n->children()[node::index(n->nodemap, bit)].get();
+      }
+      return nullptr;
+    }
+
+    [[nodiscard]]
+    bool contains(const K& key) const
+    {
+      return this->find(key) != nullptr;
+    }
+
+    /**
+     * \brief invokes f(key, value) for all entries, in an unspecified order
+     */
+    template<typename F>
+    void for_each(F f) const
+    {
+      if (m_root)
+      {
+        visit(*m_root, f);
+      }
+    }
+
+    /**
+     * \brief returns the transient editing a copy of this version in place
+     */
+    [[nodiscard]]
+    transient as_transient() const
+    {
+      return transient(*this);
+    }
+
+    [[nodiscard]]
+    size_type size() const noexcept
+    {
+      return m_size;
+    }
+
+    [[nodiscard]]
+    bool empty() const noexcept
+    {
+      return m_size == 0;
+    }
+
+    /**
+     * \brief checks whether the map shares its root with other
+     */
+    [[nodiscard]]
+    bool shares_root_with(const persistent_hash_map& other) const noexcept
+    {
+      return m_root == other.m_root;
+    }
+
+  private:
+    [[nodiscard]]
+    static std::uint32_t bit_of(std::size_t hash, unsigned shift) noexcept
+    {
+      return std::uint32_t{ 1 } << ((hash >> shift) & level_mask);
+    }
+
+    template<typename F>
+    static void visit(const node& n, F& f)
+    {
+      const auto* entries = n.entries();
+      for (std::size_t i = 0; i < n.entry_count(); ++i)
+      {
+        f(entries[i].key, entries[i].value);
+      }
+      const auto* children = n.children();
+      for (std::size_t i = 0; i < n.child_count(); ++i)
+      {
+        visit(*children[i], f);
+      }
+    }
+
+    // a node shared with another version is copied, a node owned by this map only is modified
+    // in place
+    [[nodiscard]]
+    static node& unique_node(node_pointer& slot)
+    {
+      if (!detail::is_unique(slot))
+      {
+        slot = node::copy(slot);
+      }
+      return *slot;
+    }
+
+    // the nodes on the path are made unique: a slot is updated in place, an added or removed slot
+    // rebuilds its node, moving the slots of a node owned by this map only
+    void assign(K key, V value)
+    {
+      if (!m_root)
+      {
+        m_root = node::create();
+      }
+      const auto hash = m_hash(key);
+      if (this->assign(m_root, entry{ hash, std::move(key), std::move(value) }, 0))
+      {
+        ++m_size;
+      }
+    }
+
+    bool assign(node_pointer& slot, entry&& e, unsigned shift)
+    {
+      if (shift >= hash_bits)
+      {
+        const auto count = slot->entry_count();
+        for (std::size_t i = 0; i < count; ++i)
+        {
+          if (m_equal(slot->entries()[i].key, e.key))
+          {
+            unique_node(slot).entries()[i].value = std::move(e.value);
+            return false;
+          }
+        }
+        slot = node::with_entry(slot, slot->datamap, count, std::move(e));
+        return true;
+      }
+
+      const auto bit = bit_of(e.hash, shift);
+      const auto datamap = slot->datamap;
+      const auto nodemap = slot->nodemap;
+      if (nodemap & bit)
+      {
+        return this->assign(unique_node(slot).children()[node::index(nodemap, bit)], std::move(e), shift + bits_per_level);
+      }
+
+      const auto i = node::index(datamap, bit);
+      if (!(datamap & bit))
+      {
+        slot = node::with_entry(slot, datamap | bit, i, std::move(e));
+        return true;
+      }
+
+      if (const auto& existing = slot->entries()[i]; existing.hash == e.hash && m_equal(existing.key, e.key))
+      {
+        unique_node(slot).entries()[i].value = std::move(e.value);
+        return false;
+      }
+
+      // both entries move one level down, the existing one is copied out of a shared node
+      auto& existing = slot->entries()[i];
+      auto child = node::create();
+      this->assign(child, detail::is_unique(slot) ? entry(std::move_if_noexcept(existing)) : entry(std::as_const(existing)),
+        shift + bits_per_level);
+      this->assign(child, std::move(e), shift + bits_per_level);
+      slot = node::with_child_for_entry(slot, datamap & ~bit, nodemap | bit, i, node::index(nodemap, bit), std::move(child));
+      return true;
+    }
+
+    void remove(const K& key)
+    {
+      if (!this->contains(key))
+      {
+        return;
+      }
+      this->remove(m_root, m_hash(key), key, 0);
+      if (--m_size == 0)
+      {
+        m_root.reset();
+      }
+    }
+
+    // requires the key to be in the subtree of slot
+    void remove(node_pointer& slot, std::size_t hash, const K& key, unsigned shift)
+    {
+      if (shift >= hash_bits)
+      {
+        for (std::size_t i = 0; i < slot->entry_count(); ++i)
+        {
+          if (m_equal(slot->entries()[i].key, key))
+          {
+            slot = node::without_entry(slot, slot->datamap, i);
+            return;
+          }
+        }
+        return;
+      }
+
+      const auto bit = bit_of(hash, shift);
+      const auto datamap = slot->datamap;
+      const auto nodemap = slot->nodemap;
+      if (datamap & bit)
+      {
+        slot = node::without_entry(slot, datamap & ~bit, node::index(datamap, bit));
+        return;
+      }
+
+      const auto ci = node::index(nodemap, bit);
+      auto& child_slot = unique_node(slot).children()[ci];
+      this->remove(child_slot, hash, key, shift + bits_per_level);
+
+      // a child left with a single entry is inlined, the child is unique after the removal
+      if (auto& child = *child_slot; child.child_count() == 0 && child.entry_count() == 1)
+      {
+        slot = node::with_entry_for_child(slot, datamap | bit, nodemap & ~bit, ci, node::index(datamap, bit), std::move(child.entries()[0]));
+      }
+    }
+
+    node_pointer m_root;
+    size_type m_size{ 0 };
+    Hash m_hash;
+    KeyEqual m_equal;
+  };
+
+  /**
+   * \brief transient is a mutable view of a persistent_hash_map for batch edits: the nodes
+   *        created or copied by the transient are owned by it and modified in place by the
+   *        subsequent edits, without copying the path again.
+   */
+  template<typename K, typename V, typename Hash, typename KeyEqual>
+  class persistent_hash_map<K, V, Hash, KeyEqual>::transient
+  {
+  public:
+    /// @name Construction
+    /// @{
+
+    explicit transient(persistent_hash_map map) noexcept
+      : m_map(std::move(map))
+    {
+    }
+
+    transient(transient&&) noexcept = default;
+    transient& operator=(transient&&) noexcept = default;
+
+    transient(const transient&) = delete;
+    transient& operator=(const transient&) = delete;
+
+    ~transient() = default;
+
+    /// @}
+
+    /**
+     * \brief maps key to value
+     */
+    void set(K key, V value)
+    {
+      m_map.assign(std::move(key), std::move(value));
+    }
+
+    /**
+     * \brief removes key
+     */
+    void erase(const K& key)
+    {
+      m_map.remove(key);
+    }
+
+    [[nodiscard]]
+    const V* find(const K& key) const
+    {
+      return m_map.find(key);
+    }
+
+    [[nodiscard]]
+    size_type size() const noexcept
+    {
+      return m_map.size();
+    }
+
+    /**
+     * \brief ends the batch and returns the edited map
+     */
+    [[nodiscard]]
+    persistent_hash_map persistent() &&
+    {
+      return std::move(m_map);
+    }
+
+  private:
+    persistent_hash_map m_map;
+  };
+} // end of namespace stdx
+
+#endif
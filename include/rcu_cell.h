@@ -0,0 +1,222 @@
+#ifndef STDX_RCU_CELL_H
+#define STDX_RCU_CELL_H
+
+#include "memory.h"
+#include "utils.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <utility>
+
+namespace stdx
+{
+  /**
+   * \brief rcu_cell is a read-mostly cell holding a retain_ptr<T, Traits>.
+   *        A writer publishes a new value by store() or exchange(), the readers
+   *        take snapshots of the published value through an rcu_cell::reader.
+   *
+   *        Each reader caches its own copy of the published retain_ptr together
+   *        with the version of the cell the copy was taken from. As long as the
+   *        version of the cell does not change, reader::get() only loads the version
+   *        counter of the cell (no write to the shared state, no reference count traffic).
+   *        After the publication of a new value the next reader::get() refreshes the
+   *        cached copy (the only place where a reader takes the lock of the cell).
+   *
+   *        A previously published value is released once the cell and all readers
+   *        caching it have moved on (refreshed or reset).
+   * \tparam T the type of the object managed by the published retain_ptr
+   * \tparam Traits the traits suitable for type T
+   * \note a reader is not thread-safe, it is intended to be owned by a single thread
+   *       (e.g. thread_local rcu_cell<const Config>::reader r{ cell };)
+   */
+  template<typename T, typename Traits = retain_traits<T>>
+  class rcu_cell
+  {
+  public:
+    using value_type = retain_ptr<T, Traits>;
+    using version_type = std::uint64_t;
+
+    class reader;
+
+    /// @name Construction
+    /// @{
+
+    /**
+     * \brief Constructs an rcu_cell holding nullptr
+     */
+    rcu_cell() noexcept = default;
+
+    /**
+     * \brief Constructs an rcu_cell holding value
+     * \param value the initially published value
+     */
+    explicit rcu_cell(value_type value) noexcept
+      : m_value(std::move(value))
+    {
+    }
+
+    rcu_cell(const rcu_cell&) = delete;
+    rcu_cell(rcu_cell&&) = delete;
+    rcu_cell& operator=(const rcu_cell&) = delete;
+    rcu_cell& operator=(rcu_cell&&) = delete;
+
+    ~rcu_cell() = default;
+
+    /// @}
+
+    /**
+     * \brief publishes a new value; the previously published value is released by the cell
+     * \param value the value to publish
+     */
+    void store(value_type value)
+    {
+      // the previous value is released after the lock is unlocked
+      [[maybe_unused]] const auto previous = this->exchange(std::move(value));
+    }
+
+    /**
+     * \brief publishes a new value and returns the previously published one
+     * \param value the value to publish
+     * \return the previously published value
+     */
+    value_type exchange(value_type value)
+    {
+      {
+        std::lock_guard lk(m_mutex);
+        m_value.swap(value);
+        m_version.store(m_version.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        if (m_waiters != 0)
+        {
+          m_changed.notify_all();
+        }
+      }
+      return value;
+    }
+
+    /**
+     * \brief returns a copy of the currently published value
+     * \note the copy is taken under the lock, prefer reader::get() on hot paths
+     */
+    [[nodiscard]]
+    value_type load() const
+    {
+      std::lock_guard lk(m_mutex);
+      return m_value;
+    }
+
+    /**
+     * \brief returns the version of the currently published value
+     * \note the version is incremented by every publication
+     */
+    [[nodiscard]]
+    version_type version() const noexcept
+    {
+      return m_version.load(std::memory_order_acquire);
+    }
+
+    /**
+     * \brief blocks the calling thread until a value newer than version old is published
+     * \param old the version the caller has already observed
+     * \return the version of the currently published value
+     */
+    version_type wait(version_type old) const
+    {
+      if (const auto current = this->version(); current != old)
+      {
+        return current;
+      }
+
+      std::unique_lock lk(m_mutex);
+      ++m_waiters;
+      m_changed.wait(lk, [this, old] { return m_version.load(std::memory_order_relaxed) != old; });
+      --m_waiters;
+      return m_version.load(std::memory_order_relaxed);
+    }
+
+  private:
+    void snapshot(value_type& value, version_type& version) const
+    {
+      std::lock_guard lk(m_mutex);
+      value = m_value;
+      version = m_version.load(std::memory_order_relaxed);
+    }
+
+    // the version is the only member touched by readers on the fast path;
+    // it is kept on its own cache line, apart from the data written on the slow path
+    alignas(cache_line_size) std::atomic<version_type> m_version{ 0 };
+    alignas(cache_line_size) mutable std::mutex m_mutex;
+    mutable std::condition_variable m_changed;
+    mutable std::size_t m_waiters{ 0 };
+    value_type m_value;
+  };
+
+  /**
+   * \brief the per thread view of an rcu_cell; caches the last observed value of the cell
+   */
+  template<typename T, typename Traits>
+  class rcu_cell<T, Traits>::reader
+  {
+  public:
+    /**
+     * \brief Constructs a reader of the cell and takes the initial snapshot
+     * \param cell the observed cell; it has to outlive the reader
+     */
+    explicit reader(const rcu_cell& cell)
+      : m_cell(&cell)
+    {
+      m_cell->snapshot(m_value, m_version);
+    }
+
+    /**
+     * \brief returns the currently published value
+     * \return the reference to the cached copy of the published value;
+     *         the reference is valid until the next call of get() or reset()
+     * \note the copy is refreshed only when a new value has been published
+     */
+    [[nodiscard]]
+    const value_type& get()
+    {
+      if (m_cell->m_version.load(std::memory_order_acquire) != m_version)
+      {
+        this->refresh();
+      }
+      return m_value;
+    }
+
+    /**
+     * \brief returns the version of the cached copy
+     */
+    [[nodiscard]]
+    version_type version() const noexcept
+    {
+      return m_version;
+    }
+
+    /**
+     * \brief drops the cached copy, the next get() takes a new snapshot
+     * \note useful for idle threads, which would keep an outdated value alive otherwise
+     */
+    void reset() noexcept
+    {
+      m_value.reset();
+      m_version = ~version_type{ 0 };
+    }
+
+  private:
+    void refresh()
+    {
+      value_type value;
+      m_cell->snapshot(value, m_version);
+      // the outdated copy is released outside the lock of the cell
+      m_value.swap(value);
+    }
+
+    const rcu_cell* m_cell;
+    value_type m_value;
+    version_type m_version{ 0 };
+  };
+} // end of namespace stdx
+
+#endif
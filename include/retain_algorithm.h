@@ -0,0 +1,164 @@
+#ifndef STDX_RETAIN_ALGORITHM_H
+#define STDX_RETAIN_ALGORITHM_H
+
+#include "memory.h"
+#include "utils.h"
+
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace stdx
+{
+  /**
+   * \brief the default number of elements whose pointees are prefetched ahead of the visited one
+   */
+  inline constexpr std::size_t default_prefetch_distance = 8;
+
+  namespace detail
+  {
+    /**
+     * \brief returns the raw pointer held by a raw pointer, a retain_ptr or a borrowed pointer
+     */
+    template<typename P>
+    [[nodiscard]]
+    auto address_of(const P& p) noexcept
+    {
+      if constexpr (std::is_pointer_v<P>)
+      {
+        return p;
+      }
+      else
+      {
+        return p.get();
+      }
+    }
+
+    /**
+     * \brief the address read by the projection: the member itself for a pointer to data member,
+     *        which may lie on another cache line than the beginning of the object
+     */
+    template<typename Ptr, typename Projection>
+    [[nodiscard]]
+    const void* address_read_by(Ptr p, const Projection& proj) noexcept
+    {
+      if constexpr (std::is_member_object_pointer_v<Projection>)
+      {
+        return p ? static_cast<const void*>(std::addressof(p->*proj)) : nullptr;
+      }
+      else
+      {
+        static_cast<void>(proj);
+        return p;
+      }
+    }
+
+    // a lead iterator runs distance elements ahead of the visited one, prefetching its pointee:
+    // the misses of the following pointees are overlapped with the visit
+    template<typename Range, typename Projection, typename F>
+    void visit_prefetched(Range& range, const Projection& proj, F& f, std::size_t distance)
+    {
+      using std::begin;
+      using std::end;
+      auto first = begin(range);
+      const auto last = end(range);
+      if (distance == 0)
+      {
+        for (; first != last; ++first)
+        {
+          f(address_of(*first));
+        }
+        return;
+      }
+      auto ahead = first;
+      for (std::size_t i = 0; i < distance && ahead != last; ++i, ++ahead)
+      {
+        prefetch(address_read_by(address_of(*ahead), proj));
+      }
+      for (; first != last; ++first)
+      {
+        if (ahead != last)
+        {
+          prefetch(address_read_by(address_of(*ahead), proj));
+          ++ahead;
+        }
+        f(address_of(*first));
+      }
+    }
+
+    template<typename Range>
+    using range_element_t = std::remove_cv_t<std::remove_reference_t<decltype(*std::begin(std::declval<Range&>()))>>;
+
+    template<typename Range>
+    using range_pointee_t = std::remove_pointer_t<decltype(address_of(std::declval<const range_element_t<Range>&>()))>;
+  } // end of namespace detail
+
+  /**
+   * \brief invokes f(object) for the objects pointed to by the elements of the range, prefetching
+   *        the objects distance elements ahead
+   * \param range a range of retain_ptr, of raw pointers or of any pointer providing get()
+   * \param f the function invoked with a reference to each object
+   * \param distance the number of elements prefetched ahead, 0 disables the prefetching
+   * \note the null elements are skipped
+   */
+  template<typename Range, typename F>
+  void for_each_retained(Range&& range, F f, std::size_t distance = default_prefetch_distance)
+  {
+    const auto visit = [&f](auto* p) {
+      if (p)
+      {
+        f(*p);
+      }
+    };
+    detail::visit_prefetched(range, nullptr, visit, distance);
+  }
+
+  /**
+   * \brief writes the projections of the objects pointed to by the elements of the range to out,
+   *        prefetching the objects distance elements ahead
+   * \param range a range of retain_ptr, of raw pointers or of any pointer providing get()
+   * \param proj the projection invoked with a reference to each object, e.g. a pointer to member;
+   *        a pointer to data member prefetches the member rather than the beginning of the object
+   * \param out the output iterator, e.g. to a contiguous buffer consumed by a vectorized kernel
+   * \param distance the number of elements prefetched ahead, 0 disables the prefetching
+   * \return the output iterator past the last written projection
+   * \note requires the elements to be non-null, the n-th projection is the one of the n-th element
+   */
+  template<typename Range, typename Projection, typename OutputIt
+    requires_T(!std::is_integral_v<OutputIt>)
+  >
+  OutputIt gather(Range&& range, Projection proj, OutputIt out, std::size_t distance = default_prefetch_distance)
+  {
+    const auto visit = [&proj, &out](auto* p) {
+      *out = std::invoke(proj, *p);
+      ++out;
+    };
+    detail::visit_prefetched(range, proj, visit, distance);
+    return out;
+  }
+
+  /**
+   * \brief returns the vector of the projections of the objects pointed to by the elements of the
+   *        range, prefetching the objects distance elements ahead
+   * \see gather(Range&&, Projection, OutputIt, std::size_t)
+   */
+  template<typename Range, typename Projection>
+  [[nodiscard]]
+  auto gather(Range&& range, Projection proj, std::size_t distance = default_prefetch_distance)
+  {
+    using value_type = std::decay_t<std::invoke_result_t<Projection&, detail::range_pointee_t<Range>&>>;
+    std::vector<value_type> result;
+    if constexpr (std::is_base_of_v<std::random_access_iterator_tag,
+      typename std::iterator_traits<decltype(std::begin(range))>::iterator_category>)
+    {
+      result.reserve(static_cast<std::size_t>(std::distance(std::begin(range), std::end(range))));
+    }
+    gather(range, std::move(proj), std::back_inserter(result), distance);
+    return result;
+  }
+} // end of namespace stdx
+
+#endif
@@ -0,0 +1,689 @@
+#ifndef STDX_RETAIN_FLAT_SET_H
+#define STDX_RETAIN_FLAT_SET_H
+
+#include "memory.h"
+#include "utils.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace stdx
+{
+  namespace detail
+  {
+    /**
+     * \brief the storage of a mapped value, constructed only in the slots holding a key
+     */
+    template<typename Mapped>
+    struct flat_value_slot
+    {
+      flat_value_slot() noexcept
+      {
+      }
+
+      ~flat_value_slot()
+      {
+      }
+
+      union
+      {
+        Mapped value;
+      };
+    };
+
+    template<>
+    struct flat_value_slot<void>
+    {
+    };
+
+    /**
+     * \brief an open-addressing hash table keyed by retained pointers, probed linearly.
+     *
+     *        A slot holds the raw pointer of a key and owns one reference of it: the null pointer
+     *        marks an empty slot, a reserved misaligned pointer marks an erased one (a tombstone).
+     *        The mapped values, unless Mapped is void, are stored in a parallel array so that the
+     *        probes only read the keys.
+     */
+    template<typename T, typename Traits, typename Hash, typename Mapped>
+    class retain_flat_table
+    {
+      static constexpr bool is_map = !std::is_void_v<Mapped>;
+      static constexpr std::size_t min_capacity = 8;
+
+      using value_slot = flat_value_slot<Mapped>;
+
+    public:
+      using key_type = retain_ptr<T, Traits>;
+      using pointer = typename key_type::pointer;
+      using size_type = std::size_t;
+
+      static_assert(std::is_pointer_v<pointer>, "retain_flat_table: the pointer type of Traits must be a raw pointer");
+
+      static constexpr size_type npos = static_cast<size_type>(-1);
+
+      /// @name Construction
+      /// @{
+
+      explicit retain_flat_table(size_type capacity, const Hash& hash)
+        : m_hash(hash)
+      {
+        this->reserve(capacity);
+      }
+
+      // delegating, so that the keys already copied are released if a mapped value throws
+      retain_flat_table(const retain_flat_table& other)
+        : retain_flat_table(0, other.m_hash)
+      {
+        this->reserve(other.m_size);
+        other.for_each_slot([this, &other](size_type i) {
+          const auto j = this->insert_slot(other.m_keys[i]);
+          if constexpr (is_map)
+          {
+            ::new (static_cast<void*>(&m_values[j].value)) Mapped(other.m_values[i].value);
+          }
+          m_keys[j] = key_type(other.m_keys[i], retain_object).release();
+          ++m_size;
+        });
+      }
+
+      retain_flat_table(retain_flat_table&& other) noexcept
+        : m_keys(std::move(other.m_keys))
+        , m_values(std::move(other.m_values))
+        , m_capacity(std::exchange(other.m_capacity, 0))
+        , m_size(std::exchange(other.m_size, 0))
+        , m_tombstones(std::exchange(other.m_tombstones, 0))
+        , m_shift(other.m_shift)
+        , m_hash(other.m_hash)
+      {
+      }
+
+      retain_flat_table& operator=(const retain_flat_table& other)
+      {
+        if (this != &other)
+        {
+          retain_flat_table(other).swap(*this);
+        }
+        return *this;
+      }
+
+      retain_flat_table& operator=(retain_flat_table&& other) noexcept
+      {
+        retain_flat_table(std::move(other)).swap(*this);
+        return *this;
+      }
+
+      ~retain_flat_table()
+      {
+        this->clear();
+      }
+
+      /// @}
+
+      void swap(retain_flat_table& other) noexcept
+      {
+        using std::swap;
+        swap(m_keys, other.m_keys);
+        swap(m_values, other.m_values);
+        swap(m_capacity, other.m_capacity);
+        swap(m_size, other.m_size);
+        swap(m_tombstones, other.m_tombstones);
+        swap(m_shift, other.m_shift);
+        swap(m_hash, other.m_hash);
+      }
+
+      /**
+       * \brief returns the slot of the key, npos if the key is not in the table
+       */
+      [[nodiscard]]
+      size_type find(pointer key) const noexcept
+      {
+        if (m_size == 0 || !is_live(key))
+        {
+          return npos;
+        }
+        const auto mask = m_capacity - 1;
+        for (auto i = this->home_of(key);; i = (i + 1) & mask)
+        {
+          if (m_keys[i] == key)
+          {
+            return i;
+          }
+          if (m_keys[i] == nullptr)
+          {
+            return npos;
+          }
+        }
+      }
+
+      /**
+       * \brief moves the key into the table without touching its reference count, constructing
+       *        its mapped value from args
+       * \return the slot of the key and whether it has been inserted
+       * \note requires key != nullptr
+       */
+      template<typename... Args>
+      std::pair<size_type, bool> emplace(key_type&& key, Args&&... args)
+      {
+        if (const auto i = this->find(key.get()); i != npos)
+        {
+          return { i, false };
+        }
+        if ((m_size + m_tombstones + 1) * 8 > m_capacity * 7)
+        {
+          this->rehash(capacity_for(m_size + 1));
+        }
+        const auto i = this->insert_slot(key.get());
+        if constexpr (is_map)
+        {
+          ::new (static_cast<void*>(&m_values[i].value)) Mapped(std::forward<Args>(args)...);
+        }
+        if (m_keys[i] != nullptr)
+        {
+          --m_tombstones;
+        }
+        m_keys[i] = key.release();
+        ++m_size;
+        return { i, true };
+      }
+
+      /**
+       * \brief releases the key of the slot and destroys its mapped value
+       */
+      void erase(size_type i) noexcept
+      {
+        this->destroy(i);
+        m_keys[i] = tombstone();
+        --m_size;
+        ++m_tombstones;
+      }
+
+      void clear() noexcept
+      {
+        for (size_type i = 0; i < m_capacity; ++i)
+        {
+          if (is_live(m_keys[i]))
+          {
+            this->destroy(i);
+          }
+          m_keys[i] = nullptr;
+        }
+        m_size = 0;
+        m_tombstones = 0;
+      }
+
+      /**
+       * \brief grows the table to hold n keys without rehashing
+       */
+      void reserve(size_type n)
+      {
+        if (n != 0 && capacity_for(n) > m_capacity)
+        {
+          this->rehash(capacity_for(n));
+        }
+      }
+
+      /**
+       * \brief invokes f(i) for the slots holding a key
+       */
+      template<typename F>
+      void for_each_slot(F&& f) const
+      {
+        for (size_type i = 0; i < m_capacity; ++i)
+        {
+          if (is_live(m_keys[i]))
+          {
+            f(i);
+          }
+        }
+      }
+
+      [[nodiscard]]
+      pointer key_at(size_type i) const noexcept
+      {
+        return m_keys[i];
+      }
+
+      template<typename M = Mapped
+        requires_T(!std::is_void_v<M>)
+      >
+      [[nodiscard]]
+      M& value_at(size_type i) const noexcept
+      {
+        return m_values[i].value;
+      }
+
+      [[nodiscard]]
+      size_type size() const noexcept
+      {
+        return m_size;
+      }
+
+      [[nodiscard]]
+      size_type capacity() const noexcept
+      {
+        return m_capacity;
+      }
+
+    private:
+      [[nodiscard]]
+      static pointer tombstone() noexcept
+      {
+        // never the address of a retained object, which is at least aligned to its count
+        return reinterpret_cast<pointer>(std::uintptr_t{ 1 });
+      }
+
+      [[nodiscard]]
+      static bool is_live(pointer p) noexcept
+      {
+        return p != nullptr && p != tombstone();
+      }
+
+      // the smallest power of two keeping the load factor below 7/8
+      [[nodiscard]]
+      static size_type capacity_for(size_type n) noexcept
+      {
+        const auto c = round_up_to_power_of_two(n + n / 7 + 1);
+        return c < min_capacity ? min_capacity : c;
+      }
+
+      // the pointer hashes are spread by a Fibonacci multiplication, the top bits index the slots:
+      // std::hash of a pointer is usually the address, whose low bits are zero
+      [[nodiscard]]
+      size_type home_of(pointer key) const noexcept
+      {
+        const auto h = static_cast<std::uint64_t>(m_hash(key));
+        return static_cast<size_type>((h * 0x9E3779B97F4A7C15ULL) >> m_shift);
+      }
+
+      // the first empty or erased slot on the probe sequence of the key
+      size_type insert_slot(pointer key) const noexcept
+      {
+        const auto mask = m_capacity - 1;
+        auto i = this->home_of(key);
+        while (is_live(m_keys[i]))
+        {
+          i = (i + 1) & mask;
+        }
+        return i;
+      }
+
+      void destroy(size_type i) noexcept
+      {
+        if constexpr (is_map)
+        {
+          m_values[i].value.~Mapped();
+        }
+        key_type released(m_keys[i], adopt_object);
+      }
+
+      // the keys and the values are moved, the reference counts are left untouched
+      void rehash(size_type capacity)
+      {
+        auto keys = std::make_unique<pointer[]>(capacity);
+        std::unique_ptr<value_slot[]> values;
+        if constexpr (is_map)
+        {
+          values = std::make_unique<value_slot[]>(capacity);
+        }
+
+        auto old_keys = std::exchange(m_keys, std::move(keys));
+        auto old_values = std::exchange(m_values, std::move(values));
+        const auto old_capacity = std::exchange(m_capacity, capacity);
+        m_tombstones = 0;
+        m_shift = 64;
+        for (auto c = capacity; c > 1; c >>= 1U)
+        {
+          --m_shift;
+        }
+
+        for (size_type i = 0; i < old_capacity; ++i)
+        {
+          if (is_live(old_keys[i]))
+          {
+            const auto j = this->insert_slot(old_keys[i]);
+            if constexpr (is_map)
+            {
+              ::new (static_cast<void*>(&m_values[j].value)) Mapped(std::move_if_noexcept(old_values[i].value));
+              old_values[i].value.~Mapped();
+            }
+            m_keys[j] = old_keys[i];
+          }
+        }
+      }
+
+      std::unique_ptr<pointer[]> m_keys;
+      std::unique_ptr<value_slot[]> m_values;
+      size_type m_capacity{ 0 };
+      size_type m_size{ 0 };
+      size_type m_tombstones{ 0 };
+      unsigned m_shift{ 64 };
+      Hash m_hash;
+    };
+  } // end of namespace detail
+
+  /**
+   * \brief retain_flat_set is a set of retained pointers compared by identity, stored in a single
+   *        open-addressing array of raw pointers instead of a node per element.
+   *
+   *        Each element owns one reference of its object: an inserted rvalue is moved in by
+   *        release() without touching the reference count, an erased element is released.
+   *        The empty slots hold the null pointer, the erased ones a reserved tombstone pointer.
+   * \tparam T the type of the retained objects
+   * \tparam Traits the traits suitable for type T
+   * \tparam Hash the hash function of the raw pointers, as used by std::hash<retain_ptr<T, Traits>>
+   * \note inserting or erasing invalidates the slots, the set must not be modified in for_each
+   */
+  template<typename T,
+    typename Traits = retain_traits<T>,
+    typename Hash = std::hash<typename retain_ptr<T, Traits>::pointer>>
+  class retain_flat_set
+  {
+    using table = detail::retain_flat_table<T, Traits, Hash, void>;
+
+  public:
+    using value_type = retain_ptr<T, Traits>;
+    using pointer = typename value_type::pointer;
+    using hasher = Hash;
+    using size_type = std::size_t;
+
+    /// @name Construction
+    /// @{
+
+    /**
+     * \brief Constructs an empty set
+     * \param capacity the number of elements the set holds without rehashing
+     */
+    explicit retain_flat_set(size_type capacity = 0, const Hash& hash = Hash())
+      : m_table(capacity, hash)
+    {
+    }
+
+    retain_flat_set(const retain_flat_set&) = default;
+    retain_flat_set(retain_flat_set&&) noexcept = default;
+    retain_flat_set& operator=(const retain_flat_set&) = default;
+    retain_flat_set& operator=(retain_flat_set&&) noexcept = default;
+
+    ~retain_flat_set() = default;
+
+    /// @}
+
+    /**
+     * \brief inserts the element, moved in without touching its reference count
+     * \return true if the element has been inserted
+     * \note requires value != nullptr
+     */
+    bool insert(value_type value)
+    {
+      return m_table.emplace(std::move(value)).second;
+    }
+
+    /**
+     * \brief removes and releases the element
+     * \return true if the element has been removed
+     */
+    bool erase(pointer p) noexcept
+    {
+      const auto i = m_table.find(p);
+      if (i == table::npos)
+      {
+        return false;
+      }
+      m_table.erase(i);
+      return true;
+    }
+
+    bool erase(const value_type& value) noexcept
+    {
+      return this->erase(value.get());
+    }
+
+    [[nodiscard]]
+    bool contains(pointer p) const noexcept
+    {
+      return m_table.find(p) != table::npos;
+    }
+
+    [[nodiscard]]
+    bool contains(const value_type& value) const noexcept
+    {
+      return this->contains(value.get());
+    }
+
+    /**
+     * \brief invokes f(pointer) for all elements, in an unspecified order
+     */
+    template<typename F>
+    void for_each(F f) const
+    {
+      m_table.for_each_slot([this, &f](size_type i) { f(m_table.key_at(i)); });
+    }
+
+    /**
+     * \brief releases all elements, the capacity is kept
+     */
+    void clear() noexcept
+    {
+      m_table.clear();
+    }
+
+    /**
+     * \brief grows the set to hold n elements without rehashing
+     */
+    void reserve(size_type n)
+    {
+      m_table.reserve(n);
+    }
+
+    [[nodiscard]]
+    size_type size() const noexcept
+    {
+      return m_table.size();
+    }
+
+    [[nodiscard]]
+    bool empty() const noexcept
+    {
+      return m_table.size() == 0;
+    }
+
+    /**
+     * \brief returns the number of slots
+     */
+    [[nodiscard]]
+    size_type capacity() const noexcept
+    {
+      return m_table.capacity();
+    }
+
+  private:
+    table m_table;
+  };
+
+  /**
+   * \brief retain_flat_map maps retained pointers compared by identity to values, stored in an
+   *        open-addressing array of raw pointers and a parallel array of values.
+   *
+   *        Each key owns one reference of its object, moved in by release() without touching the
+   *        reference count; an erased key is released.
+   * \tparam K the type of the retained objects of the keys
+   * \tparam V the mapped type
+   * \tparam Traits the traits suitable for type K
+   * \tparam Hash the hash function of the raw pointers, as used by std::hash<retain_ptr<K, Traits>>
+   * \note inserting or erasing invalidates the pointers to the values
+   */
+  template<typename K, typename V,
+    typename Traits = retain_traits<K>,
+    typename Hash = std::hash<typename retain_ptr<K, Traits>::pointer>>
+  class retain_flat_map
+  {
+    using table = detail::retain_flat_table<K, Traits, Hash, V>;
+
+  public:
+    using key_type = retain_ptr<K, Traits>;
+    using mapped_type = V;
+    using pointer = typename key_type::pointer;
+    using hasher = Hash;
+    using size_type = std::size_t;
+
+    /// @name Construction
+    /// @{
+
+    /**
+     * \brief Constructs an empty map
+     * \param capacity the number of entries the map holds without rehashing
+     */
+    explicit retain_flat_map(size_type capacity = 0, const Hash& hash = Hash())
+      : m_table(capacity, hash)
+    {
+    }
+
+    retain_flat_map(const retain_flat_map&) = default;
+    retain_flat_map(retain_flat_map&&) noexcept = default;
+    retain_flat_map& operator=(const retain_flat_map&) = default;
+    retain_flat_map& operator=(retain_flat_map&&) noexcept = default;
+
+    ~retain_flat_map() = default;
+
+    /// @}
+
+    /**
+     * \brief maps the key to a value constructed from args if the key is not in the map
+     * \return true if the entry has been inserted
+     * \note requires key != nullptr
+     */
+    template<typename... Args
+      requires_T(std::is_constructible_v<V, Args&&...>)
+    >
+    bool try_emplace(key_type key, Args&&... args)
+    {
+      return m_table.emplace(std::move(key), std::forward<Args>(args)...).second;
+    }
+
+    /**
+     * \brief maps the key to value, replacing the value of a key already in the map
+     * \return true if the entry has been inserted
+     * \note requires key != nullptr
+     */
+    bool insert_or_assign(key_type key, V value)
+    {
+      const auto i = m_table.find(key.get());
+      if (i != table::npos)
+      {
+        m_table.value_at(i) = std::move(value);
+        return false;
+      }
+      return m_table.emplace(std::move(key), std::move(value)).second;
+    }
+
+    /**
+     * \brief returns the value mapped to the key, nullptr if the key is not in the map
+     */
+    [[nodiscard]]
+    V* find(pointer p) noexcept
+    {
+      const auto i = m_table.find(p);
+      return i != table::npos ? &m_table.value_at(i) : nullptr;
+    }
+
+    [[nodiscard]]
+    const V* find(pointer p) const noexcept
+    {
+      const auto i = m_table.find(p);
+      return i != table::npos ? &m_table.value_at(i) : nullptr;
+    }
+
+    [[nodiscard]]
+    bool contains(pointer p) const noexcept
+    {
+      return m_table.find(p) != table::npos;
+    }
+
+    [[nodiscard]]
+    bool contains(const key_type& key) const noexcept
+    {
+      return this->contains(key.get());
+    }
+
+    /**
+     * \brief removes the entry and releases its key
+     * \return true if the entry has been removed
+     */
+    bool erase(pointer p) noexcept
+    {
+      const auto i = m_table.find(p);
+      if (i == table::npos)
+      {
+        return false;
+      }
+      m_table.erase(i);
+      return true;
+    }
+
+    bool erase(const key_type& key) noexcept
+    {
+      return this->erase(key.get());
+    }
+
+    /**
+     * \brief invokes f(pointer, value) for all entries, in an unspecified order
+     */
+    template<typename F>
+    void for_each(F f)
+    {
+      m_table.for_each_slot([this, &f](size_type i) { f(m_table.key_at(i), m_table.value_at(i)); });
+    }
+
+    template<typename F>
+    void for_each(F f) const
+    {
+      m_table.for_each_slot([this, &f](size_type i) { f(m_table.key_at(i), std::as_const(m_table.value_at(i))); });
+    }
+
+    /**
+     * \brief removes all entries, the capacity is kept
+     */
+    void clear() noexcept
+    {
+      m_table.clear();
+    }
+
+    /**
+     * \brief grows the map to hold n entries without rehashing
+     */
+    void reserve(size_type n)
+    {
+      m_table.reserve(n);
+    }
+
+    [[nodiscard]]
+    size_type size() const noexcept
+    {
+      return m_table.size();
+    }
+
+    [[nodiscard]]
+    bool empty() const noexcept
+    {
+      return m_table.size() == 0;
+    }
+
+    /**
+     * \brief returns the number of slots
+     */
+    [[nodiscard]]
+    size_type capacity() const noexcept
+    {
+      return m_table.capacity();
+    }
+
+  private:
+    table m_table;
+  };
+} // end of namespace stdx
+
+#endif
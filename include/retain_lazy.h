@@ -0,0 +1,182 @@
+#ifndef STDX_RETAIN_LAZY_H
+#define STDX_RETAIN_LAZY_H
+
+#include "epoch.h"
+#include "memory.h"
+#include "utils.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <utility>
+
+namespace stdx
+{
+  /**
+   * \brief retain_lazy is a shared cell computing its retained value once, on first use.
+   *
+   *        The computed value is published as a raw pointer owning one reference of the cell:
+   *        once computed, get() is a lock-free load under an epoch_domain guard, retaining the
+   *        value for the caller. The first callers take the lock of the cell, one of them invokes
+   *        the factory without holding the lock while the others wait for the value. A factory
+   *        throwing an exception leaves the cell empty, the next caller invokes it again.
+   *        invalidate() starts a new generation: the value is unpublished (and released once no
+   *        reader may observe it) and the next get() recomputes it; a computation overlapping an
+   *        invalidation is discarded and started again.
+   * \tparam T the type of the object managed by the computed retain_ptr, e.g. const Index
+   * \tparam Traits the traits suitable for type T
+   * \note the factory must return a non-null value
+   */
+  template<typename T, typename Traits = retain_traits<T>>
+  class retain_lazy
+  {
+  public:
+    using value_type = retain_ptr<T, Traits>;
+    using factory_type = std::function<value_type()>;
+    using generation_type = std::uint64_t;
+
+    /// @name Construction
+    /// @{
+
+    /**
+     * \brief Constructs an empty cell, the value is computed by factory on first use
+     */
+    explicit retain_lazy(factory_type factory)
+      : m_factory(std::move(factory))
+    {
+    }
+
+    retain_lazy(const retain_lazy&) = delete;
+    retain_lazy(retain_lazy&&) = delete;
+    retain_lazy& operator=(const retain_lazy&) = delete;
+    retain_lazy& operator=(retain_lazy&&) = delete;
+
+    ~retain_lazy()
+    {
+      value_type(m_value.load(std::memory_order_relaxed), adopt_object).reset();
+    }
+
+    /// @}
+
+    /**
+     * \brief returns the value, computing it if the cell is empty
+     * \note rethrows the exception thrown by the factory
+     */
+    [[nodiscard]]
+    value_type get() const
+    {
+      if (auto value = this->try_get())
+      {
+        return value;
+      }
+      return this->compute();
+    }
+
+    /**
+     * \brief returns the value if it has been computed, nullptr otherwise; never computes
+     */
+    [[nodiscard]]
+    value_type try_get() const
+    {
+      const auto g = epoch_domain::instance().pin();
+      return value_type(m_value.load(std::memory_order_acquire), retain_object);
+    }
+
+    /**
+     * \brief checks whether the value of the current generation has been computed
+     */
+    [[nodiscard]]
+    bool has_value() const noexcept
+    {
+      return m_value.load(std::memory_order_acquire) != nullptr;
+    }
+
+    /**
+     * \brief unpublishes the value, the next get() computes the value of the new generation
+     * \return the new generation
+     * \note the value is released once no reader may observe it, the holders of the value keep it
+     */
+    generation_type invalidate()
+    {
+      auto& domain = epoch_domain::instance();
+      const auto g = domain.pin();
+      value_type old;
+      generation_type generation;
+      {
+        std::lock_guard lk(m_mutex);
+        old.reset(m_value.exchange(nullptr, std::memory_order_acq_rel), adopt_object);
+        generation = m_generation.load(std::memory_order_relaxed) + 1;
+        m_generation.store(generation, std::memory_order_relaxed);
+      }
+      domain.retire(std::move(old));
+      return generation;
+    }
+
+    /**
+     * \brief returns the number of invalidations
+     */
+    [[nodiscard]]
+    generation_type generation() const noexcept
+    {
+      return m_generation.load(std::memory_order_relaxed);
+    }
+
+  private:
+    value_type compute() const
+    {
+      std::unique_lock lk(m_mutex);
+      for (;;)
+      {
+        // the value is unpublished under the lock only
+        if (auto* p = m_value.load(std::memory_order_relaxed))
+        {
+          return value_type(p, retain_object);
+        }
+        if (!m_computing)
+        {
+          break;
+        }
+        m_computed.wait(lk);
+      }
+
+      m_computing = true;
+      for (;;)
+      {
+        const auto generation = m_generation.load(std::memory_order_relaxed);
+        lk.unlock();
+        value_type value;
+        try
+        {
+          value = m_factory();
+        }
+        catch (...)
+        {
+          lk.lock();
+          m_computing = false;
+          m_computed.notify_all();
+          throw;
+        }
+        lk.lock();
+        if (m_generation.load(std::memory_order_relaxed) == generation)
+        {
+          m_value.store(value_type(value).release(), std::memory_order_release);
+          m_computing = false;
+          m_computed.notify_all();
+          return value;
+        }
+      }
+    }
+
+    // the value is the only member touched by readers on the fast path
+    alignas(cache_line_size) mutable std::atomic<typename value_type::pointer> m_value{ nullptr };
+    alignas(cache_line_size) mutable std::mutex m_mutex;
+    mutable std::condition_variable m_computed;
+    mutable bool m_computing{ false };
+    std::atomic<generation_type> m_generation{ 0 };
+    const factory_type m_factory;
+  };
+} // end of namespace stdx
+
+#endif
@@ -0,0 +1,382 @@
+#ifndef STDX_RETAIN_STRING_H
+#define STDX_RETAIN_STRING_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+
+namespace stdx
+{
+  namespace detail
+  {
+    /**
+     * \brief the header of the shared characters of the retain_strings, followed by the
+     *        characters and a null character in the same allocation
+     */
+    template<typename CharT>
+    struct string_header
+    {
+      [[nodiscard]]
+      const CharT* chars() const noexcept
+      {
+        return reinterpret_cast<const CharT*>(this + 1);
+      }
+
+      [[nodiscard]]
+      CharT* chars() noexcept
+      {
+        return reinterpret_cast<CharT*>(this + 1);
+      }
+
+      mutable std::atomic<std::ptrdiff_t> count{ 1 };
+      // the hash of the whole text, 0 until computed
+      mutable std::atomic<std::size_t> hash{ 0 };
+      std::size_t length{ 0 };
+    };
+  } // end of namespace detail
+
+  /**
+   * \brief basic_retain_string is an immutable string whose characters are shared by its copies.
+   *
+   *        A string longer than small_capacity characters is stored in a single allocation
+   *        holding the reference count, the length, the cached hash and the characters: a copy
+   *        is a single atomic increment, the hash of the whole string is computed once. The
+   *        shorter strings are stored inline, without allocation. A substring longer than
+   *        small_capacity characters is a view (the first character and the length) sharing
+   *        the allocation of the original string.
+   * \tparam CharT the character type
+   * \tparam Traits the traits of the character type
+   * \note the strings may be copied and read concurrently; data() is not null-terminated
+   */
+  template<typename CharT, typename Traits = std::char_traits<CharT>>
+  class basic_retain_string
+  {
+    using header = detail::string_header<CharT>;
+
+    static_assert(alignof(CharT) <= alignof(header), "basic_retain_string<CharT>: the characters must follow the header");
+
+    struct heap_view
+    {
+      const header* node;
+      const CharT* first;
+    };
+
+  public:
+    using traits_type = Traits;
+    using value_type = CharT;
+    using size_type = std::size_t;
+    using const_iterator = const CharT*;
+    using string_type = std::basic_string<CharT, Traits>;
+    using string_view_type = std::basic_string_view<CharT, Traits>;
+
+    static constexpr size_type npos = static_cast<size_type>(-1);
+    static constexpr size_type small_capacity = sizeof(heap_view) / sizeof(CharT);
+
+    /// @name Construction
+    /// @{
+
+    basic_retain_string() noexcept = default;
+
+    explicit basic_retain_string(string_view_type text)
+      : m_size(text.size())
+    {
+      if (this->is_inline())
+      {
+        Traits::copy(m_storage.small, text.data(), text.size());
+      }
+      else
+      {
+        const auto* node = allocate(text);
+        m_storage.heap = heap_view{ node, node->chars() };
+      }
+    }
+
+    explicit basic_retain_string(const CharT* text)
+      : basic_retain_string(string_view_type(text))
+    {
+    }
+
+    basic_retain_string(const basic_retain_string& other) noexcept
+      : m_size(other.m_size)
+      , m_storage(other.m_storage)
+    {
+      if (!this->is_inline())
+      {
+        m_storage.heap.node->count.fetch_add(1, std::memory_order_relaxed);
+      }
+    }
+
+    basic_retain_string(basic_retain_string&& other) noexcept
+      : m_size(std::exchange(other.m_size, 0))
+      , m_storage(other.m_storage)
+    {
+    }
+
+    basic_retain_string& operator=(const basic_retain_string& other) noexcept
+    {
+      basic_retain_string(other).swap(*this);
+      return *this;
+    }
+
+    basic_retain_string& operator=(basic_retain_string&& other) noexcept
+    {
+      basic_retain_string(std::move(other)).swap(*this);
+      return *this;
+    }
+
+    ~basic_retain_string()
+    {
+      if (!this->is_inline())
+      {
+        release(m_storage.heap.node);
+      }
+    }
+
+    /// @}
+
+    [[nodiscard]]
+    size_type size() const noexcept
+    {
+      return m_size;
+    }
+
+    [[nodiscard]]
+    size_type length() const noexcept
+    {
+      return m_size;
+    }
+
+    [[nodiscard]]
+    bool empty() const noexcept
+    {
+      return m_size == 0;
+    }
+
+    /**
+     * \brief checks whether the characters are stored inline, i.e. size() <= small_capacity
+     */
+    [[nodiscard]]
+    bool is_inline() const noexcept
+    {
+      return m_size <= small_capacity;
+    }
+
+    /**
+     * \brief returns the first character; the characters are not null-terminated
+     */
+    [[nodiscard]]
+    const CharT* data() const noexcept
+    {
+      return this->is_inline() ? m_storage.small : m_storage.heap.first;
+    }
+
+    [[nodiscard]]
+    const_iterator begin() const noexcept
+    {
+      return this->data();
+    }
+
+    [[nodiscard]]
+    const_iterator end() const noexcept
+    {
+      return this->data() + m_size;
+    }
+
+    /**
+     * \brief returns the character at pos; requires pos < size()
+     */
+    [[nodiscard]]
+    CharT operator[](size_type pos) const noexcept
+    {
+      return this->data()[pos];
+    }
+
+    /**
+     * \brief returns the character at pos
+     * \note throws std::out_of_range if pos >= size()
+     */
+    [[nodiscard]]
+    CharT at(size_type pos) const
+    {
+      if (pos >= m_size)
+      {
+        throw std::out_of_range("basic_retain_string::at: pos out of range");
+      }
+      return (*this)[pos];
+    }
+
+    [[nodiscard]]
+    CharT front() const noexcept
+    {
+      return (*this)[0];
+    }
+
+    [[nodiscard]]
+    CharT back() const noexcept
+    {
+      return (*this)[m_size - 1];
+    }
+
+    [[nodiscard]]
+    string_view_type view() const noexcept
+    {
+      return string_view_type(this->data(), m_size);
+    }
+
+    operator string_view_type() const noexcept
+    {
+      return this->view();
+    }
+
+    /**
+     * \brief returns a copy of the characters
+     */
+    [[nodiscard]]
+    string_type str() const
+    {
+      return string_type(this->view());
+    }
+
+    /**
+     * \brief returns the substring [pos, pos + min(count, size() - pos)); a substring longer
+     *        than small_capacity characters shares the characters of the string
+     * \note throws std::out_of_range if pos > size()
+     */
+    [[nodiscard]]
+    basic_retain_string substr(size_type pos = 0, size_type count = npos) const
+    {
+      if (pos > m_size)
+      {
+        throw std::out_of_range("basic_retain_string::substr: pos out of range");
+      }
+      count = std::min(count, m_size - pos);
+      if (count <= small_capacity)
+      {
+        return basic_retain_string(this->view().substr(pos, count));
+      }
+      m_storage.heap.node->count.fetch_add(1, std::memory_order_relaxed);
+      return basic_retain_string(heap_view{ m_storage.heap.node, m_storage.heap.first + pos }, count);
+    }
+
+    /**
+     * \brief returns std::hash<string_view_type> of the characters, computed once for the
+     *        strings covering a whole allocation
+     */
+    [[nodiscard]]
+    std::size_t hash() const noexcept
+    {
+      if (this->is_inline() || m_size != m_storage.heap.node->length)
+      {
+        return std::hash<string_view_type>{}(this->view());
+      }
+      auto& cached = m_storage.heap.node->hash;
+      auto h = cached.load(std::memory_order_relaxed);
+      if (h == 0)
+      {
+        h = std::hash<string_view_type>{}(this->view());
+        cached.store(h, std::memory_order_relaxed);
+      }
+      return h;
+    }
+
+    void swap(basic_retain_string& other) noexcept
+    {
+      std::swap(m_size, other.m_size);
+      std::swap(m_storage, other.m_storage);
+    }
+
+    friend void swap(basic_retain_string& lhs, basic_retain_string& rhs) noexcept
+    {
+      lhs.swap(rhs);
+    }
+
+    friend bool operator==(const basic_retain_string& lhs, const basic_retain_string& rhs) noexcept
+    {
+      return lhs.m_size == rhs.m_size && (lhs.data() == rhs.data() || lhs.view() == rhs.view());
+    }
+
+    friend bool operator!=(const basic_retain_string& lhs, const basic_retain_string& rhs) noexcept
+    {
+      return !(lhs == rhs);
+    }
+
+    friend bool operator==(const basic_retain_string& lhs, string_view_type rhs) noexcept
+    {
+      return lhs.view() == rhs;
+    }
+
+    friend bool operator!=(const basic_retain_string& lhs, string_view_type rhs) noexcept
+    {
+      return !(lhs == rhs);
+    }
+
+    friend bool operator<(const basic_retain_string& lhs, const basic_retain_string& rhs) noexcept
+    {
+      return lhs.view() < rhs.view();
+    }
+
+  private:
+    // adopts the reference of the view
+    basic_retain_string(heap_view view, size_type size) noexcept
+      : m_size(size)
+    {
+      m_storage.heap = view;
+    }
+
+    static const header* allocate(string_view_type text)
+    {
+      void* p = ::operator new(sizeof(header) + (text.size() + 1) * sizeof(CharT));
+      auto* node = ::new (p) header;
+      node->length = text.size();
+      Traits::copy(node->chars(), text.data(), text.size());
+      Traits::assign(node->chars()[text.size()], CharT());
+      return node;
+    }
+
+    static void release(const header* node) noexcept
+    {
+      if (node->count.fetch_sub(1, std::memory_order_acq_rel) == 1)
+      {
+        node->~header();
+        ::operator delete(const_cast<header*>(node));
+      }
+    }
+
+    union storage
+    {
+      heap_view heap;
+      CharT small[small_capacity];
+    };
+
+    size_type m_size{ 0 };
+    storage m_storage{};
+  };
+
+  using retain_string = basic_retain_string<char>;
+  using wretain_string = basic_retain_string<wchar_t>;
+} // end of namespace stdx
+
+namespace std
+{
+  /**
+   * \brief The template specialization of std::hash for stdx::basic_retain_string, equal to the
+   *        hash of its std::basic_string_view
+   */
+  template<typename CharT, typename Traits>
+  struct hash<stdx::basic_retain_string<CharT, Traits>>
+  {
+    [[nodiscard]]
+    std::size_t operator()(const stdx::basic_retain_string<CharT, Traits>& s) const noexcept
+    {
+      return s.hash();
+    }
+  };
+} // end of namespace std
+
+#endif
@@ -0,0 +1,431 @@
+#ifndef STDX_RETAIN_VECTOR_H
+#define STDX_RETAIN_VECTOR_H
+
+#include "memory.h"
+#include "type_traits.h"
+#include "utils.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <initializer_list>
+#include <new>
+#include <stdexcept>
+#include <utility>
+
+namespace stdx
+{
+  /**
+   * \brief retain_vector is a sequence of retained pointers with a small inline capacity, relocating
+   *        its elements by copying their bytes.
+   *
+   *        retain_ptr is trivially relocatable: the growth and the insert/erase shifts are a memcpy
+   *        or memmove of the pointers, leaving the reference counts untouched, where std::vector
+   *        moves the elements one at a time. The destruction of the elements is batched: the
+   *        reference counts of the pointees are prefetched a few elements ahead of their release.
+   * \tparam T the type of the retained objects
+   * \tparam Traits the traits suitable for type T
+   * \tparam InlineCapacity the number of elements stored without allocation
+   * \note the iterators are invalidated by the growth and the moves of an inline vector
+   */
+  template<typename T,
+    typename Traits = retain_traits<T>,
+    std::size_t InlineCapacity = 4>
+  class retain_vector
+  {
+  public:
+    using value_type = retain_ptr<T, Traits>;
+    using size_type = std::size_t;
+    using difference_type = std::ptrdiff_t;
+    using reference = value_type&;
+    using const_reference = const value_type&;
+    using iterator = value_type*;
+    using const_iterator = const value_type*;
+
+    static_assert(InlineCapacity > 0, "retain_vector: InlineCapacity must not be zero");
+    static_assert(is_trivially_relocatable_v<value_type>, "retain_vector: retain_ptr<T, Traits> must be trivially relocatable");
+
+    /// @name Construction
+    /// @{
+
+    retain_vector() noexcept = default;
+
+    retain_vector(std::initializer_list<value_type> values)
+    {
+      this->reserve(values.size());
+      for (const auto& value : values)
+      {
+        ::new (static_cast<void*>(m_data + m_size++)) value_type(value);
+      }
+    }
+
+    retain_vector(const retain_vector& other)
+    {
+      this->reserve(other.m_size);
+      for (const auto& value : other)
+      {
+        ::new (static_cast<void*>(m_data + m_size++)) value_type(value);
+      }
+    }
+
+    retain_vector(retain_vector&& other) noexcept
+    {
+      this->steal(other);
+    }
+
+    retain_vector& operator=(const retain_vector& other)
+    {
+      if (this != &other)
+      {
+        *this = retain_vector(other);
+      }
+      return *this;
+    }
+
+    retain_vector& operator=(retain_vector&& other) noexcept
+    {
+      if (this != &other)
+      {
+        this->clear();
+        this->deallocate();
+        this->steal(other);
+      }
+      return *this;
+    }
+
+    ~retain_vector()
+    {
+      destroy(m_data, m_size);
+      this->deallocate();
+    }
+
+    /// @}
+
+    /// @name Element access
+    /// @{
+
+    [[nodiscard]]
+    reference operator[](size_type i) noexcept
+    {
+      return m_data[i];
+    }
+
+    [[nodiscard]]
+    const_reference operator[](size_type i) const noexcept
+    {
+      return m_data[i];
+    }
+
+    [[nodiscard]]
+    reference at(size_type i)
+    {
+      if (i >= m_size)
+      {
+        throw std::out_of_range("retain_vector::at");
+      }
+      return m_data[i];
+    }
+
+    [[nodiscard]]
+    const_reference at(size_type i) const
+    {
+      if (i >= m_size)
+      {
+        throw std::out_of_range("retain_vector::at");
+      }
+      return m_data[i];
+    }
+
+    [[nodiscard]]
+    reference front() noexcept
+    {
+      return m_data[0];
+    }
+
+    [[nodiscard]]
+    const_reference front() const noexcept
+    {
+      return m_data[0];
+    }
+
+    [[nodiscard]]
+    reference back() noexcept
+    {
+      return m_data[m_size - 1];
+    }
+
+    [[nodiscard]]
+    const_reference back() const noexcept
+    {
+      return m_data[m_size - 1];
+    }
+
+    [[nodiscard]]
+    value_type* data() noexcept
+    {
+      return m_data;
+    }
+
+    [[nodiscard]]
+    const value_type* data() const noexcept
+    {
+      return m_data;
+    }
+
+    /// @}
+
+    /// @name Iterators
+    /// @{
+
+    [[nodiscard]]
+    iterator begin() noexcept
+    {
+      return m_data;
+    }
+
+    [[nodiscard]]
+    const_iterator begin() const noexcept
+    {
+      return m_data;
+    }
+
+    [[nodiscard]]
+    iterator end() noexcept
+    {
+      return m_data + m_size;
+    }
+
+    [[nodiscard]]
+    const_iterator end() const noexcept
+    {
+      return m_data + m_size;
+    }
+
+    /// @}
+
+    /// @name Capacity
+    /// @{
+
+    [[nodiscard]]
+    size_type size() const noexcept
+    {
+      return m_size;
+    }
+
+    [[nodiscard]]
+    bool empty() const noexcept
+    {
+      return m_size == 0;
+    }
+
+    [[nodiscard]]
+    size_type capacity() const noexcept
+    {
+      return m_capacity;
+    }
+
+    /**
+     * \brief checks whether the elements are stored in the inline capacity
+     */
+    [[nodiscard]]
+    bool is_inline() const noexcept
+    {
+      return m_data == this->inline_data();
+    }
+
+    /**
+     * \brief grows the capacity to at least n elements, relocating the elements
+     */
+    void reserve(size_type n)
+    {
+      if (n > m_capacity)
+      {
+        this->reallocate(n);
+      }
+    }
+
+    /// @}
+
+    /// @name Modifiers
+    /// @{
+
+    /**
+     * \brief appends the value, moved in without touching its reference count
+     */
+    void push_back(value_type value)
+    {
+      if (m_size == m_capacity)
+      {
+        this->grow();
+      }
+      ::new (static_cast<void*>(m_data + m_size)) value_type(std::move(value));
+      ++m_size;
+    }
+
+    /**
+     * \brief appends the retain_ptr constructed from args
+     */
+    template<typename... Args>
+    reference emplace_back(Args&&... args)
+    {
+      this->push_back(value_type(std::forward<Args>(args)...));
+      return this->back();
+    }
+
+    void pop_back() noexcept
+    {
+      m_data[--m_size].~value_type();
+    }
+
+    /**
+     * \brief inserts the value before pos, the following elements are shifted by a memmove
+     * \return the iterator to the inserted element
+     */
+    iterator insert(const_iterator pos, value_type value)
+    {
+      const auto i = static_cast<size_type>(pos - m_data);
+      if (m_size == m_capacity)
+      {
+        this->grow();
+      }
+      relocate(m_data + i + 1, m_data + i, m_size - i);
+      ::new (static_cast<void*>(m_data + i)) value_type(std::move(value));
+      ++m_size;
+      return m_data + i;
+    }
+
+    /**
+     * \brief releases the element at pos, the following elements are shifted by a memmove
+     * \return the iterator following the erased element
+     */
+    iterator erase(const_iterator pos) noexcept
+    {
+      return this->erase(pos, pos + 1);
+    }
+
+    /**
+     * \brief releases the elements of [first, last), the following elements are shifted by a memmove
+     * \return the iterator following the erased elements
+     */
+    iterator erase(const_iterator first, const_iterator last) noexcept
+    {
+      const auto i = static_cast<size_type>(first - m_data);
+      const auto n = static_cast<size_type>(last - first);
+      destroy(m_data + i, n);
+      relocate(m_data + i, m_data + i + n, m_size - i - n);
+      m_size -= n;
+      return m_data + i;
+    }
+
+    /**
+     * \brief resizes to n elements, the appended elements are null
+     */
+    void resize(size_type n)
+    {
+      if (n < m_size)
+      {
+        this->erase(m_data + n, m_data + m_size);
+        return;
+      }
+      this->reserve(n);
+      for (; m_size < n; ++m_size)
+      {
+        ::new (static_cast<void*>(m_data + m_size)) value_type();
+      }
+    }
+
+    /**
+     * \brief releases all elements, the capacity is kept
+     */
+    void clear() noexcept
+    {
+      destroy(m_data, m_size);
+      m_size = 0;
+    }
+
+    /// @}
+
+  private:
+    // the number of elements whose reference count is prefetched ahead of their release
+    static constexpr size_type prefetch_distance = 8;
+
+    // the releases would otherwise miss the cache one pointee after the other
+    static void destroy(value_type* first, size_type n) noexcept
+    {
+      for (size_type i = 0; i < n && i < prefetch_distance; ++i)
+      {
+        prefetch(first[i].get());
+      }
+      for (size_type i = 0; i < n; ++i)
+      {
+        if (i + prefetch_distance < n)
+        {
+          prefetch(first[i + prefetch_distance].get());
+        }
+        first[i].~value_type();
+      }
+    }
+
+    static void relocate(value_type* to, const value_type* from, size_type n) noexcept
+    {
+      if (n != 0)
+      {
+        std::memmove(static_cast<void*>(to), static_cast<const void*>(from), n * sizeof(value_type));
+      }
+    }
+
+    [[nodiscard]]
+    value_type* inline_data() const noexcept
+    {
+      return reinterpret_cast<value_type*>(const_cast<unsigned char*>(m_inline));
+    }
+
+    void grow()
+    {
+      this->reallocate(std::max(m_capacity * 2, m_size + 1));
+    }
+
+    void reallocate(size_type capacity)
+    {
+      auto* data = static_cast<value_type*>(::operator new(capacity * sizeof(value_type)));
+      relocate(data, m_data, m_size);
+      this->deallocate();
+      m_data = data;
+      m_capacity = capacity;
+    }
+
+    void deallocate() noexcept
+    {
+      if (!this->is_inline())
+      {
+        ::operator delete(m_data);
+      }
+      m_data = this->inline_data();
+      m_capacity = InlineCapacity;
+    }
+
+    // requires this to be empty and inline, other is left empty and inline
+    void steal(retain_vector& other) noexcept
+    {
+      if (other.is_inline())
+      {
+        relocate(m_data, other.m_data, other.m_size);
+      }
+      else
+      {
+        m_data = other.m_data;
+        m_capacity = other.m_capacity;
+        other.m_data = other.inline_data();
+        other.m_capacity = InlineCapacity;
+      }
+      m_size = std::exchange(other.m_size, 0);
+    }
+
+    alignas(value_type) unsigned char m_inline[InlineCapacity * sizeof(value_type)];
+    value_type* m_data{ this->inline_data() };
+    size_type m_size{ 0 };
+    size_type m_capacity{ InlineCapacity };
+  };
+} // end of namespace stdx
+
+#endif
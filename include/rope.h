@@ -0,0 +1,533 @@
+#ifndef STDX_ROPE_H
+#define STDX_ROPE_H
+
+#include "memory.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace stdx
+{
+  namespace detail
+  {
+    /**
+     * \brief an immutable node of a rope: a leaf holds a chunk of the text, a concatenation
+     *        node holds the text of its left child followed by the text of its right child
+     */
+    template<typename CharT, typename Traits>
+    struct rope_node : atomic_reference_count<rope_node<CharT, Traits>>
+    {
+      using node_pointer = retain_ptr<const rope_node>;
+
+      explicit rope_node(std::basic_string_view<CharT, Traits> chunk)
+        : length(chunk.size())
+        , text(chunk)
+      {
+      }
+
+      rope_node(node_pointer l, node_pointer r) noexcept
+        : length(l->length + r->length)
+        , height(std::max(l->height, r->height) + 1)
+        , left(std::move(l))
+        , right(std::move(r))
+      {
+      }
+
+      [[nodiscard]]
+      bool leaf() const noexcept
+      {
+        return height == 0;
+      }
+
+      std::size_t length;
+      std::size_t height{ 0 };
+      node_pointer left;
+      node_pointer right;
+      std::basic_string<CharT, Traits> text;
+    };
+  } // end of namespace detail
+
+  /**
+   * \brief basic_rope is an immutable sequence of characters stored in a height-balanced binary
+   *        tree of retained chunks.
+   *
+   *        The leaves hold chunks of at most 1 KiB. Inserting, erasing and slicing split and join
+   *        O(log n) nodes and share all other nodes, including the leaves, with the original rope;
+   *        copying a rope is O(1). The searches run the char_traits algorithms over the leaves.
+   * \tparam CharT the character type
+   * \tparam Traits the traits of the character type
+   * \note the ropes may be read concurrently
+   */
+  template<typename CharT, typename Traits = std::char_traits<CharT>>
+  class basic_rope
+  {
+    using node = detail::rope_node<CharT, Traits>;
+    using node_pointer = typename node::node_pointer;
+
+  public:
+    using traits_type = Traits;
+    using value_type = CharT;
+    using size_type = std::size_t;
+    using string_type = std::basic_string<CharT, Traits>;
+    using string_view_type = std::basic_string_view<CharT, Traits>;
+
+    static constexpr size_type npos = static_cast<size_type>(-1);
+    static constexpr size_type max_chunk_size = 1024 / sizeof(CharT);
+
+    /// @name Construction
+    /// @{
+
+    basic_rope() noexcept = default;
+
+    explicit basic_rope(string_view_type text)
+      : m_root(build(text))
+    {
+    }
+
+    basic_rope(const basic_rope&) = default;
+    basic_rope(basic_rope&&) noexcept = default;
+    basic_rope& operator=(const basic_rope&) = default;
+    basic_rope& operator=(basic_rope&&) noexcept = default;
+
+    ~basic_rope() = default;
+
+    /// @}
+
+    [[nodiscard]]
+    size_type size() const noexcept
+    {
+      return m_root ? m_root->length : 0;
+    }
+
+    [[nodiscard]]
+    size_type length() const noexcept
+    {
+      return this->size();
+    }
+
+    [[nodiscard]]
+    bool empty() const noexcept
+    {
+      return !m_root;
+    }
+
+    /**
+     * \brief returns the height of the tree, 0 for an empty rope or a single chunk
+     */
+    [[nodiscard]]
+    size_type height() const noexcept
+    {
+      return m_root ? m_root->height : 0;
+    }
+
+    /**
+     * \brief returns the character at pos
+     * \note throws std::out_of_range if pos >= size()
+     */
+    [[nodiscard]]
+    CharT at(size_type pos) const
+    {
+      if (pos >= this->size())
+      {
+        throw std::out_of_range("basic_rope::at: pos out of range");
+      }
+      return (*this)[pos];
+    }
+
+    /**
+     * \brief returns the character at pos; requires pos < size()
+     */
+    [[nodiscard]]
+    CharT operator[](size_type pos) const noexcept
+    {
+      const auto* n = m_root.get();
+      while (!n->leaf())
+      {
+        if (pos < n->left->length)
+        {
+          n = n->left.get();
+        }
+        else
+        {
+          pos -= n->left->length;
+          n = n->right.get();
+        }
+      }
+      return n->text[pos];
+    }
+
+    /**
+     * \brief returns the rope of the characters [pos, pos + count), sharing the nodes of this rope
+     * \note throws std::out_of_range if pos > size()
+     */
+    [[nodiscard]]
+    basic_rope substr(size_type pos, size_type count = npos) const
+    {
+      this->check_position(pos, "basic_rope::substr: pos out of range");
+      count = std::min(count, this->size() - pos);
+      auto tail = split(m_root, pos).second;
+      return basic_rope(split(tail, count).first);
+    }
+
+    /**
+     * \brief returns the rope with other inserted before pos
+     * \note throws std::out_of_range if pos > size()
+     */
+    [[nodiscard]]
+    basic_rope insert(size_type pos, const basic_rope& other) const
+    {
+      this->check_position(pos, "basic_rope::insert: pos out of range");
+      auto [head, tail] = split(m_root, pos);
+      return basic_rope(join(join(std::move(head), other.m_root), std::move(tail)));
+    }
+
+    [[nodiscard]]
+    basic_rope insert(size_type pos, string_view_type text) const
+    {
+      return this->insert(pos, basic_rope(text));
+    }
+
+    /**
+     * \brief returns the rope without the characters [pos, pos + count)
+     * \note throws std::out_of_range if pos > size()
+     */
+    [[nodiscard]]
+    basic_rope erase(size_type pos, size_type count = npos) const
+    {
+      this->check_position(pos, "basic_rope::erase: pos out of range");
+      count = std::min(count, this->size() - pos);
+      auto [head, rest] = split(m_root, pos);
+      return basic_rope(join(std::move(head), split(rest, count).second));
+    }
+
+    [[nodiscard]]
+    basic_rope append(const basic_rope& other) const
+    {
+      return basic_rope(join(m_root, other.m_root));
+    }
+
+    [[nodiscard]]
+    basic_rope append(string_view_type text) const
+    {
+      return this->append(basic_rope(text));
+    }
+
+    friend basic_rope operator+(const basic_rope& lhs, const basic_rope& rhs)
+    {
+      return lhs.append(rhs);
+    }
+
+    /**
+     * \brief returns the position of the first c at or after pos, npos if there is none
+     */
+    [[nodiscard]]
+    size_type find(CharT c, size_type pos = 0) const
+    {
+      auto result = npos;
+      this->visit_chunks(pos, [&result, c](string_view_type chunk, size_type start) {
+        if (const auto i = chunk.find(c); i != string_view_type::npos)
+        {
+          result = start + i;
+          return false;
+        }
+        return true;
+      });
+      return result;
+    }
+
+    /**
+     * \brief returns the position of the first occurrence of text at or after pos, npos if there is none
+     * \note the occurrences spanning several chunks are found by searching the boundaries of the chunks
+     */
+    [[nodiscard]]
+    size_type find(string_view_type text, size_type pos = 0) const
+    {
+      if (text.empty())
+      {
+        return pos <= this->size() ? pos : npos;
+      }
+
+      auto result = npos;
+      // the last text.size() - 1 characters before the current chunk and the position of the first of them
+      string_type carry;
+      size_type carry_start = pos;
+      string_type window;
+      this->visit_chunks(pos, [&](string_view_type chunk, size_type start) {
+        if (!carry.empty())
+        {
+          window.assign(carry);
+          window.append(chunk.substr(0, text.size() - 1));
+          if (const auto i = string_view_type(window).find(text); i < carry.size())
+          {
+            result = carry_start + i;
+            return false;
+          }
+        }
+        if (const auto i = chunk.find(text); i != string_view_type::npos)
+        {
+          result = start + i;
+          return false;
+        }
+
+        const auto keep = text.size() - 1;
+        if (chunk.size() >= keep)
+        {
+          carry.assign(chunk.substr(chunk.size() - keep));
+          carry_start = start + chunk.size() - keep;
+        }
+        else
+        {
+          if (carry.empty())
+          {
+            carry_start = start;
+          }
+          carry.append(chunk);
+          if (carry.size() > keep)
+          {
+            carry_start += carry.size() - keep;
+            carry.erase(0, carry.size() - keep);
+          }
+        }
+        return true;
+      });
+      return result;
+    }
+
+    /**
+     * \brief invokes f(chunk) for the chunks of the rope in order, chunk being a string_view_type
+     */
+    template<typename F>
+    void for_each_chunk(F f) const
+    {
+      this->visit_chunks(0, [&f](string_view_type chunk, size_type) {
+        f(chunk);
+        return true;
+      });
+    }
+
+    /**
+     * \brief returns the text of the rope
+     */
+    [[nodiscard]]
+    string_type str() const
+    {
+      string_type result;
+      result.reserve(this->size());
+      this->for_each_chunk([&result](string_view_type chunk) { result.append(chunk); });
+      return result;
+    }
+
+    friend bool operator==(const basic_rope& lhs, string_view_type rhs)
+    {
+      if (lhs.size() != rhs.size())
+      {
+        return false;
+      }
+      bool equal = true;
+      lhs.visit_chunks(0, [&equal, rhs](string_view_type chunk, size_type start) {
+        equal = rhs.substr(start, chunk.size()) == chunk;
+        return equal;
+      });
+      return equal;
+    }
+
+    friend bool operator!=(const basic_rope& lhs, string_view_type rhs)
+    {
+      return !(lhs == rhs);
+    }
+
+  private:
+    explicit basic_rope(node_pointer root) noexcept
+      : m_root(std::move(root))
+    {
+    }
+
+    void check_position(size_type pos, const char* message) const
+    {
+      if (pos > this->size())
+      {
+        throw std::out_of_range(message);
+      }
+    }
+
+    [[nodiscard]]
+    static node_pointer make_leaf(string_view_type chunk)
+    {
+      return node_pointer(new node(chunk), adopt_object);
+    }
+
+    // joins two trees of heights differing by at most one; two small leaves are merged
+    [[nodiscard]]
+    static node_pointer make_concat(node_pointer l, node_pointer r)
+    {
+      if (l->leaf() && r->leaf() && l->length + r->length <= max_chunk_size)
+      {
+        string_type text;
+        text.reserve(l->length + r->length);
+        text.append(l->text).append(r->text);
+        return make_leaf(text);
+      }
+      return node_pointer(new node(std::move(l), std::move(r)), adopt_object);
+    }
+
+    [[nodiscard]]
+    static std::size_t height_of(const node_pointer& n) noexcept
+    {
+      return n->height;
+    }
+
+    // restores the balance of the concatenation of l and r whose heights differ by at most two
+    [[nodiscard]]
+    static node_pointer balance(node_pointer l, node_pointer r)
+    {
+      if (height_of(r) > height_of(l) + 1)
+      {
+        if (height_of(r->left) > height_of(r->right))
+        {
+          return make_concat(make_concat(std::move(l), r->left->left), make_concat(r->left->right, r->right));
+        }
+        return make_concat(make_concat(std::move(l), r->left), r->right);
+      }
+      if (height_of(l) > height_of(r) + 1)
+      {
+        if (height_of(l->right) > height_of(l->left))
+        {
+          return make_concat(make_concat(l->left, l->right->left), make_concat(l->right->right, std::move(r)));
+        }
+        return make_concat(l->left, make_concat(l->right, std::move(r)));
+      }
+      return make_concat(std::move(l), std::move(r));
+    }
+
+    // the concatenation descends along the spine of the higher tree, O(|height(l) - height(r)|)
+    [[nodiscard]]
+    static node_pointer join(node_pointer l, node_pointer r)
+    {
+      if (!l)
+      {
+        return r;
+      }
+      if (!r)
+      {
+        return l;
+      }
+      if (height_of(l) > height_of(r) + 1)
+      {
+        return balance(l->left, join(l->right, std::move(r)));
+      }
+      if (height_of(r) > height_of(l) + 1)
+      {
+        return balance(join(std::move(l), r->left), r->right);
+      }
+      return make_concat(std::move(l), std::move(r));
+    }
+
+    // splits the tree at pos: the first pos characters and the remaining ones
+    [[nodiscard]]
+    static std::pair<node_pointer, node_pointer> split(const node_pointer& n, size_type pos)
+    {
+      if (!n || pos == 0)
+      {
+        return { nullptr, n };
+      }
+      if (pos >= n->length)
+      {
+        return { n, nullptr };
+      }
+      if (n->leaf())
+      {
+        const string_view_type text(n->text);
+        return { make_leaf(text.substr(0, pos)), make_leaf(text.substr(pos)) };
+      }
+      if (pos < n->left->length)
+      {
+        auto [head, tail] = split(n->left, pos);
+        return { std::move(head), join(std::move(tail), n->right) };
+      }
+      auto [head, tail] = split(n->right, pos - n->left->length);
+      return { join(n->left, std::move(head)), std::move(tail) };
+    }
+
+    // builds a balanced tree of full chunks bottom-up
+    [[nodiscard]]
+    static node_pointer build(string_view_type text)
+    {
+      std::vector<node_pointer> level;
+      for (size_type pos = 0; pos < text.size(); pos += max_chunk_size)
+      {
+        level.push_back(make_leaf(text.substr(pos, max_chunk_size)));
+      }
+      while (level.size() > 1)
+      {
+        std::vector<node_pointer> parents;
+        for (size_type i = 0; i + 1 < level.size(); i += 2)
+        {
+          parents.push_back(join(std::move(level[i]), std::move(level[i + 1])));
+        }
+        if (level.size() % 2 != 0)
+        {
+          parents.back() = join(std::move(parents.back()), std::move(level.back()));
+        }
+        level = std::move(parents);
+      }
+      return level.empty() ? nullptr : std::move(level.front());
+    }
+
+    // invokes f(chunk, start) for the chunks from pos on, the first chunk being cut at pos,
+    // until f returns false
+    template<typename F>
+    void visit_chunks(size_type pos, F&& f) const
+    {
+      if (pos >= this->size())
+      {
+        return;
+      }
+
+      // the right subtrees still to visit and their start positions
+      std::vector<std::pair<const node*, size_type>> pending;
+      const auto* n = m_root.get();
+      size_type start = 0;
+      for (;;)
+      {
+        while (!n->leaf())
+        {
+          if (pos < start + n->left->length)
+          {
+            pending.emplace_back(n->right.get(), start + n->left->length);
+            n = n->left.get();
+          }
+          else
+          {
+            start += n->left->length;
+            n = n->right.get();
+          }
+        }
+
+        const auto offset = pos > start ? pos - start : 0;
+        if (!f(string_view_type(n->text).substr(offset), start + offset))
+        {
+          return;
+        }
+        if (pending.empty())
+        {
+          return;
+        }
+        std::tie(n, start) = pending.back();
+        pending.pop_back();
+      }
+    }
+
+    node_pointer m_root;
+  };
+
+  using rope = basic_rope<char>;
+  using wrope = basic_rope<wchar_t>;
+} // end of namespace stdx
+
+#endif
@@ -0,0 +1,254 @@
+#ifndef STDX_SPSC_RING_H
+#define STDX_SPSC_RING_H
+
+#include "memory.h"
+#include "utils.h"
+
+#include <atomic>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <utility>
+
+namespace stdx
+{
+  /**
+   * \brief spsc_ring is a bounded, lock-free single-producer single-consumer FIFO ring buffer
+   *        of retained objects.
+   *
+   *        The ring stores the raw pointers of the objects: push transfers the ownership
+   *        from the retain_ptr to the ring (retain_ptr::release()), pop transfers it back
+   *        (adopt_object). A transfer through the ring never touches the reference count.
+   *
+   *        The producer and the consumer indices live on separate cache lines, each side
+   *        caches the last observed index of the other side and reloads it only when the
+   *        ring looks full (producer) or empty (consumer).
+   * \tparam T the type of the object managed by the transferred retain_ptr
+   * \tparam Traits the traits suitable for type T
+   * \note the push functions may be called by the single producer thread only,
+   *       the pop functions may be called by the single consumer thread only
+   */
+  template<typename T, typename Traits = retain_traits<T>>
+  class spsc_ring
+  {
+  public:
+    using value_type = retain_ptr<T, Traits>;
+    using pointer = typename value_type::pointer;
+    using size_type = std::size_t;
+
+    /// @name Construction
+    /// @{
+
+    /**
+     * \brief Constructs an empty ring
+     * \param capacity the capacity of the ring (rounded up to a power of two)
+     */
+    explicit spsc_ring(size_type capacity)
+      : m_mask(detail::round_up_to_power_of_two(capacity) - 1)
+      , m_slots(std::make_unique<pointer[]>(m_mask + 1))
+    {
+    }
+
+    spsc_ring(const spsc_ring&) = delete;
+    spsc_ring(spsc_ring&&) = delete;
+    spsc_ring& operator=(const spsc_ring&) = delete;
+    spsc_ring& operator=(spsc_ring&&) = delete;
+
+    /**
+     * \brief destructor; releases all objects remaining in the ring
+     */
+    ~spsc_ring()
+    {
+      // walks the indices: a null pointer pushed by mistake does not stop the walk
+      const auto head = m_producer.head.load(std::memory_order_acquire);
+      for (auto tail = m_consumer.tail.load(std::memory_order_relaxed); tail != head; ++tail)
+      {
+        static_cast<void>(value_type(m_slots[tail & m_mask], adopt_object));
+      }
+    }
+
+    /// @}
+
+    /// @name Producer
+    /// @{
+
+    /**
+     * \brief enqueues the object if the ring is not full
+     * \param value the object to enqueue; requires value != nullptr, a null object
+     *        would be indistinguishable from an empty ring for try_pop
+     * \return true if the object has been enqueued (value is nullptr afterwards),
+     *         false if the ring is full (value is untouched)
+     */
+    bool try_push(value_type&& value) noexcept
+    {
+      const auto head = m_producer.head.load(std::memory_order_relaxed);
+      if (head - m_producer.cached_tail == this->capacity())
+      {
+        m_producer.cached_tail = m_consumer.tail.load(std::memory_order_acquire);
+        if (head - m_producer.cached_tail == this->capacity())
+        {
+          return false;
+        }
+      }
+
+      m_slots[head & m_mask] = value.release();
+      m_producer.head.store(head + 1, std::memory_order_release);
+      return true;
+    }
+
+    /**
+     * \brief enqueues as many objects of the range [first, last) as fit into the ring
+     *        and publishes them at once
+     * \tparam ForwardIt the iterator type; the value type of the iterator has to be value_type,
+     *         the objects of the range must not be null
+     * \param first the beginning of the range of objects to enqueue
+     * \param last the end of the range of objects to enqueue
+     * \return the iterator to the first object which has not been enqueued
+     */
+    template<typename ForwardIt>
+    ForwardIt try_push_bulk(ForwardIt first, ForwardIt last) noexcept
+    {
+      const auto head = m_producer.head.load(std::memory_order_relaxed);
+      auto free = this->capacity() - (head - m_producer.cached_tail);
+      if (free < static_cast<size_type>(std::distance(first, last)))
+      {
+        m_producer.cached_tail = m_consumer.tail.load(std::memory_order_acquire);
+        free = this->capacity() - (head - m_producer.cached_tail);
+      }
+
+      auto pos = head;
+      for (; first != last && free != 0; ++first, --free, ++pos)
+      {
+        m_slots[pos & m_mask] = first->release();
+      }
+
+      if (pos != head)
+      {
+        m_producer.head.store(pos, std::memory_order_release);
+      }
+      return first;
+    }
+
+    /// @}
+
+    /// @name Consumer
+    /// @{
+
+    /**
+     * \brief dequeues the oldest object
+     * \return the dequeued object or nullptr if the ring is empty
+     */
+    [[nodiscard]]
+    value_type try_pop() noexcept
+    {
+      const auto tail = m_consumer.tail.load(std::memory_order_relaxed);
+      if (tail == m_consumer.cached_head)
+      {
+        m_consumer.cached_head = m_producer.head.load(std::memory_order_acquire);
+        if (tail == m_consumer.cached_head)
+        {
+          return {};
+        }
+      }
+
+      auto* ptr = m_slots[tail & m_mask];
+      m_consumer.tail.store(tail + 1, std::memory_order_release);
+      return value_type(ptr, adopt_object);
+    }
+
+    /**
+     * \brief dequeues up to max_count oldest objects and releases their slots at once
+     * \tparam OutputIt the output iterator type accepting value_type
+     * \param out the beginning of the destination range
+     * \param max_count the maximum number of objects to dequeue
+     * \return the number of dequeued objects
+     */
+    template<typename OutputIt>
+    size_type try_pop_bulk(OutputIt out, size_type max_count)
+    {
+      const auto tail = m_consumer.tail.load(std::memory_order_relaxed);
+      auto available = m_consumer.cached_head - tail;
+      if (available < max_count)
+      {
+        m_consumer.cached_head = m_producer.head.load(std::memory_order_acquire);
+        available = m_consumer.cached_head - tail;
+      }
+
+      const auto count = available < max_count ? available : max_count;
+      // the objects adopted before an exception thrown by out leave the ring
+      size_type popped = 0;
+      try
+      {
+        while (popped < count)
+        {
+          value_type value(m_slots[(tail + popped) & m_mask], adopt_object);
+          ++popped;
+          *out = std::move(value);
+          ++out;
+        }
+      }
+      catch (...)
+      {
+        m_consumer.tail.store(tail + popped, std::memory_order_release);
+        throw;
+      }
+
+      if (count != 0)
+      {
+        m_consumer.tail.store(tail + count, std::memory_order_release);
+      }
+      return count;
+    }
+
+    /**
+     * \brief checks whether the ring is empty
+     * \note called by the consumer the result is exact unless a push is in progress
+     */
+    [[nodiscard]]
+    bool empty() const noexcept
+    {
+      return m_consumer.tail.load(std::memory_order_acquire) == m_producer.head.load(std::memory_order_acquire);
+    }
+
+    /// @}
+
+    /**
+     * \brief returns the approximate number of enqueued objects
+     */
+    [[nodiscard]]
+    size_type size() const noexcept
+    {
+      const auto tail = m_consumer.tail.load(std::memory_order_acquire);
+      return m_producer.head.load(std::memory_order_acquire) - tail;
+    }
+
+    /**
+     * \brief returns the maximum number of enqueued objects
+     */
+    [[nodiscard]]
+    size_type capacity() const noexcept
+    {
+      return m_mask + 1;
+    }
+
+  private:
+    struct alignas(cache_line_size) producer_state
+    {
+      std::atomic<size_type> head{ 0 };
+      size_type cached_tail{ 0 };
+    };
+
+    struct alignas(cache_line_size) consumer_state
+    {
+      std::atomic<size_type> tail{ 0 };
+      size_type cached_head{ 0 };
+    };
+
+    const size_type m_mask;
+    const std::unique_ptr<pointer[]> m_slots;
+    producer_state m_producer;
+    consumer_state m_consumer;
+  };
+} // end of namespace stdx
+
+#endif
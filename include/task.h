@@ -0,0 +1,358 @@
+#ifndef STDX_TASK_H
+#define STDX_TASK_H
+
+#include "memory.h"
+#include "memory_pool.h"
+
+#if __cplusplus >= 202002L && defined(__cpp_impl_coroutine)
+
+#include <atomic>
+#include <condition_variable>
+#include <coroutine>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+namespace stdx
+{
+  template<typename T = void>
+  class task;
+
+  namespace detail
+  {
+    /**
+     * \brief the part of the promise of task<T> independent of T
+     */
+    class task_promise_base : public pool_allocated
+    {
+    public:
+      struct final_awaiter
+      {
+        [[nodiscard]]
+        bool await_ready() const noexcept
+        {
+          return false;
+        }
+
+        template<typename Promise>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> h) noexcept
+        {
+          // the frame is kept until its last reference is released
+          auto& promise = h.promise();
+          if (promise.m_continuation)
+          {
+            // symmetric transfer to the awaiting coroutine
+            return promise.m_continuation;
+          }
+          if (promise.m_completion)
+          {
+            promise.m_completion(promise.m_completion_context);
+          }
+          return std::noop_coroutine();
+        }
+
+        void await_resume() const noexcept
+        {
+        }
+      };
+
+      task_promise_base() noexcept = default;
+      task_promise_base(const task_promise_base&) = delete;
+      task_promise_base& operator=(const task_promise_base&) = delete;
+
+      // tasks are lazy, the coroutine starts when it is awaited
+      [[nodiscard]]
+      std::suspend_always initial_suspend() const noexcept
+      {
+        return {};
+      }
+
+      [[nodiscard]]
+      final_awaiter final_suspend() const noexcept
+      {
+        return {};
+      }
+
+      void unhandled_exception() noexcept
+      {
+        m_exception = std::current_exception();
+      }
+
+      void set_continuation(std::coroutine_handle<> continuation) noexcept
+      {
+        m_continuation = continuation;
+      }
+
+      void set_completion(void (*completion)(void*), void* context) noexcept
+      {
+        m_completion = completion;
+        m_completion_context = context;
+      }
+
+    protected:
+      void rethrow_if_exception() const
+      {
+        if (m_exception)
+        {
+          std::rethrow_exception(m_exception);
+        }
+      }
+
+    private:
+      std::coroutine_handle<> m_continuation;
+      // the completion callback of a task which is not awaited by a coroutine (sync_wait)
+      void (*m_completion)(void*) = nullptr;
+      void* m_completion_context = nullptr;
+      std::exception_ptr m_exception;
+    };
+
+    template<typename T>
+    class task_promise final
+      : public task_promise_base
+      , public atomic_reference_count<task_promise<T>>
+    {
+    public:
+      task<T> get_return_object() noexcept;
+
+      template<typename U = T
+        requires_T(std::is_convertible_v<U&&, T>)
+      >
+      void return_value(U&& value) noexcept(std::is_nothrow_constructible_v<T, U&&>)
+      {
+        m_value.emplace(std::forward<U>(value));
+      }
+
+      T& result() &
+      {
+        this->rethrow_if_exception();
+        return *m_value;
+      }
+
+      T result() &&
+      {
+        this->rethrow_if_exception();
+        return std::move(*m_value);
+      }
+
+    private:
+      std::optional<T> m_value;
+    };
+
+    template<>
+    class task_promise<void> final
+      : public task_promise_base
+      , public atomic_reference_count<task_promise<void>>
+    {
+    public:
+      task<void> get_return_object() noexcept;
+
+      void return_void() const noexcept
+      {
+      }
+
+      void result() const
+      {
+        this->rethrow_if_exception();
+      }
+    };
+  } // end of namespace detail
+
+  /**
+   * \brief The specialization of retain_traits for the promises of task<T>:
+   *        the coroutine frame is destroyed when its last reference is released.
+   */
+  template<typename T>
+  struct retain_traits<detail::task_promise<T>> final
+  {
+    using promise_type = detail::task_promise<T>;
+
+    static void increment(promise_type* ptr) noexcept
+    {
+      static_cast<atomic_reference_count<promise_type>*>(ptr)->m_count.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    static void decrement(promise_type* ptr) noexcept
+    {
+      if (static_cast<atomic_reference_count<promise_type>*>(ptr)->m_count.fetch_sub(1, std::memory_order_acq_rel) == 1)
+      {
+        std::coroutine_handle<promise_type>::from_promise(*ptr).destroy();
+      }
+    }
+
+    [[nodiscard]]
+    static long use_count(promise_type* ptr) noexcept
+    {
+      return static_cast<long>(static_cast<atomic_reference_count<promise_type>*>(ptr)->m_count.load(std::memory_order_relaxed));
+    }
+  };
+
+  /**
+   * \brief task<T> is a lazily started coroutine producing a value of type T.
+   *
+   *        The promise of the coroutine derives from atomic_reference_count: the task,
+   *        its awaiters and any scheduler hold retain_ptrs to the coroutine frame, the frame
+   *        is destroyed when the last reference is released. The frames are allocated from
+   *        the memory_pool. Awaiting a task starts it by symmetric transfer, and the completed
+   *        task resumes its awaiter by symmetric transfer: a chain of tasks does not allocate
+   *        beyond the frames.
+   * \tparam T the type of the result, void if the coroutine does not produce a value
+   * \note a task may be awaited once
+   */
+  template<typename T>
+  class task
+  {
+  public:
+    using promise_type = detail::task_promise<T>;
+    using frame_pointer = retain_ptr<promise_type>;
+    using value_type = T;
+
+    /// @name Construction
+    /// @{
+
+    task() noexcept = default;
+
+    explicit task(frame_pointer frame) noexcept
+      : m_frame(std::move(frame))
+    {
+    }
+
+    task(task&&) noexcept = default;
+    task& operator=(task&&) noexcept = default;
+
+    task(const task&) = delete;
+    task& operator=(const task&) = delete;
+
+    ~task() = default;
+
+    /// @}
+
+    /**
+     * \brief checks whether the coroutine has completed
+     */
+    [[nodiscard]]
+    bool is_ready() const noexcept
+    {
+      return !m_frame || std::coroutine_handle<promise_type>::from_promise(*m_frame).done();
+    }
+
+    /**
+     * \brief returns the retained coroutine frame
+     */
+    [[nodiscard]]
+    const frame_pointer& frame() const noexcept
+    {
+      return m_frame;
+    }
+
+    explicit operator bool() const noexcept
+    {
+      return static_cast<bool>(m_frame);
+    }
+
+    auto operator co_await() & noexcept
+    {
+      return awaiter<false>{ m_frame };
+    }
+
+    auto operator co_await() && noexcept
+    {
+      return awaiter<true>{ std::move(m_frame) };
+    }
+
+  private:
+    template<bool Move>
+    struct awaiter
+    {
+      [[nodiscard]]
+      bool await_ready() const noexcept
+      {
+        return std::coroutine_handle<promise_type>::from_promise(*frame).done();
+      }
+
+      std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept
+      {
+        frame->set_continuation(awaiting);
+        return std::coroutine_handle<promise_type>::from_promise(*frame);
+      }
+
+      decltype(auto) await_resume()
+      {
+        if constexpr (Move)
+        {
+          return std::move(*frame).result();
+        }
+        else
+        {
+          return frame->result();
+        }
+      }
+
+      // the awaiter retains the frame while the awaiting coroutine is suspended
+      frame_pointer frame;
+    };
+
+    frame_pointer m_frame;
+  };
+
+  namespace detail
+  {
+    template<typename T>
+    task<T> task_promise<T>::get_return_object() noexcept
+    {
+      return task<T>(retain_ptr<task_promise<T>>(this, adopt_object));
+    }
+
+    inline task<void> task_promise<void>::get_return_object() noexcept
+    {
+      return task<void>(retain_ptr<task_promise<void>>(this, adopt_object));
+    }
+
+    struct sync_wait_state
+    {
+      static void complete(void* context) noexcept
+      {
+        auto* state = static_cast<sync_wait_state*>(context);
+        std::lock_guard lk(state->mutex);
+        state->done = true;
+        state->completed.notify_all();
+      }
+
+      std::mutex mutex;
+      std::condition_variable completed;
+      bool done{ false };
+    };
+  } // end of namespace detail
+
+  /**
+   * \brief starts the task and blocks the calling thread until the task has completed
+   * \param t the task to run; requires t to hold a coroutine which has not been started
+   * \return the result of the task
+   * \note rethrows the exception escaping the coroutine
+   */
+  template<typename T>
+  T sync_wait(task<T> t)
+  {
+    detail::sync_wait_state state;
+    auto* promise = t.frame().get();
+    promise->set_completion(&detail::sync_wait_state::complete, &state);
+    std::coroutine_handle<typename task<T>::promise_type>::from_promise(*promise).resume();
+    {
+      std::unique_lock lk(state.mutex);
+      state.completed.wait(lk, [&state] { return state.done; });
+    }
+    if constexpr (std::is_void_v<T>)
+    {
+      promise->result();
+    }
+    else
+    {
+      return std::move(*promise).result();
+    }
+  }
+} // end of namespace stdx
+
+#endif
+
+#endif
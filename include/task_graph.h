@@ -0,0 +1,286 @@
+#ifndef STDX_TASK_GRAPH_H
+#define STDX_TASK_GRAPH_H
+
+#include "executor.h"
+#include "memory.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace stdx
+{
+  class task_graph;
+
+  /**
+   * \brief task_node is the base type of the nodes of a task_graph. A node is a work_item
+   *        carrying an intrusive counter of its pending dependencies next to its reference count.
+   *
+   *        A node which completes decrements the counters of its successors and submits the
+   *        successors which became ready to the executor running the graph.
+   * \note the edges must not be modified while the graph is running
+   */
+  class task_node : public work_item
+  {
+  public:
+    /**
+     * \brief adds the edge this -> successor; the successor runs after this node has completed
+     * \param successor the node of the same graph depending on this node
+     */
+    void precede(task_node& successor)
+    {
+      m_successors.push_back(&successor);
+      ++successor.m_dependencies;
+    }
+
+    /**
+     * \brief returns the number of nodes this node depends on
+     */
+    [[nodiscard]]
+    std::size_t dependency_count() const noexcept
+    {
+      return m_dependencies;
+    }
+
+    /**
+     * \brief returns the number of nodes depending on this node
+     */
+    [[nodiscard]]
+    std::size_t successor_count() const noexcept
+    {
+      return m_successors.size();
+    }
+
+  protected:
+    task_node() noexcept = default;
+
+    /**
+     * \brief executes the task of the node
+     * \note an exception escaping execute() terminates the program
+     */
+    virtual void execute() = 0;
+
+  private:
+    friend class task_graph;
+
+    void run() final;
+
+    std::atomic<std::size_t> m_pending{ 0 };
+    std::size_t m_dependencies{ 0 };
+    // the nodes are owned by the graph
+    std::vector<task_node*> m_successors;
+    task_graph* m_graph{ nullptr };
+  };
+
+  namespace detail
+  {
+    template<typename F>
+    class function_task_node final : public task_node
+    {
+    public:
+      explicit function_task_node(F f)
+        : m_f(std::move(f))
+      {
+      }
+
+    private:
+      void execute() override
+      {
+        m_f();
+      }
+
+      F m_f;
+    };
+  } // end of namespace detail
+
+  /**
+   * \brief task_graph is a directed acyclic graph of retained task nodes executed
+   *        by a work_stealing_executor.
+   *
+   *        The graph owns its nodes by retain_ptr, the edges are plain pointers between the nodes
+   *        of the graph. Running the graph submits the nodes without dependencies; every completed
+   *        node submits its successors which became ready. The scheduling of a node costs one
+   *        decrement per incoming edge and a single submit; only the sink nodes touch the shared
+   *        completion counter of the graph.
+   * \note the graph may be run again once the previous run has completed
+   * \note a node on a cycle, or depending on one, never becomes ready: run() checks that every
+   *       node is reachable in topological order before submitting any node
+   */
+  class task_graph
+  {
+  public:
+    /// @name Construction
+    /// @{
+
+    task_graph() = default;
+
+    task_graph(const task_graph&) = delete;
+    task_graph(task_graph&&) = delete;
+    task_graph& operator=(const task_graph&) = delete;
+    task_graph& operator=(task_graph&&) = delete;
+
+    ~task_graph() = default;
+
+    /// @}
+
+    /**
+     * \brief adds the node to the graph
+     * \param node the node to add; requires node != nullptr
+     * \return the added node
+     */
+    task_node& add(retain_ptr<task_node> node)
+    {
+      node->m_graph = this;
+      m_nodes.push_back(std::move(node));
+      return *m_nodes.back();
+    }
+
+    /**
+     * \brief creates a node invoking f and adds it to the graph
+     * \param f the function to invoke; f must not throw
+     * \return the added node
+     */
+    template<typename F>
+    task_node& emplace(F&& f)
+    {
+      return this->add(retain_ptr<task_node>(new detail::function_task_node<std::decay_t<F>>(std::forward<F>(f)), adopt_object));
+    }
+
+    /**
+     * \brief runs all nodes of the graph and waits until all of them have completed
+     * \param executor the executor running the nodes
+     * \note the calling thread runs pending work items of the executor while it waits
+     * \note throws std::logic_error if the graph has a cycle; no node runs then
+     */
+    void run(work_stealing_executor& executor)
+    {
+      if (this->sorted_count() != m_nodes.size())
+      {
+        throw std::logic_error("task_graph::run: the graph has a cycle");
+      }
+      if (m_nodes.empty())
+      {
+        return;
+      }
+
+      // an acyclic graph has at least one sink
+
+      std::size_t sinks = 0;
+      for (auto& n : m_nodes)
+      {
+        n->m_pending.store(n->m_dependencies, std::memory_order_relaxed);
+        if (n->m_successors.empty())
+        {
+          ++sinks;
+        }
+      }
+
+      m_executor = &executor;
+      m_done = false;
+      m_pending_sinks.store(sinks, std::memory_order_relaxed);
+      for (auto& n : m_nodes)
+      {
+        if (n->m_dependencies == 0)
+        {
+          executor.submit(retain_ptr<work_item>(n.get(), retain_object));
+        }
+      }
+
+      while (m_pending_sinks.load(std::memory_order_acquire) != 0 && executor.try_run_one())
+      {
+      }
+
+      // waits for the notification, the last sink may still be notifying
+      std::unique_lock lk(m_mutex);
+      m_completed.wait(lk, [this] { return m_done; });
+    }
+
+    /**
+     * \brief returns the number of nodes
+     */
+    [[nodiscard]]
+    std::size_t size() const noexcept
+    {
+      return m_nodes.size();
+    }
+
+  private:
+    friend class task_node;
+
+    // Kahn's algorithm on the pending counters: returns the number of nodes reachable in
+    // topological order, less than size() if the graph has a cycle
+    std::size_t sorted_count()
+    {
+      std::vector<task_node*> ready;
+      for (auto& n : m_nodes)
+      {
+        n->m_pending.store(n->m_dependencies, std::memory_order_relaxed);
+        if (n->m_dependencies == 0)
+        {
+          ready.push_back(n.get());
+        }
+      }
+
+      std::size_t sorted = 0;
+      while (!ready.empty())
+      {
+        auto* n = ready.back();
+        ready.pop_back();
+        ++sorted;
+        for (auto* successor : n->m_successors)
+        {
+          if (successor->m_pending.fetch_sub(1, std::memory_order_relaxed) == 1)
+          {
+            ready.push_back(successor);
+          }
+        }
+      }
+      return sorted;
+    }
+
+    void sink_completed()
+    {
+      if (m_pending_sinks.fetch_sub(1, std::memory_order_acq_rel) == 1)
+      {
+        std::lock_guard lk(m_mutex);
+        m_done = true;
+        m_completed.notify_all();
+      }
+    }
+
+    std::vector<retain_ptr<task_node>> m_nodes;
+    work_stealing_executor* m_executor{ nullptr };
+    std::atomic<std::size_t> m_pending_sinks{ 0 };
+    std::mutex m_mutex;
+    std::condition_variable m_completed;
+    bool m_done{ false };
+  };
+
+  inline void task_node::run()
+  {
+    this->execute();
+
+    if (m_successors.empty())
+    {
+      m_graph->sink_completed();
+      return;
+    }
+
+    // the graph may complete as soon as the last successor has been released
+    auto& executor = *m_graph->m_executor;
+    for (auto* successor : m_successors)
+    {
+      if (successor->m_pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+      {
+        executor.submit(retain_ptr<work_item>(successor, retain_object));
+      }
+    }
+  }
+} // end of namespace stdx
+
+#endif
@@ -161,6 +161,25 @@ namespace stdx
    */
   template<typename T>
   inline constexpr bool is_standard_arithmetic_v = is_standard_arithmetic<T>::value;
+
+  /**
+   * \brief if an object of type T may be relocated by copying its bytes, i.e. moving it to a new
+   *        location then destroying the source is equivalent to a memcpy, provides the member
+   *        constant value equal to true. The trivially copyable types are trivially relocatable,
+   *        other types opt in by specializing is_trivially_relocatable.
+   * \tparam T a type to check
+   * \note containers may relocate their elements with memcpy/memmove instead of move and destroy
+   */
+  template<typename T>
+  struct is_trivially_relocatable : std::is_trivially_copyable<T>
+  {
+  };
+
+  /**
+   * \brief helper variable template
+   */
+  template<typename T>
+  inline constexpr bool is_trivially_relocatable_v = is_trivially_relocatable<T>::value;
 }
 
 #endif
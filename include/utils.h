@@ -1,6 +1,8 @@
 #ifndef STDX_UTILS_H
 #define STDX_UTILS_H
 
+#include <cstddef>
+#include <cstdint>
 #include <functional>
 #include <limits>
 #include <type_traits>
@@ -113,8 +115,73 @@ namespace detail
       return static_cast<To>(from);
     }
   }
+
+  /**
+   * \brief returns the smallest power of two not less than n
+   * \param n the value to round up
+   * \return the rounded value; 1 for n == 0
+   */
+  [[nodiscard]]
+  constexpr std::size_t round_up_to_power_of_two(std::size_t n) noexcept
+  {
+    std::size_t result = 1;
+    while (result < n)
+    {
+      result <<= 1U;
+    }
+    return result;
+  }
+
+  /**
+   * \brief returns the number of bits set in x
+   */
+  [[nodiscard]]
+  constexpr unsigned popcount(std::uint32_t x) noexcept
+  {
+    x = x - ((x >> 1U) & 0x55555555U);
+    x = (x & 0x33333333U) + ((x >> 2U) & 0x33333333U);
+    x = (x + (x >> 4U)) & 0x0F0F0F0FU;
+    return static_cast<unsigned>((x * 0x01010101U) >> 24U);
+  }
+
+  /**
+   * \brief returns h with its bits mixed (the finalizer of MurmurHash3), so that the low bits
+   *        select shards and buckets evenly even for hashes whose low bits are constant,
+   *        e.g. the addresses hashed by std::hash<retain_ptr>
+   */
+  [[nodiscard]]
+  constexpr std::size_t mix_hash(std::size_t h) noexcept
+  {
+    auto k = static_cast<std::uint64_t>(h);
+    k ^= k >> 33U;
+    k *= 0xFF51AFD7ED558CCDULL;
+    k ^= k >> 33U;
+    k *= 0xC4CEB9FE1A85EC53ULL;
+    k ^= k >> 33U;
+    return static_cast<std::size_t>(k);
+  }
 } // end of namespace detail
 
+  /**
+   * \brief the assumed size of a cache line (destructive interference size)
+   * \note the data members of concurrent types, which are written by different threads,
+   *       are aligned to cache_line_size to prevent false sharing
+   */
+  inline constexpr std::size_t cache_line_size = 64;
+
+  /**
+   * \brief hints the processor to fetch the cache line of p for a read
+   * \note a no-op on the compilers without a prefetch builtin
+   */
+  inline void prefetch(const void* p) noexcept
+  {
+#if defined(__GNUC__) || defined(__clang__)
+    __builtin_prefetch(p);
+#else
+    static_cast<void>(p);
+#endif
+  }
+
   /**
    * \brief narrowing cast which saturate the output value at min or max if the input value
    *       overflow/underflow the value range of output To type.
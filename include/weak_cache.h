@@ -0,0 +1,300 @@
+#ifndef STDX_WEAK_CACHE_H
+#define STDX_WEAK_CACHE_H
+
+#include "intern_table.h"
+#include "memory.h"
+#include "utils.h"
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+
+namespace stdx
+{
+  namespace detail
+  {
+    /**
+     * \brief a value of a weak_cache followed by its key
+     */
+    template<typename K, typename V>
+    struct weak_cache_node final : interned_node<V>
+    {
+      template<typename... Args>
+      weak_cache_node(const K& k, std::size_t h, intern_shard_base<V>* s, Args&&... args)
+        : interned_node<V>(h, s, std::forward<Args>(args)...)
+        , key(k)
+      {
+      }
+
+      const K key;
+    };
+  } // end of namespace detail
+
+  /**
+   * \brief weak_cache maps keys to retained values without extending their lifetime.
+   *
+   *        The cache holds its values weakly: a value is removed from the cache by the release of
+   *        its last reference (intern_traits::decrement), the cache follows the live set of values
+   *        without any expiration policy. A lookup retains a found value only if its reference
+   *        count has not yet dropped to zero. The cache is sharded by the hash of the keys, each
+   *        shard is locked independently.
+   * \tparam K the key type
+   * \tparam V the type of the values, a non-final class type
+   * \tparam Hash the hash function of the key type
+   * \tparam KeyEqual the equality predicate of the key type
+   * \note the pointers may outlive the cache, but must not be released while the cache is destroyed
+   */
+  template<typename K, typename V,
+    typename Hash = std::hash<K>,
+    typename KeyEqual = std::equal_to<K>>
+  class weak_cache
+  {
+    static_assert(std::is_class_v<V> && !std::is_final_v<V>, "weak_cache<K, V>: V must be a non-final class type");
+
+    using node = detail::weak_cache_node<K, V>;
+
+  public:
+    using key_type = K;
+    using value_type = V;
+    using pointer = retain_ptr<V, intern_traits<V>>;
+    using hasher = Hash;
+    using key_equal = KeyEqual;
+    using size_type = std::size_t;
+
+    /// @name Construction
+    /// @{
+
+    /**
+     * \brief Constructs an empty cache
+     * \param shard_count the number of independently locked shards (rounded up to a power of two)
+     */
+    explicit weak_cache(size_type shard_count = 64, const Hash& hash = Hash(), const KeyEqual& equal = KeyEqual())
+      : m_shard_mask(detail::round_up_to_power_of_two(shard_count) - 1)
+      , m_shards(std::make_unique<shard[]>(m_shard_mask + 1))
+      , m_hash(hash)
+      , m_equal(equal)
+    {
+    }
+
+    weak_cache(const weak_cache&) = delete;
+    weak_cache(weak_cache&&) = delete;
+    weak_cache& operator=(const weak_cache&) = delete;
+    weak_cache& operator=(weak_cache&&) = delete;
+
+    // the values still referenced, cached or erased, are detached, their last release deletes them
+    ~weak_cache()
+    {
+      for (size_type i = 0; i <= m_shard_mask; ++i)
+      {
+        auto& s = m_shards[i];
+        std::lock_guard lk(s.mutex);
+        for (auto& [h, n] : s.nodes)
+        {
+          n->shard = nullptr;
+        }
+        for (auto* n : s.erased)
+        {
+          n->shard = nullptr;
+        }
+      }
+    }
+
+    /// @}
+
+    /**
+     * \brief returns the live value of the key, nullptr if there is none
+     */
+    [[nodiscard]]
+    pointer find(const key_type& key) const
+    {
+      const auto h = m_hash(key);
+      auto& s = this->shard_of(h);
+      std::lock_guard lk(s.mutex);
+      if (auto* n = this->find_locked(s, key, h); n && n->try_retain())
+      {
+        return pointer(n, adopt_object);
+      }
+      return nullptr;
+    }
+
+    /**
+     * \brief returns the live value of the key, constructing it from args if there is none
+     */
+    template<typename... Args
+      requires_T(std::is_constructible_v<V, Args&&...>)
+    >
+    [[nodiscard]]
+    pointer try_emplace(const key_type& key, Args&&... args)
+    {
+      const auto h = m_hash(key);
+      auto& s = this->shard_of(h);
+      std::lock_guard lk(s.mutex);
+      auto it = this->slot_of(s, key, h);
+      if (it != s.nodes.end() && it->second->try_retain())
+      {
+        return pointer(it->second, adopt_object);
+      }
+      auto* n = new node(key, h, &s, std::forward<Args>(args)...);
+      this->store(s, it, n);
+      return pointer(n, adopt_object);
+    }
+
+    /**
+     * \brief returns the live value of the key, caching the value returned by make() if there is none
+     * \note make is invoked without holding the lock of the shard, the value created concurrently
+     *       by another thread for the same key is returned in place of the value made by this call
+     */
+    template<typename F
+      requires_T(std::is_constructible_v<V, std::invoke_result_t<F&>>)
+    >
+    [[nodiscard]]
+    pointer get_or_create(const key_type& key, F make)
+    {
+      if (auto p = this->find(key))
+      {
+        return p;
+      }
+      const auto h = m_hash(key);
+      auto& s = this->shard_of(h);
+      auto* made = new node(key, h, &s, make());
+      std::lock_guard lk(s.mutex);
+      auto it = this->slot_of(s, key, h);
+      if (it != s.nodes.end() && it->second->try_retain())
+      {
+        // the made value has never been published
+        delete made;
+        return pointer(it->second, adopt_object);
+      }
+      this->store(s, it, made);
+      return pointer(made, adopt_object);
+    }
+
+    /**
+     * \brief removes the key from the cache, its value stays alive as long as it is referenced
+     * \return true if the key has been removed
+     */
+    bool erase(const key_type& key)
+    {
+      const auto h = m_hash(key);
+      auto& s = this->shard_of(h);
+      std::lock_guard lk(s.mutex);
+      auto it = this->slot_of(s, key, h);
+      if (it == s.nodes.end())
+      {
+        return false;
+      }
+      // the node releases itself to the shard until the cache is destroyed, the shard keeps track of it
+      s.erased.insert(it->second);
+      s.nodes.erase(it);
+      return true;
+    }
+
+    /**
+     * \brief returns the number of cached values, including the ones being released
+     */
+    [[nodiscard]]
+    size_type size() const
+    {
+      size_type result = 0;
+      for (size_type i = 0; i <= m_shard_mask; ++i)
+      {
+        auto& s = m_shards[i];
+        std::lock_guard lk(s.mutex);
+        result += s.nodes.size();
+      }
+      return result;
+    }
+
+    /**
+     * \brief returns the number of shards
+     */
+    [[nodiscard]]
+    size_type shard_count() const noexcept
+    {
+      return m_shard_mask + 1;
+    }
+
+  private:
+    struct alignas(cache_line_size) shard final : detail::intern_shard_base<V>
+    {
+      void release(const detail::interned_node<V>* n) noexcept override
+      {
+        {
+          std::lock_guard lk(mutex);
+          const auto [first, last] = nodes.equal_range(n->hash);
+          auto it = first;
+          while (it != last && it->second != n)
+          {
+            ++it;
+          }
+          if (it != last)
+          {
+            nodes.erase(it);
+          }
+          else
+          {
+            erased.erase(const_cast<node*>(static_cast<const node*>(n)));
+          }
+        }
+        delete n;
+      }
+
+      std::mutex mutex;
+      // the nodes by the hash of their key
+      std::unordered_multimap<std::size_t, node*> nodes;
+      // the erased nodes still referenced
+      std::unordered_set<node*> erased;
+    };
+
+    using iterator = typename std::unordered_multimap<std::size_t, node*>::iterator;
+
+    shard& shard_of(std::size_t h) const noexcept
+    {
+      return m_shards[h & m_shard_mask];
+    }
+
+    iterator slot_of(shard& s, const key_type& key, std::size_t h) const
+    {
+      const auto [first, last] = s.nodes.equal_range(h);
+      for (auto it = first; it != last; ++it)
+      {
+        if (m_equal(it->second->key, key))
+        {
+          return it;
+        }
+      }
+      return s.nodes.end();
+    }
+
+    node* find_locked(shard& s, const key_type& key, std::size_t h) const
+    {
+      const auto it = this->slot_of(s, key, h);
+      return it != s.nodes.end() ? it->second : nullptr;
+    }
+
+    // a dying node is replaced in its slot, its last owner finds it replaced
+    static void store(shard& s, iterator it, node* n)
+    {
+      if (it != s.nodes.end())
+      {
+        it->second = n;
+      }
+      else
+      {
+        s.nodes.emplace(n->hash, n);
+      }
+    }
+
+    const size_type m_shard_mask;
+    const std::unique_ptr<shard[]> m_shards;
+    Hash m_hash;
+    KeyEqual m_equal;
+  };
+} // end of namespace stdx
+
+#endif
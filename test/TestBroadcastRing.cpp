@@ -0,0 +1,155 @@
+#include <broadcast_ring.h>
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace stdx::test
+{
+  struct Tick : stdx::atomic_reference_count<Tick>
+  {
+    inline static std::atomic<long> instances{ 0L };
+
+    explicit Tick(int v)
+      : value(v)
+    {
+      ++instances;
+    }
+
+    Tick(const Tick&) = delete;
+    Tick& operator=(const Tick&) = delete;
+
+    ~Tick()
+    {
+      --instances;
+    }
+
+    int value;
+  };
+
+  using TickRing = stdx::broadcast_ring<Tick>;
+
+  TEST(StdX_BroadcastRing, every_consumer_receives_every_object)
+  {
+    TickRing ring(8, 3);
+    EXPECT_EQ(ring.capacity(), 8U);
+    EXPECT_EQ(ring.consumer_count(), 3U);
+
+    for (int i = 0; i < 5; ++i)
+    {
+      EXPECT_TRUE(ring.try_publish(stdx::make_retain<Tick>(i)));
+    }
+    EXPECT_EQ(ring.cursor(), 5U);
+
+    for (std::size_t c = 0; c < 3; ++c)
+    {
+      EXPECT_EQ(ring.pending(c), 5U);
+      int expected = 0;
+      EXPECT_EQ(ring.poll(c, [&expected](const TickRing::value_type& tick) {
+        EXPECT_EQ(tick->value, expected);
+        ++expected;
+      }), 5U);
+      EXPECT_EQ(ring.pending(c), 0U);
+      EXPECT_EQ(ring.poll(c, [](const TickRing::value_type&) {}), 0U);
+    }
+  }
+
+  TEST(StdX_BroadcastRing, single_reference_per_slot)
+  {
+    TickRing ring(4, 4);
+    auto tick = stdx::make_retain<Tick>(0);
+    const auto observer = tick;
+    ring.try_publish(std::move(tick));
+    EXPECT_EQ(observer.use_count(), 2);
+
+    for (std::size_t c = 0; c < 4; ++c)
+    {
+      ring.poll(c, [&observer](const TickRing::value_type& t) {
+        EXPECT_EQ(t, observer);
+        EXPECT_EQ(t.use_count(), 2);
+      });
+    }
+    EXPECT_EQ(observer.use_count(), 2);
+
+    // all consumers have passed the slot, the producer releases its reference
+    ring.release_consumed();
+    EXPECT_EQ(observer.use_count(), 1);
+  }
+
+  TEST(StdX_BroadcastRing, slowest_consumer_gates_the_producer)
+  {
+    Tick::instances = 0L;
+    {
+      TickRing ring(2, 2);
+      EXPECT_TRUE(ring.try_publish(stdx::make_retain<Tick>(0)));
+      EXPECT_TRUE(ring.try_publish(stdx::make_retain<Tick>(1)));
+
+      auto rejected = stdx::make_retain<Tick>(2);
+      EXPECT_FALSE(ring.try_publish(std::move(rejected)));
+      EXPECT_TRUE(rejected); // NOLINT(bugprone-use-after-move)
+
+      // the first consumer alone does not free a slot
+      EXPECT_EQ(ring.poll(0, [](const TickRing::value_type&) {}), 2U);
+      EXPECT_FALSE(ring.try_publish(std::move(rejected)));
+
+      EXPECT_EQ(ring.poll(1, [](const TickRing::value_type&) {}, 1), 1U);
+      EXPECT_TRUE(ring.try_publish(std::move(rejected)));
+      EXPECT_EQ(Tick::instances, 2);
+
+      int value = -1;
+      EXPECT_EQ(ring.poll(1, [&value](const TickRing::value_type& t) { value = t->value; }), 2U);
+      EXPECT_EQ(value, 2);
+    }
+    EXPECT_EQ(Tick::instances, 0);
+  }
+
+  TEST(StdX_BroadcastRing, concurrent_consumers)
+  {
+    Tick::instances = 0L;
+    constexpr int count = 20000;
+    constexpr std::size_t consumers = 4;
+    {
+      TickRing ring(64, consumers);
+      std::vector<std::thread> threads;
+      std::vector<long long> sums(consumers, 0);
+      for (std::size_t c = 0; c < consumers; ++c)
+      {
+        threads.emplace_back([&ring, &sums, c] {
+          int received = 0;
+          int expected = 0;
+          while (received < count)
+          {
+            const auto n = ring.poll(c, [&](const TickRing::value_type& t) {
+              EXPECT_EQ(t->value, expected);
+              ++expected;
+              sums[c] += t->value;
+            });
+            received += static_cast<int>(n);
+            if (n == 0)
+            {
+              std::this_thread::yield();
+            }
+          }
+        });
+      }
+
+      for (int i = 0; i < count; ++i)
+      {
+        ring.publish(stdx::make_retain<Tick>(i));
+      }
+      for (auto& t : threads)
+      {
+        t.join();
+      }
+
+      for (const auto sum : sums)
+      {
+        EXPECT_EQ(sum, static_cast<long long>(count) * (count - 1) / 2);
+      }
+      ring.release_consumed();
+      EXPECT_EQ(Tick::instances, 0);
+    }
+  }
+} // end of namespace stdx::test
@@ -0,0 +1,217 @@
+#include <clock_cache.h>
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace stdx::test
+{
+  struct Blob : stdx::atomic_reference_count<Blob>
+  {
+    inline static std::atomic<long> instances{ 0L };
+
+    explicit Blob(std::size_t n)
+      : size(n)
+    {
+      ++instances;
+    }
+
+    ~Blob()
+    {
+      --instances;
+    }
+
+    std::size_t size;
+  };
+
+  struct BlobSize
+  {
+    std::size_t operator()(const Blob& b) const noexcept
+    {
+      return b.size;
+    }
+  };
+
+  TEST(StdX_ClockCache, evicts_unreferenced_entries)
+  {
+    stdx::clock_cache<int, Blob> cache(4, 1);
+    for (int i = 0; i < 4; ++i)
+    {
+      EXPECT_TRUE(cache.insert(i, stdx::make_retain<Blob>(1)));
+    }
+    EXPECT_FALSE(cache.insert(0, stdx::make_retain<Blob>(1)));
+    EXPECT_EQ(cache.size(), 4U);
+
+    // the hits mark 0 and 2, the hand evicts 1 then 3
+    EXPECT_TRUE(cache.find(0));
+    EXPECT_TRUE(cache.find(2));
+    cache.insert(4, stdx::make_retain<Blob>(1));
+    EXPECT_EQ(cache.size(), 4U);
+    EXPECT_FALSE(cache.contains(1));
+    EXPECT_TRUE(cache.contains(0));
+    EXPECT_TRUE(cache.contains(2));
+    cache.insert(5, stdx::make_retain<Blob>(1));
+    EXPECT_FALSE(cache.contains(3));
+    EXPECT_TRUE(cache.contains(4));
+    EXPECT_FALSE(cache.find(3));
+  }
+
+  TEST(StdX_ClockCache, retained_values_are_not_evicted)
+  {
+    stdx::clock_cache<int, Blob> cache(2, 1);
+    const auto pinned = stdx::make_retain<Blob>(1);
+    cache.insert(0, pinned);
+    cache.insert(1, stdx::make_retain<Blob>(1));
+    cache.insert(2, stdx::make_retain<Blob>(1));
+    EXPECT_TRUE(cache.contains(0));
+    EXPECT_FALSE(cache.contains(1));
+
+    // all entries retained outside: the shard exceeds its capacity
+    const auto other = cache.find(2);
+    cache.insert(3, stdx::make_retain<Blob>(1));
+    EXPECT_TRUE(cache.contains(0));
+    EXPECT_TRUE(cache.contains(2));
+    EXPECT_EQ(cache.find(0), pinned);
+  }
+
+  TEST(StdX_ClockCache, capacity_counts_costs)
+  {
+    auto& domain = stdx::epoch_domain::instance();
+    domain.synchronize();
+    Blob::instances = 0;
+    {
+      stdx::clock_cache<std::string, Blob, std::hash<std::string>, std::equal_to<std::string>, stdx::retain_traits<Blob>, BlobSize> cache(100, 1);
+      cache.insert("a", stdx::make_retain<Blob>(60));
+      cache.insert("b", stdx::make_retain<Blob>(30));
+      EXPECT_EQ(cache.total_cost(), 90U);
+      cache.insert_or_assign("b", stdx::make_retain<Blob>(20));
+      EXPECT_EQ(cache.total_cost(), 80U);
+      cache.insert("c", stdx::make_retain<Blob>(50));
+      EXPECT_EQ(cache.total_cost(), 70U);
+      EXPECT_FALSE(cache.contains("a"));
+      EXPECT_TRUE(cache.contains("b"));
+      EXPECT_TRUE(cache.erase("b"));
+      EXPECT_TRUE(cache.erase("c"));
+      EXPECT_FALSE(cache.erase("c"));
+      EXPECT_EQ(cache.size(), 0U);
+
+      domain.synchronize();
+      EXPECT_EQ(Blob::instances, 0);
+      cache.insert("d", stdx::make_retain<Blob>(1));
+      cache.clear();
+      EXPECT_EQ(cache.total_cost(), 0U);
+    }
+    domain.synchronize();
+    EXPECT_EQ(Blob::instances, 0);
+  }
+
+  // a key whose copy throws once the countdown reaches 0
+  struct FragileKey
+  {
+    inline static int copies_left = -1;
+
+    explicit FragileKey(int v)
+      : value(v)
+    {
+    }
+
+    FragileKey(const FragileKey& other)
+      : value(other.value)
+    {
+      if (copies_left >= 0 && copies_left-- == 0)
+      {
+        throw std::runtime_error("FragileKey: copy");
+      }
+    }
+
+    FragileKey& operator=(const FragileKey&) = default;
+    ~FragileKey() = default;
+
+    friend bool operator==(const FragileKey& lhs, const FragileKey& rhs) noexcept
+    {
+      return lhs.value == rhs.value;
+    }
+
+    int value;
+  };
+
+  struct FragileKeyHash
+  {
+    std::size_t operator()(const FragileKey& k) const noexcept
+    {
+      return std::hash<int>{}(k.value);
+    }
+  };
+
+  TEST(StdX_ClockCache, throwing_insertion_leaves_the_cache_unchanged)
+  {
+    stdx::clock_cache<FragileKey, Blob, FragileKeyHash> cache(4, 1);
+    EXPECT_TRUE(cache.insert(FragileKey(0), stdx::make_retain<Blob>(1)));
+
+    // the entry copies the key, the index copies it again
+    FragileKey::copies_left = 1;
+    EXPECT_THROW(cache.insert(FragileKey(1), stdx::make_retain<Blob>(1)), std::runtime_error);
+    FragileKey::copies_left = -1;
+    EXPECT_EQ(cache.size(), 1U);
+    EXPECT_EQ(cache.total_cost(), 1U);
+    EXPECT_FALSE(cache.contains(FragileKey(1)));
+
+    for (int i = 2; i < 8; ++i)
+    {
+      cache.insert(FragileKey(i), stdx::make_retain<Blob>(1));
+    }
+    EXPECT_EQ(cache.size(), 4U);
+    cache.clear();
+    EXPECT_EQ(cache.size(), 0U);
+  }
+
+  TEST(StdX_ClockCache, pointer_keys_use_all_shards)
+  {
+    // aligned pointers share their low bits: unmixed, they would crowd 4 of the 64 shards
+    // and overflow them; mixed, the 8 keys per shard on average stay far below 64
+    std::vector<std::unique_ptr<std::max_align_t>> keys;
+    stdx::clock_cache<const std::max_align_t*, Blob> cache(64 * 64, 64);
+    for (int i = 0; i < 512; ++i)
+    {
+      keys.push_back(std::make_unique<std::max_align_t>());
+      cache.insert(keys.back().get(), stdx::make_retain<Blob>(1));
+    }
+    EXPECT_EQ(cache.size(), 512U);
+  }
+
+  TEST(StdX_ClockCache, concurrent_hits_and_inserts)
+  {
+    stdx::clock_cache<int, Blob> cache(64, 4);
+    std::vector<std::thread> threads;
+    std::atomic<long> hits{ 0 };
+    for (int t = 0; t < 4; ++t)
+    {
+      threads.emplace_back([&cache, &hits, t] {
+        for (int i = 0; i < 5000; ++i)
+        {
+          const auto key = (i * 7 + t) % 128;
+          if (auto value = cache.find(key))
+          {
+            hits += static_cast<long>(value->size);
+          }
+          else
+          {
+            cache.insert_or_assign(key, stdx::make_retain<Blob>(1));
+          }
+        }
+      });
+    }
+    for (auto& t : threads)
+    {
+      t.join();
+    }
+    EXPECT_GT(hits, 0);
+    EXPECT_LE(cache.size(), cache.capacity());
+  }
+} // end of namespace stdx::test
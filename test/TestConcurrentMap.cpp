@@ -0,0 +1,219 @@
+#include <concurrent_map.h>
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace stdx::test
+{
+  struct Entry : stdx::atomic_reference_count<Entry>
+  {
+    inline static std::atomic<long> instances{ 0L };
+
+    explicit Entry(int v)
+      : value(v)
+    {
+      ++instances;
+    }
+
+    Entry(const Entry&) = delete;
+    Entry& operator=(const Entry&) = delete;
+
+    ~Entry()
+    {
+      --instances;
+    }
+
+    int value;
+  };
+
+  using EntryMap = stdx::concurrent_map<std::string, Entry>;
+
+  TEST(StdX_ConcurrentMap, insert_find_erase)
+  {
+    EntryMap map(4);
+    EXPECT_EQ(map.shard_count(), 4U);
+    EXPECT_TRUE(map.empty());
+    EXPECT_FALSE(map.find("a"));
+
+    EXPECT_TRUE(map.insert("a", stdx::make_retain<Entry>(1)));
+    EXPECT_FALSE(map.insert("a", stdx::make_retain<Entry>(2)));
+    EXPECT_TRUE(map.insert_or_assign("b", stdx::make_retain<Entry>(3)));
+    EXPECT_FALSE(map.insert_or_assign("b", stdx::make_retain<Entry>(4)));
+    EXPECT_EQ(map.size(), 2U);
+
+    ASSERT_TRUE(map.find("a"));
+    EXPECT_EQ(map.find("a")->value, 1);
+    EXPECT_EQ(map.find("b")->value, 4);
+    EXPECT_TRUE(map.contains("b"));
+
+    EXPECT_TRUE(map.erase("a"));
+    EXPECT_FALSE(map.erase("a"));
+    EXPECT_FALSE(map.contains("a"));
+    EXPECT_EQ(map.size(), 1U);
+  }
+
+  TEST(StdX_ConcurrentMap, borrowed_and_owning_lookups)
+  {
+    EntryMap map;
+    auto entry = stdx::make_retain<Entry>(7);
+    map.insert("a", entry);
+    EXPECT_EQ(entry.use_count(), 2);
+
+    {
+      const auto borrowed = map.borrow("a");
+      ASSERT_TRUE(borrowed);
+      EXPECT_EQ(borrowed.get(), entry.get());
+      EXPECT_EQ(borrowed->value, 7);
+      EXPECT_EQ(entry.use_count(), 2);
+      EXPECT_EQ(borrowed.retain(), entry);
+    }
+    EXPECT_FALSE(map.borrow("b"));
+
+    int value = 0;
+    EXPECT_TRUE(map.visit("a", [&value](Entry& e) { value = e.value; }));
+    EXPECT_FALSE(map.visit("b", [&value](Entry&) { value = -1; }));
+    EXPECT_EQ(value, 7);
+    EXPECT_EQ(entry.use_count(), 2);
+
+    const auto owned = map.find("a");
+    EXPECT_EQ(owned, entry);
+    EXPECT_EQ(entry.use_count(), 3);
+  }
+
+  TEST(StdX_ConcurrentMap, released_values_are_reclaimed)
+  {
+    auto& domain = stdx::epoch_domain::instance();
+    domain.synchronize();
+    Entry::instances = 0L;
+    {
+      EntryMap map(2);
+      for (int i = 0; i < 100; ++i)
+      {
+        map.insert(std::to_string(i), stdx::make_retain<Entry>(i));
+      }
+      // replaced values stay alive until no reader may observe them
+      map.insert_or_assign("0", stdx::make_retain<Entry>(100));
+      map.erase("1");
+      EXPECT_EQ(map.size(), 99U);
+
+      domain.synchronize();
+      EXPECT_EQ(Entry::instances, 99);
+
+      int count = 0;
+      map.for_each([&count](const std::string& key, Entry& e) {
+        EXPECT_EQ(key == "0" ? 100 : std::stoi(key), e.value);
+        ++count;
+      });
+      EXPECT_EQ(count, 99);
+
+      map.clear();
+      EXPECT_TRUE(map.empty());
+      map.insert("x", stdx::make_retain<Entry>(0));
+    }
+    domain.synchronize();
+    EXPECT_EQ(Entry::instances, 0);
+  }
+
+  TEST(StdX_ConcurrentMap, pointer_keys)
+  {
+    using Key = stdx::retain_ptr<Entry>;
+    stdx::concurrent_map<Key, Entry> map;
+    const auto key = stdx::make_retain<Entry>(1);
+    map.insert(key, stdx::make_retain<Entry>(2));
+
+    EXPECT_EQ(map.find(key)->value, 2);
+    EXPECT_FALSE(map.find(stdx::make_retain<Entry>(1)));
+
+    // the addresses, whose low bits are zero, spread over the shards
+    std::vector<Key> keys;
+    for (int i = 0; i < 4096; ++i)
+    {
+      keys.push_back(stdx::make_retain<Entry>(i));
+      map.insert(keys.back(), stdx::make_retain<Entry>(i));
+    }
+    std::size_t used = 0;
+    std::size_t largest = 0;
+    for (std::size_t i = 0; i < map.shard_count(); ++i)
+    {
+      used += map.shard_size(i) != 0 ? 1 : 0;
+      largest = std::max(largest, map.shard_size(i));
+    }
+    EXPECT_EQ(used, map.shard_count());
+    EXPECT_LT(largest, 2 * 4097 / map.shard_count());
+    EXPECT_EQ(map.find(keys[100])->value, 100);
+  }
+
+  TEST(StdX_ConcurrentMap, concurrent_readers_and_writers)
+  {
+    auto& domain = stdx::epoch_domain::instance();
+    domain.synchronize();
+    Entry::instances = 0L;
+    constexpr int keys = 256;
+    {
+      stdx::concurrent_map<int, Entry> map(8);
+      for (int k = 0; k < keys; k += 2)
+      {
+        map.insert(k, stdx::make_retain<Entry>(k));
+      }
+
+      std::atomic<bool> done{ false };
+      std::vector<std::thread> readers;
+      for (int r = 0; r < 3; ++r)
+      {
+        readers.emplace_back([&map, &done] {
+          while (!done)
+          {
+            for (int k = 0; k < keys; ++k)
+            {
+              if (const auto e = map.find(k); e)
+              {
+                EXPECT_EQ(e->value % keys, k);
+              }
+              map.visit(k, [k](Entry& e) { EXPECT_EQ(e.value % keys, k); });
+            }
+          }
+        });
+      }
+
+      std::vector<std::thread> writers;
+      for (int w = 0; w < 2; ++w)
+      {
+        writers.emplace_back([&map, w] {
+          for (int round = 1; round <= 20; ++round)
+          {
+            for (int k = w; k < keys; k += 2)
+            {
+              map.insert_or_assign(k, stdx::make_retain<Entry>(k + round * keys));
+              if (round % 3 == 0)
+              {
+                map.erase(k);
+              }
+            }
+          }
+        });
+      }
+      for (auto& t : writers)
+      {
+        t.join();
+      }
+      done = true;
+      for (auto& t : readers)
+      {
+        t.join();
+      }
+
+      for (int k = 0; k < keys; ++k)
+      {
+        ASSERT_TRUE(map.find(k));
+        EXPECT_EQ(map.find(k)->value, k + 20 * keys);
+      }
+    }
+    domain.synchronize();
+    EXPECT_EQ(Entry::instances, 0);
+  }
+} // end of namespace stdx::test
@@ -0,0 +1,267 @@
+#include <concurrent_skiplist.h>
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace stdx::test
+{
+  struct Payload
+  {
+    inline static std::atomic<long> instances{ 0L };
+
+    explicit Payload(int v)
+      : value(v)
+    {
+      ++instances;
+    }
+
+    Payload(const Payload& other)
+      : value(other.value)
+    {
+      ++instances;
+    }
+
+    Payload& operator=(const Payload&) = delete;
+
+    ~Payload()
+    {
+      --instances;
+    }
+
+    int value;
+  };
+
+  using PayloadList = stdx::concurrent_skiplist<int, Payload>;
+
+  TEST(StdX_ConcurrentSkiplist, insert_find_erase)
+  {
+    PayloadList list;
+    EXPECT_TRUE(list.empty());
+    EXPECT_EQ(list.begin(), list.end());
+
+    for (const int k : { 5, 1, 9, 3, 7 })
+    {
+      EXPECT_TRUE(list.emplace(k, k * 10));
+    }
+    EXPECT_FALSE(list.emplace(3, 0));
+    EXPECT_TRUE(list.insert({ 4, Payload(40) }));
+    EXPECT_EQ(list.size(), 6U);
+
+    ASSERT_NE(list.find(7), list.end());
+    EXPECT_EQ(list.find(7)->second.value, 70);
+    EXPECT_EQ(list.find(2), list.end());
+    EXPECT_TRUE(list.contains(9));
+    EXPECT_FALSE(list.contains(10));
+
+    EXPECT_TRUE(list.erase(5));
+    EXPECT_FALSE(list.erase(5));
+    EXPECT_FALSE(list.contains(5));
+    EXPECT_EQ(list.size(), 5U);
+
+    std::vector<int> keys;
+    for (const auto& [key, payload] : list)
+    {
+      EXPECT_EQ(payload.value, key * 10);
+      keys.push_back(key);
+    }
+    EXPECT_EQ(keys, (std::vector<int>{ 1, 3, 4, 7, 9 }));
+  }
+
+  TEST(StdX_ConcurrentSkiplist, bounds_and_ranges)
+  {
+    PayloadList list;
+    for (int k = 0; k < 100; k += 10)
+    {
+      list.emplace(k, k);
+    }
+
+    EXPECT_EQ(list.lower_bound(30)->first, 30);
+    EXPECT_EQ(list.lower_bound(31)->first, 40);
+    EXPECT_EQ(list.upper_bound(30)->first, 40);
+    EXPECT_EQ(list.lower_bound(91), list.end());
+    EXPECT_EQ(list.upper_bound(90), list.end());
+
+    std::vector<int> keys;
+    EXPECT_EQ(list.for_each_in_range(15, 55, [&keys](const PayloadList::value_type& v) { keys.push_back(v.first); }), 4U);
+    EXPECT_EQ(keys, (std::vector<int>{ 20, 30, 40, 50 }));
+    EXPECT_EQ(list.for_each_in_range(95, 200, [](const PayloadList::value_type&) {}), 0U);
+  }
+
+  TEST(StdX_ConcurrentSkiplist, iterator_survives_erasure)
+  {
+    auto& domain = stdx::epoch_domain::instance();
+    domain.synchronize();
+    Payload::instances = 0L;
+    {
+      PayloadList list;
+      for (int k = 0; k < 5; ++k)
+      {
+        list.emplace(k, k);
+      }
+
+      auto it = list.find(2);
+      list.erase(2);
+      list.erase(3);
+      domain.synchronize();
+
+      // the iterator retains the erased node (which retains its erased successor)
+      // and continues with the live successors
+      EXPECT_EQ(Payload::instances, 5);
+      EXPECT_EQ(it->second.value, 2);
+      ++it;
+      ASSERT_NE(it, list.end());
+      EXPECT_EQ(it->first, 4);
+      ++it;
+      EXPECT_EQ(it, list.end());
+      EXPECT_EQ(Payload::instances, 3);
+    }
+    domain.synchronize();
+    EXPECT_EQ(Payload::instances, 0);
+  }
+
+  TEST(StdX_ConcurrentSkiplist, erased_chain_released_by_iterator)
+  {
+    auto& domain = stdx::epoch_domain::instance();
+    domain.synchronize();
+    Payload::instances = 0L;
+    {
+      PayloadList list;
+      constexpr int count = 200000;
+      for (int k = 0; k < count; ++k)
+      {
+        list.emplace(k, k);
+      }
+
+      // the iterator retains the whole chain of erased nodes
+      auto it = list.begin();
+      for (int k = 0; k < count; ++k)
+      {
+        list.erase(k);
+      }
+      domain.synchronize();
+      EXPECT_EQ(Payload::instances, count);
+      it = list.end();
+      EXPECT_EQ(Payload::instances, 0);
+    }
+    domain.synchronize();
+    EXPECT_EQ(Payload::instances, 0);
+  }
+
+  struct Fragile
+  {
+    inline static bool fail = false;
+
+    explicit Fragile(int v)
+      : value(v)
+    {
+      if (fail)
+      {
+        throw std::runtime_error("construction failed");
+      }
+    }
+
+    int value;
+  };
+
+  TEST(StdX_ConcurrentSkiplist, throwing_value_constructor)
+  {
+    stdx::concurrent_skiplist<int, Fragile> list;
+    for (int k = 0; k < 100; k += 2)
+    {
+      list.emplace(k, k);
+    }
+    Fragile::fail = true;
+    for (int k = 1; k < 100; k += 2)
+    {
+      EXPECT_THROW(list.emplace(k, k), std::runtime_error);
+    }
+    Fragile::fail = false;
+
+    // the predecessors have been left unlocked
+    for (int k = 1; k < 100; k += 2)
+    {
+      EXPECT_TRUE(list.emplace(k, k));
+    }
+    EXPECT_TRUE(list.erase(50));
+    EXPECT_EQ(list.size(), 99U);
+    EXPECT_FALSE(list.emplace(51, 0));
+  }
+
+  TEST(StdX_ConcurrentSkiplist, concurrent_scans_and_updates)
+  {
+    auto& domain = stdx::epoch_domain::instance();
+    domain.synchronize();
+    Payload::instances = 0L;
+    static constexpr int keys = 512;
+    {
+      PayloadList list;
+      std::atomic<bool> done{ false };
+      std::vector<std::thread> readers;
+      for (int r = 0; r < 2; ++r)
+      {
+        readers.emplace_back([&list, &done] {
+          while (!done)
+          {
+            int previous = -1;
+            list.for_each_in_range(0, keys, [&previous](const PayloadList::value_type& v) {
+              EXPECT_LT(previous, v.first);
+              EXPECT_EQ(v.first, v.second.value);
+              previous = v.first;
+            });
+
+            previous = -1;
+            for (auto it = list.lower_bound(keys / 2); it != list.end(); ++it)
+            {
+              EXPECT_LT(previous, it->first);
+              previous = it->first;
+            }
+          }
+        });
+      }
+
+      std::vector<std::thread> writers;
+      for (int w = 0; w < 2; ++w)
+      {
+        writers.emplace_back([&list, w] {
+          for (int round = 0; round < 10; ++round)
+          {
+            for (int k = w; k < keys; k += 2)
+            {
+              list.emplace(k, k);
+            }
+            for (int k = w; k < keys; k += 4)
+            {
+              list.erase(k);
+            }
+          }
+        });
+      }
+      for (auto& t : writers)
+      {
+        t.join();
+      }
+      done = true;
+      for (auto& t : readers)
+      {
+        t.join();
+      }
+
+      EXPECT_EQ(list.size(), static_cast<std::size_t>(keys / 2));
+      std::size_t count = 0;
+      for (const auto& v : list)
+      {
+        EXPECT_NE(v.first % 4, 0);
+        EXPECT_NE(v.first % 4, 1);
+        ++count;
+      }
+      EXPECT_EQ(count, list.size());
+    }
+    domain.synchronize();
+    EXPECT_EQ(Payload::instances, 0);
+  }
+} // end of namespace stdx::test
@@ -0,0 +1,112 @@
+#include <cow_ptr.h>
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace stdx::test
+{
+  struct CowValue : stdx::atomic_reference_count<CowValue>
+  {
+    inline static std::atomic<long> copies{ 0L };
+
+    CowValue() = default;
+
+    CowValue(const CowValue& other)
+      : stdx::atomic_reference_count<CowValue>(other)
+      , items(other.items)
+    {
+      ++copies;
+    }
+
+    std::vector<int> items;
+  };
+
+  TEST(StdX_CowPtr, write_clones_shared_object_only)
+  {
+    CowValue::copies = 0;
+    auto a = stdx::make_cow<CowValue>();
+    EXPECT_TRUE(a.unique());
+
+    // a unique object is modified in place
+    auto& items = a.write().items;
+    for (int i = 0; i < 100; ++i)
+    {
+      items.push_back(i);
+    }
+    EXPECT_EQ(CowValue::copies, 0);
+
+    auto b = a;
+    EXPECT_EQ(a, b);
+    EXPECT_FALSE(a.unique());
+    EXPECT_EQ(&a.read(), &b.read());
+
+    b.write().items.push_back(100);
+    EXPECT_EQ(CowValue::copies, 1);
+    EXPECT_NE(a, b);
+    EXPECT_TRUE(a.unique());
+    EXPECT_TRUE(b.unique());
+    EXPECT_EQ(a->items.size(), 100U);
+    EXPECT_EQ(b->items.size(), 101U);
+
+    b.write().items.push_back(101);
+    EXPECT_EQ(CowValue::copies, 1);
+
+    b.reset();
+    EXPECT_EQ(b, nullptr);
+    EXPECT_NE(a, nullptr);
+  }
+
+  TEST(StdX_CowPtr, make_mut_on_retain_ptr)
+  {
+    auto p = stdx::make_retain<CowValue>();
+    auto shared = p;
+    auto* original = p.get();
+
+    stdx::make_mut(p).items.push_back(1);
+    EXPECT_NE(p.get(), original);
+    EXPECT_EQ(shared.get(), original);
+    EXPECT_TRUE(shared->items.empty());
+
+    auto* copy = p.get();
+    stdx::make_mut(p).items.push_back(2);
+    EXPECT_EQ(p.get(), copy);
+    EXPECT_EQ(p->items.size(), 2U);
+  }
+
+  TEST(StdX_CowPtr, readers_on_other_threads)
+  {
+    auto value = stdx::make_cow<CowValue>();
+    value.write().items.assign(64, 1);
+
+    std::vector<std::thread> readers;
+    std::atomic<long> sum{ 0 };
+    for (int t = 0; t < 4; ++t)
+    {
+      readers.emplace_back([snapshot = value, &sum]() mutable {
+        long local = 0;
+        for (auto i : snapshot.read().items)
+        {
+          local += i;
+        }
+        sum += local;
+        snapshot.reset();
+      });
+    }
+
+    // the writer clones while the snapshots are alive and modifies in place afterwards
+    for (int i = 0; i < 1000; ++i)
+    {
+      value.write().items[static_cast<std::size_t>(i % 64)] = 2;
+    }
+    for (auto& r : readers)
+    {
+      r.join();
+    }
+    EXPECT_EQ(sum, 4 * 64);
+    EXPECT_TRUE(value.unique());
+  }
+} // end of namespace stdx::test
@@ -0,0 +1,195 @@
+#include <cycle_collector.h>
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+namespace stdx::test
+{
+  struct GraphNode : stdx::collectable<GraphNode>
+  {
+    inline static long instances = 0;
+
+    explicit GraphNode(int i = 0)
+      : id(i)
+    {
+      ++instances;
+    }
+
+    ~GraphNode() override
+    {
+      --instances;
+    }
+
+    template<typename Visitor>
+    void trace(Visitor& v) const
+    {
+      v(next);
+      for (const auto& child : children)
+      {
+        v(child);
+      }
+    }
+
+    int id;
+    stdx::cycle_ptr<GraphNode> next;
+    std::vector<stdx::cycle_ptr<GraphNode>> children;
+  };
+
+  struct Connection;
+
+  struct Session : stdx::collectable<Session>
+  {
+    inline static long instances = 0;
+
+    Session()
+    {
+      ++instances;
+    }
+
+    ~Session() override
+    {
+      --instances;
+    }
+
+    template<typename Visitor>
+    void trace(Visitor& v) const
+    {
+      v(connection);
+    }
+
+    stdx::cycle_ptr<Connection> connection;
+  };
+
+  struct Connection : stdx::collectable<Connection>
+  {
+    template<typename Visitor>
+    void trace(Visitor& v) const
+    {
+      v(session);
+    }
+
+    stdx::cycle_ptr<Session> session;
+  };
+
+  TEST(StdX_CycleCollector, acyclic_objects_are_released_immediately)
+  {
+    auto& collector = stdx::cycle_collector::instance();
+    collector.collect();
+    GraphNode::instances = 0;
+    {
+      auto a = stdx::make_collectable<GraphNode>(1);
+      a->next = stdx::make_collectable<GraphNode>(2);
+      auto b = a->next;
+      EXPECT_EQ(b.use_count(), 2);
+    }
+    EXPECT_EQ(GraphNode::instances, 0);
+    EXPECT_EQ(collector.collect(), 0U);
+  }
+
+  TEST(StdX_CycleCollector, garbage_cycles_are_collected)
+  {
+    auto& collector = stdx::cycle_collector::instance();
+    collector.collect();
+    Session::instances = 0;
+    {
+      auto session = stdx::make_collectable<Session>();
+      session->connection = stdx::make_collectable<Connection>();
+      session->connection->session = session;
+    }
+    EXPECT_EQ(Session::instances, 1);
+    EXPECT_EQ(collector.candidates(), 1U);
+    EXPECT_EQ(collector.collect(), 2U);
+    EXPECT_EQ(Session::instances, 0);
+    EXPECT_EQ(collector.candidates(), 0U);
+  }
+
+  TEST(StdX_CycleCollector, referenced_cycles_survive)
+  {
+    auto& collector = stdx::cycle_collector::instance();
+    collector.collect();
+    GraphNode::instances = 0;
+
+    auto live = stdx::make_collectable<GraphNode>(0);
+    {
+      auto parent = stdx::make_collectable<GraphNode>(1);
+      auto child = stdx::make_collectable<GraphNode>(2);
+      parent->children.push_back(child);
+      child->next = parent;
+      child->children.push_back(live);
+      live->next = child;
+    }
+    EXPECT_EQ(collector.collect(), 0U);
+    EXPECT_EQ(GraphNode::instances, 3);
+    EXPECT_EQ(live->next.use_count(), 2);
+    EXPECT_EQ(live->next->next->children.front(), live->next);
+
+    // the cycle referencing the live object becomes garbage
+    auto child = std::move(live->next);
+    child->children.clear();
+    child.reset();
+    EXPECT_EQ(collector.collect(), 2U);
+    EXPECT_EQ(GraphNode::instances, 1);
+    EXPECT_EQ(live.use_count(), 1);
+  }
+
+  TEST(StdX_CycleCollector, garbage_referencing_live_objects)
+  {
+    auto& collector = stdx::cycle_collector::instance();
+    collector.collect();
+    GraphNode::instances = 0;
+
+    auto live = stdx::make_collectable<GraphNode>(0);
+    {
+      auto a = stdx::make_collectable<GraphNode>(1);
+      auto b = stdx::make_collectable<GraphNode>(2);
+      a->next = b;
+      b->next = a;
+      a->children.push_back(live);
+      b->children.push_back(live);
+    }
+    EXPECT_EQ(live.use_count(), 3);
+    EXPECT_EQ(collector.collect(), 2U);
+    EXPECT_EQ(live.use_count(), 1);
+    EXPECT_EQ(GraphNode::instances, 1);
+  }
+
+  TEST(StdX_CycleCollector, threshold_bounds_the_candidates)
+  {
+    auto& collector = stdx::cycle_collector::instance();
+    collector.collect();
+    collector.set_threshold(16);
+    GraphNode::instances = 0;
+    for (int i = 0; i < 1000; ++i)
+    {
+      auto a = stdx::make_collectable<GraphNode>(i);
+      a->next = stdx::make_collectable<GraphNode>(i);
+      a->next->next = a;
+      EXPECT_LT(collector.candidates(), 16U);
+    }
+    EXPECT_LE(GraphNode::instances, 32);
+    collector.collect();
+    EXPECT_EQ(GraphNode::instances, 0);
+    collector.set_threshold(stdx::cycle_collector::default_threshold);
+  }
+
+  TEST(StdX_CycleCollector, long_rings)
+  {
+    auto& collector = stdx::cycle_collector::instance();
+    collector.collect();
+    GraphNode::instances = 0;
+    {
+      auto head = stdx::make_collectable<GraphNode>(0);
+      auto tail = head;
+      for (int i = 1; i < 100000; ++i)
+      {
+        tail->next = stdx::make_collectable<GraphNode>(i);
+        tail = tail->next;
+      }
+      tail->next = head;
+    }
+    EXPECT_EQ(GraphNode::instances, 100000);
+    EXPECT_EQ(collector.collect(), 100000U);
+    EXPECT_EQ(GraphNode::instances, 0);
+  }
+} // end of namespace stdx::test
@@ -0,0 +1,106 @@
+#include <epoch.h>
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <thread>
+
+namespace stdx::test
+{
+  struct Garbage : stdx::atomic_reference_count<Garbage>
+  {
+    inline static std::atomic<long> instances{ 0L };
+
+    Garbage()
+    {
+      ++instances;
+    }
+
+    Garbage(const Garbage&) = delete;
+    Garbage& operator=(const Garbage&) = delete;
+
+    ~Garbage()
+    {
+      --instances;
+    }
+  };
+
+  TEST(StdX_Epoch, retired_reference_outlives_guard)
+  {
+    auto& domain = stdx::epoch_domain::instance();
+    domain.synchronize();
+    Garbage::instances = 0L;
+
+    auto garbage = stdx::make_retain<Garbage>();
+    auto* raw = garbage.get();
+    {
+      const auto g = domain.pin();
+      domain.retire(std::move(garbage));
+      domain.collect();
+      // the retiring guard may still observe the object
+      EXPECT_EQ(Garbage::instances, 1);
+      EXPECT_EQ(stdx::retain_traits<Garbage>::use_count(raw), 1);
+    }
+    domain.synchronize();
+    EXPECT_EQ(Garbage::instances, 0);
+  }
+
+  TEST(StdX_Epoch, pinned_thread_blocks_reclamation)
+  {
+    auto& domain = stdx::epoch_domain::instance();
+    domain.synchronize();
+    Garbage::instances = 0L;
+
+    std::atomic<bool> pinned{ false };
+    std::atomic<bool> done{ false };
+    std::thread reader([&] {
+      const auto g = domain.pin();
+      pinned = true;
+      while (!done)
+      {
+        std::this_thread::yield();
+      }
+    });
+    while (!pinned)
+    {
+      std::this_thread::yield();
+    }
+
+    {
+      const auto g = domain.pin();
+      domain.retire(stdx::make_retain<Garbage>());
+    }
+    for (int i = 0; i < 10; ++i)
+    {
+      domain.collect();
+    }
+    EXPECT_EQ(Garbage::instances, 1);
+
+    done = true;
+    reader.join();
+    domain.synchronize();
+    EXPECT_EQ(Garbage::instances, 0);
+  }
+
+  TEST(StdX_Epoch, nested_guards_and_orphans)
+  {
+    auto& domain = stdx::epoch_domain::instance();
+    domain.synchronize();
+    Garbage::instances = 0L;
+
+    std::thread retirer([&domain] {
+      const auto outer = domain.pin();
+      {
+        const auto inner = domain.pin();
+        domain.retire(stdx::make_retain<Garbage>());
+      }
+      domain.retire(stdx::make_retain<Garbage>());
+    });
+    retirer.join();
+    EXPECT_EQ(Garbage::instances, 2);
+
+    // the objects retired by the exited thread are reclaimed by the others
+    domain.synchronize();
+    EXPECT_EQ(Garbage::instances, 0);
+  }
+} // end of namespace stdx::test
@@ -0,0 +1,131 @@
+#include <executor.h>
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <thread>
+
+namespace stdx::test
+{
+  struct CountingItem final : stdx::work_item
+  {
+    inline static std::atomic<long> instances{ 0L };
+
+    explicit CountingItem(std::atomic<int>& c)
+      : counter(c)
+    {
+      ++instances;
+    }
+
+    ~CountingItem() override
+    {
+      --instances;
+    }
+
+    void run() override
+    {
+      ++counter;
+    }
+
+    std::atomic<int>& counter;
+  };
+
+  TEST(StdX_Executor, runs_submitted_items)
+  {
+    CountingItem::instances = 0L;
+    std::atomic<int> counter{ 0 };
+    {
+      stdx::work_stealing_executor executor(4);
+      EXPECT_EQ(executor.thread_count(), 4U);
+      for (int i = 0; i < 1000; ++i)
+      {
+        executor.submit(stdx::make_retain<CountingItem>(counter));
+      }
+    }
+    // the destructor runs all pending items
+    EXPECT_EQ(counter, 1000);
+    EXPECT_EQ(CountingItem::instances, 0);
+  }
+
+  TEST(StdX_Executor, submitted_reference_is_released_after_run)
+  {
+    std::atomic<int> counter{ 0 };
+    const auto item = stdx::make_retain<CountingItem>(counter);
+    {
+      stdx::work_stealing_executor executor(2);
+      executor.submit(item);
+      while (counter.load() == 0)
+      {
+        std::this_thread::yield();
+      }
+    }
+    EXPECT_EQ(item.use_count(), 1);
+  }
+
+  TEST(StdX_Executor, post_function)
+  {
+    std::atomic<int> counter{ 0 };
+    {
+      stdx::work_stealing_executor executor(2);
+      for (int i = 0; i < 100; ++i)
+      {
+        executor.post([&counter] { ++counter; });
+      }
+    }
+    EXPECT_EQ(counter, 100);
+  }
+
+  void spawn_tree(stdx::work_stealing_executor& executor, std::atomic<int>& leaves, int depth)
+  {
+    if (depth == 0)
+    {
+      ++leaves;
+      return;
+    }
+    for (int i = 0; i < 2; ++i)
+    {
+      executor.post([&executor, &leaves, depth] { spawn_tree(executor, leaves, depth - 1); });
+    }
+  }
+
+  TEST(StdX_Executor, fork_join_from_workers)
+  {
+    std::atomic<int> leaves{ 0 };
+    stdx::work_stealing_executor executor(4);
+    executor.post([&executor, &leaves] { spawn_tree(executor, leaves, 12); });
+
+    // the waiting thread helps the executor
+    while (leaves.load() != (1 << 12))
+    {
+      if (!executor.try_run_one())
+      {
+        std::this_thread::yield();
+      }
+    }
+    EXPECT_EQ(leaves.load(), 1 << 12);
+  }
+
+  TEST(StdX_Executor, chase_lev_deque)
+  {
+    stdx::detail::chase_lev_deque<int> deque(2);
+    int values[8] = {};
+    EXPECT_TRUE(deque.empty());
+    EXPECT_EQ(deque.take(), nullptr);
+    EXPECT_EQ(deque.steal(), nullptr);
+
+    // the deque grows beyond its initial capacity
+    for (auto& v : values)
+    {
+      deque.push(&v);
+    }
+    EXPECT_EQ(deque.steal(), &values[0]);
+    EXPECT_EQ(deque.take(), &values[7]);
+    EXPECT_EQ(deque.steal(), &values[1]);
+    for (int i = 6; i >= 2; --i)
+    {
+      EXPECT_EQ(deque.take(), &values[i]);
+    }
+    EXPECT_TRUE(deque.empty());
+    EXPECT_EQ(deque.take(), nullptr);
+  }
+} // end of namespace stdx::test
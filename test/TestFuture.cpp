@@ -0,0 +1,124 @@
+#include <future.h>
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace stdx::test
+{
+  TEST(StdX_Future, value_and_void)
+  {
+    stdx::promise<std::string> p;
+    auto f = p.get_future();
+    EXPECT_TRUE(f.valid());
+    EXPECT_FALSE(f.is_ready());
+    p.set_value("ready");
+    EXPECT_TRUE(f.is_ready());
+    EXPECT_EQ(f.get(), "ready");
+    EXPECT_FALSE(f.valid());
+
+    stdx::promise<void> v;
+    auto g = v.get_future();
+    v.set_value();
+    EXPECT_NO_THROW(g.get());
+
+    EXPECT_EQ(stdx::make_ready_future<int>(7).get(), 7);
+  }
+
+  TEST(StdX_Future, errors)
+  {
+    stdx::promise<int> p;
+    auto f = p.get_future();
+    EXPECT_THROW((void)p.get_future(), std::future_error);
+    p.set_exception(std::make_exception_ptr(std::runtime_error("failed")));
+    EXPECT_THROW(p.set_value(1), std::future_error);
+    EXPECT_THROW((void)f.get(), std::runtime_error);
+
+    stdx::future<int> broken;
+    {
+      stdx::promise<int> q;
+      broken = q.get_future();
+    }
+    try
+    {
+      (void)broken.get();
+      FAIL() << "expected broken_promise";
+    }
+    catch (const std::future_error& e)
+    {
+      EXPECT_EQ(e.code(), std::future_errc::broken_promise);
+    }
+  }
+
+  TEST(StdX_Future, then_chains_continuations)
+  {
+    // attached before the completion, runs on the completing thread
+    stdx::promise<int> p;
+    auto f = p.get_future()
+      .then([](stdx::future<int> x) { return x.get() * 2; })
+      .then([](stdx::future<int> x) { return std::to_string(x.get()); });
+    EXPECT_FALSE(f.is_ready());
+    p.set_value(21);
+    EXPECT_TRUE(f.is_ready());
+    EXPECT_EQ(f.get(), "42");
+
+    // attached after the completion, runs at once
+    bool ran = false;
+    auto g = stdx::make_ready_future<int>(1).then([&ran](stdx::future<int> x) { ran = x.get() == 1; });
+    EXPECT_TRUE(ran);
+    EXPECT_NO_THROW(g.get());
+
+    // the exception escaping a continuation is stored by its future
+    auto h = stdx::make_ready_future<void>().then([](stdx::future<void>) -> int { throw std::logic_error("continuation"); });
+    EXPECT_THROW((void)h.get(), std::logic_error);
+  }
+
+  TEST(StdX_Future, completed_by_other_threads)
+  {
+    constexpr int count = 200;
+    std::vector<stdx::promise<int>> promises(count);
+    std::vector<stdx::future<int>> waited;
+    std::vector<stdx::future<int>> continued;
+    std::atomic<int> sum{ 0 };
+    for (int i = 0; i < count; ++i)
+    {
+      if (i % 2 == 0)
+      {
+        waited.push_back(promises[i].get_future());
+      }
+      else
+      {
+        continued.push_back(promises[i].get_future().then([&sum](stdx::future<int> x) {
+          const auto value = x.get();
+          sum += value;
+          return value;
+        }));
+      }
+    }
+
+    std::thread producer([&promises] {
+      int i = 0;
+      for (auto& p : promises)
+      {
+        p.set_value(i++);
+      }
+    });
+
+    int expected = 0;
+    for (std::size_t i = 0; i < waited.size(); ++i)
+    {
+      EXPECT_EQ(waited[i].get(), static_cast<int>(2 * i));
+    }
+    for (std::size_t i = 0; i < continued.size(); ++i)
+    {
+      EXPECT_EQ(continued[i].get(), static_cast<int>(2 * i + 1));
+      expected += static_cast<int>(2 * i + 1);
+    }
+    producer.join();
+    EXPECT_EQ(sum, expected);
+  }
+} // end of namespace stdx::test
@@ -0,0 +1,127 @@
+#include <intern_table.h>
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace stdx::test
+{
+  struct Tag
+  {
+    inline static std::atomic<long> instances{ 0L };
+
+    explicit Tag(int v)
+      : value(v)
+    {
+      ++instances;
+    }
+
+    Tag(const Tag& other)
+      : value(other.value)
+    {
+      ++instances;
+    }
+
+    ~Tag()
+    {
+      --instances;
+    }
+
+    bool operator==(const Tag& other) const noexcept
+    {
+      return value == other.value;
+    }
+
+    int value;
+  };
+
+  struct TagHash
+  {
+    std::size_t operator()(const Tag& tag) const noexcept
+    {
+      return static_cast<std::size_t>(tag.value);
+    }
+  };
+
+  TEST(StdX_InternTable, equal_values_share_an_instance)
+  {
+    stdx::intern_table<std::string> table;
+    const auto a = table.intern(std::string("symbol"));
+    const std::string text = "symbol";
+    const auto b = table.intern(text);
+    const auto c = table.intern(std::string("other"));
+
+    EXPECT_EQ(a, b);
+    EXPECT_NE(a, c);
+    EXPECT_EQ(*a, "symbol");
+    EXPECT_EQ(a.use_count(), 2);
+    EXPECT_EQ(table.size(), 2U);
+    EXPECT_EQ(table.find("other"), c);
+    EXPECT_EQ(table.find("missing"), nullptr);
+  }
+
+  TEST(StdX_InternTable, released_values_are_removed)
+  {
+    Tag::instances = 0;
+    stdx::intern_table<Tag, TagHash> table(4);
+    {
+      auto a = table.intern(Tag(1));
+      auto b = table.intern(Tag(2));
+      EXPECT_EQ(Tag::instances, 2);
+      EXPECT_EQ(table.size(), 2U);
+      a.reset();
+      EXPECT_EQ(table.size(), 1U);
+      EXPECT_EQ(table.find(Tag(1)), nullptr);
+      EXPECT_EQ(Tag::instances, 1);
+    }
+    EXPECT_EQ(table.size(), 0U);
+    EXPECT_EQ(Tag::instances, 0);
+  }
+
+  TEST(StdX_InternTable, values_may_outlive_the_table)
+  {
+    Tag::instances = 0;
+    stdx::intern_table<Tag, TagHash>::pointer kept;
+    {
+      stdx::intern_table<Tag, TagHash> table;
+      kept = table.intern(Tag(7));
+    }
+    EXPECT_EQ(kept->value, 7);
+    kept.reset();
+    EXPECT_EQ(Tag::instances, 0);
+  }
+
+  TEST(StdX_InternTable, concurrent_intern_and_release)
+  {
+    Tag::instances = 0;
+    stdx::intern_table<Tag, TagHash> table(8);
+    constexpr int values = 16;
+    std::vector<std::thread> threads;
+    std::atomic<int> mismatches{ 0 };
+    for (int t = 0; t < 4; ++t)
+    {
+      threads.emplace_back([&table, &mismatches, t] {
+        for (int i = 0; i < 5000; ++i)
+        {
+          const auto v = (i + t) % values;
+          auto first = table.intern(Tag(v));
+          auto second = table.intern(Tag(v));
+          if (first != second || first->value != v)
+          {
+            ++mismatches;
+          }
+        }
+      });
+    }
+    for (auto& t : threads)
+    {
+      t.join();
+    }
+    EXPECT_EQ(mismatches, 0);
+    EXPECT_EQ(table.size(), 0U);
+    EXPECT_EQ(Tag::instances, 0);
+  }
+} // end of namespace stdx::test
@@ -0,0 +1,173 @@
+#include <memoize.h>
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace stdx::test
+{
+  struct Rectangle : stdx::memoizable<Rectangle>
+  {
+    inline static std::atomic<long> instances{ 0L };
+
+    Rectangle(double w, double h)
+      : width(w)
+      , height(h)
+    {
+      ++instances;
+    }
+
+    ~Rectangle()
+    {
+      --instances;
+    }
+
+    double width;
+    double height;
+  };
+
+  using rectangle_ptr = stdx::retain_ptr<const Rectangle>;
+
+  TEST(StdX_Memoize, hits_do_not_invoke_the_function)
+  {
+    int calls = 0;
+    stdx::memo_cache<double, const Rectangle> area([&calls](const rectangle_ptr& r) {
+      ++calls;
+      return r->width * r->height;
+    });
+    const auto a = stdx::make_retain<const Rectangle>(2.0, 3.0);
+    const auto b = stdx::make_retain<const Rectangle>(2.0, 3.0);
+    EXPECT_FALSE(area.find(a).has_value());
+    EXPECT_EQ(area(a), 6.0);
+    EXPECT_EQ(area(a), 6.0);
+    EXPECT_EQ(calls, 1);
+    EXPECT_EQ(area.find(a), 6.0);
+
+    // the identity keys the entry, not the contents
+    EXPECT_EQ(area(b), 6.0);
+    EXPECT_EQ(calls, 2);
+    EXPECT_EQ(area.size(), 2U);
+    EXPECT_EQ(a.use_count(), 1);
+  }
+
+  TEST(StdX_Memoize, destruction_of_an_argument_drops_its_entries)
+  {
+    stdx::memo_cache<double, const Rectangle, const Rectangle> overlap(
+      [](const rectangle_ptr& x, const rectangle_ptr& y) { return std::min(x->width, y->width) * std::min(x->height, y->height); });
+    auto a = stdx::make_retain<const Rectangle>(2.0, 3.0);
+    auto b = stdx::make_retain<const Rectangle>(1.0, 4.0);
+    auto c = stdx::make_retain<const Rectangle>(5.0, 5.0);
+    EXPECT_EQ(overlap(a, b), 3.0);
+    EXPECT_EQ(overlap(b, c), 4.0);
+    EXPECT_EQ(overlap(a, a), 6.0);
+    EXPECT_EQ(overlap.size(), 3U);
+
+    a.reset();
+    EXPECT_EQ(overlap.size(), 1U);
+    EXPECT_EQ(overlap.find(b, c), 4.0);
+    c.reset();
+    EXPECT_EQ(overlap.size(), 0U);
+  }
+
+  TEST(StdX_Memoize, capacity_evicts_the_least_recently_used)
+  {
+    int calls = 0;
+    stdx::memo_cache<double, const Rectangle> area(
+      [&calls](const rectangle_ptr& r) {
+        ++calls;
+        return r->width * r->height;
+      },
+      2);
+    EXPECT_EQ(area.capacity(), 2U);
+    const auto a = stdx::make_retain<const Rectangle>(1.0, 1.0);
+    const auto b = stdx::make_retain<const Rectangle>(2.0, 2.0);
+    const auto c = stdx::make_retain<const Rectangle>(3.0, 3.0);
+    area(a);
+    area(b);
+    area(a);
+    area(c);
+    EXPECT_EQ(area.size(), 2U);
+    EXPECT_TRUE(area.find(a).has_value());
+    EXPECT_FALSE(area.find(b).has_value());
+    EXPECT_TRUE(area.find(c).has_value());
+    EXPECT_EQ(calls, 3);
+  }
+
+  TEST(StdX_Memoize, results_retaining_arguments_of_the_cache)
+  {
+    Rectangle::instances = 0;
+    {
+      stdx::memo_cache<rectangle_ptr, const Rectangle> doubled(
+        [](const rectangle_ptr& r) { return stdx::make_retain<const Rectangle>(r->width * 2, r->height * 2); });
+      auto r = stdx::make_retain<const Rectangle>(1.0, 1.0);
+      auto r2 = doubled(r);
+      auto r4 = doubled(r2);
+      EXPECT_EQ(doubled(r2), r4);
+      EXPECT_EQ(r4->width, 4.0);
+      EXPECT_EQ(doubled.size(), 2U);
+
+      // the results are released when their arguments die, in cascade
+      r2.reset();
+      r4.reset();
+      EXPECT_EQ(Rectangle::instances, 3);
+      r.reset();
+      EXPECT_EQ(Rectangle::instances, 0);
+      EXPECT_EQ(doubled.size(), 0U);
+    }
+    EXPECT_EQ(Rectangle::instances, 0);
+  }
+
+  TEST(StdX_Memoize, arguments_outliving_the_cache)
+  {
+    const auto a = stdx::make_retain<const Rectangle>(2.0, 3.0);
+    {
+      stdx::memo_cache<double, const Rectangle> area([](const rectangle_ptr& r) { return r->width * r->height; });
+      stdx::memo_cache<double, const Rectangle> perimeter([](const rectangle_ptr& r) { return 2 * (r->width + r->height); });
+      EXPECT_EQ(area(a), 6.0);
+      EXPECT_EQ(perimeter(a), 10.0);
+      area.clear();
+      EXPECT_EQ(area.size(), 0U);
+      EXPECT_EQ(area(a), 6.0);
+    }
+    EXPECT_EQ(a->width, 2.0);
+  }
+
+  TEST(StdX_Memoize, concurrent_lookups_and_destructions)
+  {
+    Rectangle::instances = 0;
+    {
+      stdx::memo_cache<double, const Rectangle> area([](const rectangle_ptr& r) { return r->width * r->height; }, 64);
+      std::atomic<int> failures{ 0 };
+      std::vector<std::thread> threads;
+      for (int t = 0; t < 4; ++t)
+      {
+        threads.emplace_back([&area, &failures, t] {
+          std::vector<rectangle_ptr> shapes;
+          for (int i = 0; i < 2000; ++i)
+          {
+            shapes.push_back(stdx::make_retain<const Rectangle>(t + 1.0, i % 7 + 1.0));
+            const auto& r = shapes[static_cast<std::size_t>(i * 7 % static_cast<int>(shapes.size()))];
+            if (area(r) != r->width * r->height)
+            {
+              ++failures;
+            }
+            if (shapes.size() == 16)
+            {
+              shapes.clear();
+            }
+          }
+        });
+      }
+      for (auto& t : threads)
+      {
+        t.join();
+      }
+      EXPECT_EQ(failures, 0);
+      EXPECT_EQ(Rectangle::instances, 0);
+      EXPECT_EQ(area.size(), 0U);
+    }
+  }
+} // end of namespace stdx::test
@@ -0,0 +1,96 @@
+#include <memory_pool.h>
+
+#include <gtest/gtest.h>
+
+#include <thread>
+#include <vector>
+
+namespace stdx::test
+{
+  struct Pooled : stdx::pool_allocated
+  {
+    explicit Pooled(int v)
+      : value(v)
+    {
+    }
+
+    int value;
+    char padding[40]{};
+  };
+
+  TEST(StdX_MemoryPool, freed_block_is_reused)
+  {
+    auto* first = stdx::memory_pool::allocate(100);
+    stdx::memory_pool::deallocate(first, 100);
+
+    // the same size class is served from the cache of the thread
+    auto* second = stdx::memory_pool::allocate(110);
+    EXPECT_EQ(first, second);
+    stdx::memory_pool::deallocate(second, 110);
+
+    auto* other = stdx::memory_pool::allocate(200);
+    EXPECT_NE(first, other);
+    stdx::memory_pool::deallocate(other, 200);
+  }
+
+  TEST(StdX_MemoryPool, large_and_empty_blocks)
+  {
+    auto* large = stdx::memory_pool::allocate(stdx::memory_pool::max_pooled_size + 1);
+    ASSERT_NE(large, nullptr);
+    stdx::memory_pool::deallocate(large, stdx::memory_pool::max_pooled_size + 1);
+
+    auto* empty = stdx::memory_pool::allocate(0);
+    ASSERT_NE(empty, nullptr);
+    stdx::memory_pool::deallocate(empty, 0);
+  }
+
+  TEST(StdX_MemoryPool, cache_capacity_is_bounded)
+  {
+    std::vector<void*> blocks;
+    for (std::size_t i = 0; i < 2 * stdx::memory_pool::max_cached_blocks; ++i)
+    {
+      blocks.push_back(stdx::memory_pool::allocate(80));
+    }
+    for (auto* block : blocks)
+    {
+      stdx::memory_pool::deallocate(block, 80);
+    }
+    for (auto& block : blocks)
+    {
+      block = stdx::memory_pool::allocate(80);
+    }
+    for (auto* block : blocks)
+    {
+      stdx::memory_pool::deallocate(block, 80);
+    }
+  }
+
+  TEST(StdX_MemoryPool, pool_allocated_objects_across_threads)
+  {
+    std::vector<Pooled*> objects;
+    std::thread producer([&objects] {
+      for (int i = 0; i < 10; ++i)
+      {
+        objects.push_back(new Pooled(i));
+      }
+    });
+    producer.join();
+
+    // a fresh thread starts with an empty cache, the blocks freed by it are cached by it
+    int sum = 0;
+    Pooled* reused = nullptr;
+    std::thread consumer([&objects, &sum, &reused] {
+      for (auto* p : objects)
+      {
+        sum += p->value;
+        delete p;
+      }
+      reused = new Pooled(7);
+    });
+    consumer.join();
+    EXPECT_EQ(sum, 45);
+    EXPECT_EQ(reused, objects.back());
+    EXPECT_EQ(reused->value, 7);
+    delete reused;
+  }
+} // end of namespace stdx::test
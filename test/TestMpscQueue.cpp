@@ -0,0 +1,137 @@
+#include <mpsc_queue.h>
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace stdx::test
+{
+  struct Message : stdx::atomic_reference_count<Message>, stdx::queue_hook
+  {
+    inline static std::atomic<long> instances{ 0L };
+
+    Message(int p, int s)
+      : producer(p)
+      , sequence(s)
+    {
+      ++instances;
+    }
+
+    Message(const Message&) = delete;
+    Message& operator=(const Message&) = delete;
+
+    ~Message()
+    {
+      --instances;
+    }
+
+    int producer;
+    int sequence;
+  };
+
+  using MessageQueue = stdx::mpsc_queue<Message>;
+
+  TEST(StdX_MpscQueue, fifo_order)
+  {
+    MessageQueue queue;
+    EXPECT_TRUE(queue.empty());
+    EXPECT_FALSE(queue.pop());
+
+    for (int i = 0; i < 5; ++i)
+    {
+      queue.push(stdx::make_retain<Message>(0, i));
+    }
+    EXPECT_FALSE(queue.empty());
+
+    for (int i = 0; i < 5; ++i)
+    {
+      const auto m = queue.pop();
+      ASSERT_TRUE(m);
+      EXPECT_EQ(m->sequence, i);
+    }
+    EXPECT_TRUE(queue.empty());
+    EXPECT_FALSE(queue.pop());
+
+    // the queue is reusable after it has been drained
+    queue.push(stdx::make_retain<Message>(0, 5));
+    EXPECT_EQ(queue.pop()->sequence, 5);
+  }
+
+  TEST(StdX_MpscQueue, ownership_is_transferred)
+  {
+    Message::instances = 0L;
+    MessageQueue queue;
+    auto m = stdx::make_retain<Message>(0, 0);
+    auto* raw = m.get();
+    auto copy = m;
+    EXPECT_EQ(copy.use_count(), 2);
+
+    queue.push(std::move(m));
+    EXPECT_FALSE(m); // NOLINT(bugprone-use-after-move)
+    EXPECT_EQ(copy.use_count(), 2);
+
+    const auto popped = queue.pop();
+    EXPECT_EQ(popped.get(), raw);
+    EXPECT_EQ(popped.use_count(), 2);
+  }
+
+  TEST(StdX_MpscQueue, destructor_releases_queued_objects)
+  {
+    Message::instances = 0L;
+    {
+      MessageQueue queue;
+      for (int i = 0; i < 10; ++i)
+      {
+        queue.push(stdx::make_retain<Message>(0, i));
+      }
+      EXPECT_EQ(Message::instances, 10);
+    }
+    EXPECT_EQ(Message::instances, 0);
+  }
+
+  TEST(StdX_MpscQueue, multiple_producers)
+  {
+    Message::instances = 0L;
+    constexpr int producers = 4;
+    constexpr int messages = 10000;
+    {
+      MessageQueue queue;
+      std::vector<std::thread> threads;
+      for (int p = 0; p < producers; ++p)
+      {
+        threads.emplace_back([&queue, p] {
+          for (int i = 0; i < messages; ++i)
+          {
+            queue.push(stdx::make_retain<Message>(p, i));
+          }
+        });
+      }
+
+      std::vector<int> expected(producers, 0);
+      int received = 0;
+      while (received < producers * messages)
+      {
+        if (const auto m = queue.pop(); m)
+        {
+          // the messages of a single producer are received in order
+          EXPECT_EQ(m->sequence, expected[m->producer]);
+          expected[m->producer] = m->sequence + 1;
+          ++received;
+        }
+        else
+        {
+          std::this_thread::yield();
+        }
+      }
+
+      for (auto& t : threads)
+      {
+        t.join();
+      }
+      EXPECT_TRUE(queue.empty());
+    }
+    EXPECT_EQ(Message::instances, 0);
+  }
+} // end of namespace stdx::test
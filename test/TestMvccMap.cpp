@@ -0,0 +1,182 @@
+#include <mvcc_map.h>
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace stdx::test
+{
+  struct Record : stdx::atomic_reference_count<Record>
+  {
+    inline static std::atomic<long> instances{ 0L };
+
+    explicit Record(int v)
+      : value(v)
+    {
+      ++instances;
+    }
+
+    Record(const Record&) = delete;
+    Record& operator=(const Record&) = delete;
+
+    ~Record()
+    {
+      --instances;
+    }
+
+    int value;
+  };
+
+  using RecordMap = stdx::mvcc_map<std::string, Record>;
+
+  TEST(StdX_MvccMap, put_and_get)
+  {
+    RecordMap map;
+    EXPECT_EQ(map.committed(), 0U);
+    EXPECT_FALSE(map.get("a"));
+
+    EXPECT_EQ(map.put("a", stdx::make_retain<Record>(1)), 1U);
+    EXPECT_EQ(map.put("b", stdx::make_retain<Record>(2)), 2U);
+    EXPECT_EQ(map.committed(), 2U);
+
+    ASSERT_TRUE(map.get("a"));
+    EXPECT_EQ(map.get("a")->value, 1);
+    EXPECT_EQ(map.get("b")->value, 2);
+    EXPECT_FALSE(map.get("c"));
+
+    map.erase("a");
+    EXPECT_FALSE(map.get("a"));
+    EXPECT_EQ(map.get("b")->value, 2);
+  }
+
+  TEST(StdX_MvccMap, snapshot_isolation)
+  {
+    RecordMap map;
+    map.put("a", stdx::make_retain<Record>(1));
+
+    const auto snapshot = map.make_snapshot();
+    EXPECT_EQ(snapshot.sequence(), 1U);
+
+    map.put("a", stdx::make_retain<Record>(2));
+    map.put("b", stdx::make_retain<Record>(3));
+    map.erase("a");
+
+    ASSERT_NE(snapshot.find("a"), nullptr);
+    EXPECT_EQ(snapshot.find("a")->value, 1);
+    EXPECT_EQ(snapshot.find("b"), nullptr);
+
+    const auto latest = map.make_snapshot();
+    EXPECT_EQ(latest.find("a"), nullptr);
+    ASSERT_NE(latest.find("b"), nullptr);
+    EXPECT_EQ(latest.find("b")->value, 3);
+  }
+
+  TEST(StdX_MvccMap, write_batch_is_atomic)
+  {
+    RecordMap map;
+    RecordMap::write_batch batch;
+    batch.put("a", stdx::make_retain<Record>(1));
+    batch.put("b", stdx::make_retain<Record>(2));
+    batch.put("a", stdx::make_retain<Record>(3));
+    EXPECT_EQ(batch.size(), 3U);
+
+    const auto before = map.make_snapshot();
+    EXPECT_EQ(map.commit(std::move(batch)), 1U);
+
+    EXPECT_EQ(before.find("a"), nullptr);
+    EXPECT_EQ(before.find("b"), nullptr);
+    EXPECT_EQ(map.get("a")->value, 3);
+    EXPECT_EQ(map.get("b")->value, 2);
+  }
+
+  TEST(StdX_MvccMap, versions_behind_horizon_are_released)
+  {
+    Record::instances = 0L;
+    {
+      RecordMap map;
+      map.put("a", stdx::make_retain<Record>(1));
+      {
+        const auto snapshot = map.make_snapshot();
+        map.put("a", stdx::make_retain<Record>(2));
+        map.put("a", stdx::make_retain<Record>(3));
+        // version 1 is pinned by the snapshot, the newer versions are kept above the horizon
+        EXPECT_EQ(Record::instances, 3);
+        EXPECT_EQ(snapshot.find("a")->value, 1);
+      }
+      map.collect();
+      EXPECT_EQ(Record::instances, 1);
+      EXPECT_EQ(map.get("a")->value, 3);
+    }
+    EXPECT_EQ(Record::instances, 0);
+  }
+
+  TEST(StdX_MvccMap, for_each)
+  {
+    RecordMap map(4);
+    for (int i = 0; i < 20; ++i)
+    {
+      map.put(std::to_string(i), stdx::make_retain<Record>(i));
+    }
+    map.erase("7");
+
+    const auto snapshot = map.make_snapshot();
+    map.put("100", stdx::make_retain<Record>(100));
+
+    int count = 0;
+    int sum = 0;
+    snapshot.for_each([&](const std::string& key, const Record& r) {
+      EXPECT_EQ(key, std::to_string(r.value));
+      ++count;
+      sum += r.value;
+    });
+    EXPECT_EQ(count, 19);
+    EXPECT_EQ(sum, 190 - 7);
+  }
+
+  TEST(StdX_MvccMap, concurrent_snapshots_are_consistent)
+  {
+    Record::instances = 0L;
+    {
+      RecordMap map;
+      map.put("a", stdx::make_retain<Record>(0));
+      map.put("b", stdx::make_retain<Record>(0));
+
+      std::atomic<bool> done{ false };
+      std::vector<std::thread> readers;
+      for (int i = 0; i < 4; ++i)
+      {
+        readers.emplace_back([&map, &done] {
+          while (!done.load(std::memory_order_relaxed))
+          {
+            const auto snapshot = map.make_snapshot();
+            const auto* a = snapshot.find("a");
+            const auto* b = snapshot.find("b");
+            ASSERT_NE(a, nullptr);
+            ASSERT_NE(b, nullptr);
+            EXPECT_EQ(a->value, b->value);
+          }
+        });
+      }
+
+      for (int i = 1; i <= 2000; ++i)
+      {
+        RecordMap::write_batch batch;
+        batch.put("a", stdx::make_retain<Record>(i));
+        batch.put("b", stdx::make_retain<Record>(i));
+        map.commit(std::move(batch));
+      }
+      done = true;
+      for (auto& t : readers)
+      {
+        t.join();
+      }
+
+      map.collect();
+      EXPECT_EQ(Record::instances, 2);
+    }
+    EXPECT_EQ(Record::instances, 0);
+  }
+} // end of namespace stdx::test
@@ -0,0 +1,156 @@
+#include <persistent_btree.h>
+
+#include <gtest/gtest.h>
+
+#include <map>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace stdx::test
+{
+  template<typename Tree>
+  std::map<int, int> to_map(const Tree& tree)
+  {
+    std::map<int, int> result;
+    int previous = -1;
+    for (const auto& [key, value] : tree)
+    {
+      EXPECT_LT(previous, key);
+      previous = key;
+      result.emplace(key, value);
+    }
+    return result;
+  }
+
+  TEST(StdX_PersistentBtree, versions_are_immutable)
+  {
+    stdx::persistent_btree<std::string, int> empty;
+    const auto one = empty.set("b", 2);
+    const auto two = one.set("a", 1);
+    const auto changed = two.set("b", 20);
+    const auto erased = changed.erase("a");
+
+    EXPECT_TRUE(empty.empty());
+    EXPECT_EQ(empty.begin(), empty.end());
+    EXPECT_EQ(two.size(), 2U);
+    EXPECT_EQ(two.begin()->first, "a");
+    EXPECT_EQ(*two.find("b"), 2);
+    EXPECT_EQ(*changed.find("b"), 20);
+    EXPECT_EQ(erased.size(), 1U);
+    EXPECT_FALSE(erased.contains("a"));
+    EXPECT_TRUE(changed.contains("a"));
+    EXPECT_TRUE(erased.erase("missing").shares_root_with(erased));
+    EXPECT_TRUE(erased.erase("b").empty());
+  }
+
+  TEST(StdX_PersistentBtree, matches_std_map)
+  {
+    std::mt19937 gen(11);
+    std::uniform_int_distribution<int> keys(0, 3000);
+    stdx::persistent_btree<int, int> tree;
+    std::map<int, int> expected;
+    std::vector<std::pair<stdx::persistent_btree<int, int>, std::map<int, int>>> snapshots;
+    for (int i = 0; i < 20000; ++i)
+    {
+      const auto key = keys(gen);
+      if (i % 3 == 0)
+      {
+        tree = tree.erase(key);
+        expected.erase(key);
+      }
+      else
+      {
+        tree = tree.set(key, i);
+        expected[key] = i;
+      }
+      if (i % 5000 == 0)
+      {
+        snapshots.emplace_back(tree, expected);
+      }
+    }
+    EXPECT_EQ(tree.size(), expected.size());
+    EXPECT_EQ(to_map(tree), expected);
+
+    // the snapshots are not affected by the later updates
+    for (const auto& [snapshot, state] : snapshots)
+    {
+      EXPECT_EQ(snapshot.size(), state.size());
+      EXPECT_EQ(to_map(snapshot), state);
+    }
+
+    // erasing everything rebalances down to an empty tree
+    for (const auto& entry : expected)
+    {
+      tree = tree.erase(entry.first);
+    }
+    EXPECT_TRUE(tree.empty());
+    EXPECT_EQ(tree.begin(), tree.end());
+  }
+
+  TEST(StdX_PersistentBtree, nodes_hold_strings_inline)
+  {
+    // the keys are long enough to be allocated: the elements are moved within the nodes
+    const auto key_of = [](int i) { return std::string(24, 'k') + std::to_string(i + 10000); };
+    stdx::persistent_btree<std::string, std::string> tree;
+    std::map<std::string, std::string> expected;
+    for (int i = 0; i < 3000; ++i)
+    {
+      const auto key = key_of(i * 7 % 3000);
+      tree = tree.set(key, key + "v");
+      expected[key] = key + "v";
+    }
+    const auto snapshot = tree;
+    for (int i = 0; i < 3000; i += 2)
+    {
+      tree = tree.erase(key_of(i));
+      expected.erase(key_of(i));
+    }
+    EXPECT_EQ(snapshot.size(), 3000U);
+    ASSERT_EQ(tree.size(), expected.size());
+    auto it = expected.begin();
+    for (const auto& [key, value] : tree)
+    {
+      EXPECT_EQ(key, it->first);
+      EXPECT_EQ(value, it->second);
+      ++it;
+    }
+    EXPECT_EQ(*snapshot.find(key_of(0)), key_of(0) + "v");
+  }
+
+  TEST(StdX_PersistentBtree, bulk_load_and_range_scans)
+  {
+    std::vector<std::pair<int, int>> entries;
+    for (int i = 0; i < 10000; ++i)
+    {
+      entries.emplace_back(2 * i, i);
+    }
+    const auto tree = stdx::persistent_btree<int, int>::from_sorted(entries.begin(), entries.end());
+    EXPECT_EQ(tree.size(), entries.size());
+    EXPECT_EQ(*tree.find(1000), 500);
+    EXPECT_EQ(tree.find(1001), nullptr);
+
+    EXPECT_EQ(tree.lower_bound(101)->first, 102);
+    EXPECT_EQ(tree.lower_bound(102)->first, 102);
+    EXPECT_EQ(tree.upper_bound(102)->first, 104);
+    EXPECT_EQ(tree.lower_bound(19998)->first, 19998);
+    EXPECT_EQ(tree.upper_bound(19998), tree.end());
+
+    std::vector<int> scanned;
+    tree.for_each_in_range(5000, 5100, [&scanned](int key, int) { scanned.push_back(key); });
+    ASSERT_EQ(scanned.size(), 50U);
+    EXPECT_EQ(scanned.front(), 5000);
+    EXPECT_EQ(scanned.back(), 5098);
+
+    // the bulk loaded tree is updated like any other
+    auto updated = tree.set(1001, -1).erase(0);
+    EXPECT_EQ(updated.size(), tree.size());
+    EXPECT_EQ(*updated.find(1001), -1);
+    EXPECT_EQ(updated.begin()->first, 2);
+    EXPECT_EQ(tree.begin()->first, 0);
+
+    const auto none = stdx::persistent_btree<int, int>::from_sorted(entries.end(), entries.end());
+    EXPECT_TRUE(none.empty());
+  }
+} // end of namespace stdx::test
@@ -0,0 +1,167 @@
+#include <persistent_hash_map.h>
+
+#include <gtest/gtest.h>
+
+#include <cstddef>
+#include <random>
+#include <string>
+#include <unordered_map>
+
+namespace stdx::test
+{
+  // maps the keys to a few hashes, exercising the collision nodes below the last level
+  struct CollidingHash
+  {
+    std::size_t operator()(int key) const noexcept
+    {
+      return static_cast<std::size_t>(key % 4);
+    }
+  };
+
+  template<typename Map>
+  std::unordered_map<int, int> to_unordered(const Map& map)
+  {
+    std::unordered_map<int, int> result;
+    map.for_each([&result](int key, int value) { EXPECT_TRUE(result.emplace(key, value).second); });
+    return result;
+  }
+
+  TEST(StdX_PersistentHashMap, versions_are_immutable)
+  {
+    stdx::persistent_hash_map<std::string, int> empty;
+    const auto one = empty.set("one", 1);
+    const auto two = one.set("two", 2);
+    const auto changed = two.set("one", 10);
+    const auto erased = changed.erase("two");
+
+    EXPECT_TRUE(empty.empty());
+    EXPECT_EQ(one.size(), 1U);
+    EXPECT_EQ(two.size(), 2U);
+    EXPECT_EQ(*two.find("one"), 1);
+    EXPECT_EQ(*changed.find("one"), 10);
+    EXPECT_EQ(changed.size(), 2U);
+    EXPECT_EQ(erased.size(), 1U);
+    EXPECT_FALSE(erased.contains("two"));
+    EXPECT_TRUE(two.contains("two"));
+    EXPECT_EQ(two.find("three"), nullptr);
+
+    // erasing a missing key keeps the version
+    const auto same = erased.erase("missing");
+    EXPECT_TRUE(same.shares_root_with(erased));
+    EXPECT_TRUE(erased.erase("one").empty());
+  }
+
+  TEST(StdX_PersistentHashMap, matches_unordered_map)
+  {
+    std::mt19937 gen(7);
+    std::uniform_int_distribution<int> keys(0, 2000);
+    stdx::persistent_hash_map<int, int> map;
+    stdx::persistent_hash_map<int, int, CollidingHash> colliding;
+    std::unordered_map<int, int> expected;
+    for (int i = 0; i < 5000; ++i)
+    {
+      const auto key = keys(gen);
+      if (i % 3 == 0)
+      {
+        map = map.erase(key);
+        colliding = colliding.erase(key);
+        expected.erase(key);
+      }
+      else
+      {
+        map = map.set(key, i);
+        colliding = colliding.set(key, i);
+        expected[key] = i;
+      }
+    }
+    EXPECT_EQ(map.size(), expected.size());
+    EXPECT_EQ(colliding.size(), expected.size());
+    EXPECT_EQ(to_unordered(map), expected);
+    EXPECT_EQ(to_unordered(colliding), expected);
+    for (const auto& [key, value] : expected)
+    {
+      ASSERT_NE(map.find(key), nullptr);
+      EXPECT_EQ(*map.find(key), value);
+      EXPECT_EQ(*colliding.find(key), value);
+    }
+  }
+
+  TEST(StdX_PersistentHashMap, nodes_hold_strings_inline)
+  {
+    // the keys are long enough to be allocated: the rebuilt nodes copy the shared entries and
+    // move the entries of the nodes owned by the transient
+    const auto key_of = [](int i) { return std::string(24, 'k') + std::to_string(i); };
+    stdx::persistent_hash_map<std::string, std::string> map;
+    for (int i = 0; i < 2000; ++i)
+    {
+      map = map.set(key_of(i), key_of(i) + "v");
+    }
+    const auto snapshot = map;
+
+    auto t = map.as_transient();
+    for (int i = 0; i < 2000; i += 2)
+    {
+      t.erase(key_of(i));
+    }
+    for (int i = 2000; i < 2500; ++i)
+    {
+      t.set(key_of(i), key_of(i) + "v");
+    }
+    map = std::move(t).persistent();
+
+    EXPECT_EQ(snapshot.size(), 2000U);
+    EXPECT_EQ(map.size(), 1500U);
+    for (int i = 0; i < 2500; ++i)
+    {
+      if (i < 2000)
+      {
+        EXPECT_EQ(*snapshot.find(key_of(i)), key_of(i) + "v");
+      }
+      if (i % 2 == 0 && i < 2000)
+      {
+        EXPECT_FALSE(map.contains(key_of(i)));
+      }
+      else
+      {
+        EXPECT_EQ(*map.find(key_of(i)), key_of(i) + "v");
+      }
+    }
+  }
+
+  TEST(StdX_PersistentHashMap, transient_edits_in_place)
+  {
+    stdx::persistent_hash_map<int, int> base;
+    for (int i = 0; i < 1000; ++i)
+    {
+      base = base.set(i, i);
+    }
+
+    auto t = base.as_transient();
+    for (int i = 0; i < 1000; i += 2)
+    {
+      t.set(i, -i);
+    }
+    t.erase(1);
+    t.set(5000, 5000);
+    EXPECT_EQ(t.size(), 1000U);
+    EXPECT_EQ(*t.find(2), -2);
+    const auto edited = std::move(t).persistent();
+
+    // the base version is not modified by the transient
+    EXPECT_EQ(base.size(), 1000U);
+    EXPECT_FALSE(edited.shares_root_with(base));
+    for (int i = 0; i < 1000; ++i)
+    {
+      EXPECT_EQ(*base.find(i), i);
+      if (i == 1)
+      {
+        EXPECT_FALSE(edited.contains(i));
+      }
+      else
+      {
+        EXPECT_EQ(*edited.find(i), i % 2 == 0 ? -i : i);
+      }
+    }
+    EXPECT_EQ(*edited.find(5000), 5000);
+  }
+} // end of namespace stdx::test
@@ -0,0 +1,155 @@
+#include <rcu_cell.h>
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace stdx::test
+{
+  struct Config : stdx::atomic_reference_count<Config>
+  {
+    inline static std::atomic<long> instances{ 0L };
+
+    explicit Config(int v)
+      : value(v)
+    {
+      ++instances;
+    }
+
+    Config(const Config&) = delete;
+    Config& operator=(const Config&) = delete;
+
+    ~Config()
+    {
+      --instances;
+    }
+
+    int value;
+  };
+
+  using ConfigCell = stdx::rcu_cell<const Config>;
+
+  TEST(StdX_RcuCell, default_construction)
+  {
+    ConfigCell cell;
+    EXPECT_FALSE(cell.load());
+    EXPECT_EQ(cell.version(), 0U);
+
+    ConfigCell::reader r(cell);
+    EXPECT_FALSE(r.get());
+  }
+
+  TEST(StdX_RcuCell, reader_observes_published_value)
+  {
+    Config::instances = 0L;
+    {
+      ConfigCell cell(stdx::make_retain<Config>(1));
+      ConfigCell::reader r(cell);
+      ASSERT_TRUE(r.get());
+      EXPECT_EQ(r.get()->value, 1);
+      EXPECT_EQ(r.version(), 0U);
+
+      cell.store(stdx::make_retain<Config>(2));
+      EXPECT_EQ(cell.version(), 1U);
+      EXPECT_EQ(r.get()->value, 2);
+      EXPECT_EQ(r.version(), 1U);
+    }
+    EXPECT_EQ(Config::instances, 0);
+  }
+
+  TEST(StdX_RcuCell, fast_path_does_not_touch_reference_count)
+  {
+    ConfigCell cell(stdx::make_retain<Config>(1));
+    ConfigCell::reader r(cell);
+    EXPECT_EQ(r.get().use_count(), 2);
+    for (int i = 0; i < 10; ++i)
+    {
+      EXPECT_EQ(r.get().use_count(), 2);
+    }
+  }
+
+  TEST(StdX_RcuCell, previous_value_is_released_when_readers_moved_on)
+  {
+    Config::instances = 0L;
+    ConfigCell cell(stdx::make_retain<Config>(1));
+    ConfigCell::reader r1(cell);
+    ConfigCell::reader r2(cell);
+    EXPECT_EQ(Config::instances, 1);
+
+    cell.store(stdx::make_retain<Config>(2));
+    // both readers still cache the previous value
+    EXPECT_EQ(Config::instances, 2);
+
+    EXPECT_EQ(r1.get()->value, 2);
+    EXPECT_EQ(Config::instances, 2);
+
+    r2.reset();
+    EXPECT_EQ(Config::instances, 1);
+    EXPECT_EQ(r2.get()->value, 2);
+  }
+
+  TEST(StdX_RcuCell, exchange)
+  {
+    ConfigCell cell(stdx::make_retain<Config>(1));
+    auto previous = cell.exchange(stdx::make_retain<Config>(2));
+    ASSERT_TRUE(previous);
+    EXPECT_EQ(previous->value, 1);
+    EXPECT_EQ(previous.use_count(), 1);
+    EXPECT_EQ(cell.load()->value, 2);
+  }
+
+  TEST(StdX_RcuCell, wait_for_new_version)
+  {
+    ConfigCell cell(stdx::make_retain<Config>(1));
+    const auto observed = cell.version();
+
+    std::thread writer([&cell] {
+      cell.store(stdx::make_retain<Config>(2));
+    });
+
+    const auto current = cell.wait(observed);
+    EXPECT_NE(current, observed);
+    EXPECT_EQ(cell.load()->value, 2);
+    writer.join();
+  }
+
+  TEST(StdX_RcuCell, concurrent_readers_and_writer)
+  {
+    Config::instances = 0L;
+    {
+      ConfigCell cell(stdx::make_retain<Config>(0));
+      std::atomic<bool> done{ false };
+
+      std::vector<std::thread> readers;
+      for (int i = 0; i < 4; ++i)
+      {
+        readers.emplace_back([&cell, &done] {
+          ConfigCell::reader r(cell);
+          int last = 0;
+          while (!done.load(std::memory_order_relaxed))
+          {
+            const auto& value = r.get();
+            ASSERT_TRUE(value);
+            // the published values are monotonic
+            EXPECT_GE(value->value, last);
+            last = value->value;
+          }
+        });
+      }
+
+      for (int i = 1; i <= 1000; ++i)
+      {
+        cell.store(stdx::make_retain<Config>(i));
+      }
+      done = true;
+      for (auto& t : readers)
+      {
+        t.join();
+      }
+      EXPECT_EQ(cell.load()->value, 1000);
+    }
+    EXPECT_EQ(Config::instances, 0);
+  }
+} // end of namespace stdx::test
@@ -0,0 +1,120 @@
+#include <retain_algorithm.h>
+
+#include <gtest/gtest.h>
+
+#include <list>
+#include <string>
+#include <vector>
+
+namespace stdx::test
+{
+  struct Row : stdx::atomic_reference_count<Row>
+  {
+    Row(int i, double p)
+      : id(i)
+      , price(p)
+    {
+    }
+
+    int id;
+    char padding[200]{};
+    double price;
+  };
+
+  std::vector<stdx::retain_ptr<Row>> make_rows(int n)
+  {
+    std::vector<stdx::retain_ptr<Row>> rows;
+    for (int i = 0; i < n; ++i)
+    {
+      rows.push_back(stdx::make_retain<Row>(i, 0.5 * i));
+    }
+    return rows;
+  }
+
+  TEST(StdX_RetainAlgorithm, for_each_retained_visits_in_order)
+  {
+    auto rows = make_rows(100);
+    rows[10].reset();
+
+    std::vector<int> ids;
+    stdx::for_each_retained(rows, [&ids](const Row& row) { ids.push_back(row.id); });
+    ASSERT_EQ(ids.size(), 99U);
+    EXPECT_EQ(ids[9], 9);
+    EXPECT_EQ(ids[10], 11);
+
+    for (std::size_t distance : { 0U, 1U, 3U, 1000U })
+    {
+      long sum = 0;
+      stdx::for_each_retained(rows, [&sum](Row& row) { sum += row.id; }, distance);
+      EXPECT_EQ(sum, 99 * 100 / 2 - 10);
+    }
+    EXPECT_EQ(rows[0].use_count(), 1);
+  }
+
+  TEST(StdX_RetainAlgorithm, gather_extracts_a_member)
+  {
+    const auto rows = make_rows(50);
+
+    std::vector<double> prices(rows.size());
+    const auto end = stdx::gather(rows, &Row::price, prices.begin(), 4);
+    EXPECT_EQ(end, prices.end());
+    EXPECT_DOUBLE_EQ(prices[49], 24.5);
+
+    const auto ids = stdx::gather(rows, [](const Row& row) { return std::to_string(row.id); });
+    ASSERT_EQ(ids.size(), 50U);
+    EXPECT_EQ(ids[7], "7");
+
+    const auto copy = stdx::gather(rows, &Row::price, 0);
+    EXPECT_EQ(copy, prices);
+  }
+
+  // a pointer counting the reads of its address, i.e. the visits and the prefetches
+  struct CountingPointer
+  {
+    inline static int reads = 0;
+
+    const Row* get() const noexcept
+    {
+      ++reads;
+      return row;
+    }
+
+    const Row* row;
+  };
+
+  TEST(StdX_RetainAlgorithm, zero_distance_disables_the_prefetching)
+  {
+    const auto rows = make_rows(10);
+    std::vector<CountingPointer> pointers;
+    for (const auto& row : rows)
+    {
+      pointers.push_back(CountingPointer{ row.get() });
+    }
+
+    CountingPointer::reads = 0;
+    EXPECT_EQ(stdx::gather(pointers, &Row::id, 0).size(), 10U);
+    EXPECT_EQ(CountingPointer::reads, 10);
+
+    CountingPointer::reads = 0;
+    int count = 0;
+    stdx::for_each_retained(pointers, [&count](const Row&) { ++count; }, 3);
+    EXPECT_EQ(count, 10);
+    EXPECT_EQ(CountingPointer::reads, 20);
+  }
+
+  TEST(StdX_RetainAlgorithm, ranges_of_raw_pointers)
+  {
+    const auto rows = make_rows(5);
+    std::list<const Row*> raw;
+    for (const auto& row : rows)
+    {
+      raw.push_back(row.get());
+    }
+    EXPECT_EQ(stdx::gather(raw, &Row::id), (std::vector<int>{ 0, 1, 2, 3, 4 }));
+
+    const Row* array[] = { rows[4].get(), nullptr, rows[2].get() };
+    int count = 0;
+    stdx::for_each_retained(array, [&count](const Row&) { ++count; });
+    EXPECT_EQ(count, 2);
+  }
+} // end of namespace stdx::test
@@ -0,0 +1,145 @@
+#include <retain_flat_set.h>
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+namespace stdx::test
+{
+  struct Vertex : stdx::reference_count<Vertex>
+  {
+    inline static long instances = 0;
+
+    explicit Vertex(int i)
+      : id(i)
+    {
+      ++instances;
+    }
+
+    ~Vertex()
+    {
+      --instances;
+    }
+
+    int id;
+  };
+
+  TEST(StdX_RetainFlatSet, insert_moves_the_reference)
+  {
+    auto v = stdx::make_retain<Vertex>(1);
+    stdx::retain_flat_set<Vertex> set;
+    EXPECT_TRUE(set.empty());
+    EXPECT_EQ(set.capacity(), 0U);
+
+    auto copy = v;
+    EXPECT_TRUE(set.insert(std::move(copy)));
+    EXPECT_EQ(v.use_count(), 2);
+    EXPECT_FALSE(set.insert(v));
+    EXPECT_EQ(v.use_count(), 2);
+    EXPECT_TRUE(set.contains(v));
+    EXPECT_TRUE(set.contains(v.get()));
+    EXPECT_EQ(set.size(), 1U);
+
+    EXPECT_TRUE(set.erase(v));
+    EXPECT_FALSE(set.erase(v));
+    EXPECT_FALSE(set.contains(v));
+    EXPECT_EQ(v.use_count(), 1);
+  }
+
+  TEST(StdX_RetainFlatSet, elements_are_released_with_the_set)
+  {
+    Vertex::instances = 0;
+    {
+      stdx::retain_flat_set<Vertex> set;
+      for (int i = 0; i < 100; ++i)
+      {
+        set.insert(stdx::make_retain<Vertex>(i));
+      }
+      EXPECT_EQ(Vertex::instances, 100);
+      auto copy = set;
+      EXPECT_EQ(copy.size(), 100U);
+      set.clear();
+      EXPECT_EQ(Vertex::instances, 100);
+    }
+    EXPECT_EQ(Vertex::instances, 0);
+  }
+
+  TEST(StdX_RetainFlatSet, growth_and_tombstones)
+  {
+    Vertex::instances = 0;
+    std::vector<stdx::retain_ptr<Vertex>> vertices;
+    for (int i = 0; i < 1000; ++i)
+    {
+      vertices.push_back(stdx::make_retain<Vertex>(i));
+    }
+
+    stdx::retain_flat_set<Vertex> set(16);
+    EXPECT_EQ(set.capacity(), 32U);
+    for (int round = 0; round < 3; ++round)
+    {
+      for (const auto& v : vertices)
+      {
+        EXPECT_TRUE(set.insert(v));
+      }
+      for (std::size_t i = 0; i < vertices.size(); i += 2)
+      {
+        EXPECT_TRUE(set.erase(vertices[i]));
+      }
+      EXPECT_EQ(set.size(), 500U);
+      for (std::size_t i = 0; i < vertices.size(); ++i)
+      {
+        EXPECT_EQ(set.contains(vertices[i]), i % 2 == 1);
+      }
+      set.clear();
+    }
+    EXPECT_EQ(set.capacity() & (set.capacity() - 1), 0U);
+    EXPECT_EQ(vertices.front().use_count(), 1);
+
+    long sum = 0;
+    set.insert(vertices[3]);
+    set.insert(vertices[4]);
+    set.for_each([&sum](Vertex* v) { sum += v->id; });
+    EXPECT_EQ(sum, 7);
+  }
+
+  TEST(StdX_RetainFlatMap, entries)
+  {
+    Vertex::instances = 0;
+    auto a = stdx::make_retain<Vertex>(1);
+    auto b = stdx::make_retain<Vertex>(2);
+    {
+      stdx::retain_flat_map<Vertex, std::string> map;
+      EXPECT_TRUE(map.try_emplace(a, 3, 'a'));
+      EXPECT_FALSE(map.try_emplace(a, "ignored"));
+      EXPECT_TRUE(map.insert_or_assign(b, "b"));
+      EXPECT_FALSE(map.insert_or_assign(b, "bb"));
+      EXPECT_EQ(a.use_count(), 2);
+
+      ASSERT_NE(map.find(a.get()), nullptr);
+      EXPECT_EQ(*map.find(a.get()), "aaa");
+      EXPECT_EQ(*map.find(b.get()), "bb");
+      *map.find(b.get()) += "b";
+
+      std::string keys;
+      std::as_const(map).for_each([&keys](Vertex* k, const std::string& v) { keys += std::to_string(k->id) + v; });
+      EXPECT_EQ(keys.size(), 8U);
+
+      auto copy = map;
+      EXPECT_TRUE(map.erase(a));
+      EXPECT_EQ(map.find(a.get()), nullptr);
+      EXPECT_EQ(*copy.find(a.get()), "aaa");
+      EXPECT_EQ(a.use_count(), 2);
+
+      for (int i = 0; i < 100; ++i)
+      {
+        map.insert_or_assign(stdx::make_retain<Vertex>(i), std::to_string(i));
+      }
+      EXPECT_EQ(map.size(), 101U);
+      EXPECT_EQ(*map.find(b.get()), "bbb");
+    }
+    EXPECT_EQ(a.use_count(), 1);
+    EXPECT_EQ(b.use_count(), 1);
+    EXPECT_EQ(Vertex::instances, 2);
+  }
+} // end of namespace stdx::test
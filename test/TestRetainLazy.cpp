@@ -0,0 +1,138 @@
+#include <retain_lazy.h>
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace stdx::test
+{
+  struct LazyIndex : stdx::atomic_reference_count<LazyIndex>
+  {
+    inline static std::atomic<long> instances{ 0L };
+
+    explicit LazyIndex(int v)
+      : version(v)
+    {
+      ++instances;
+    }
+
+    ~LazyIndex()
+    {
+      --instances;
+    }
+
+    int version;
+  };
+
+  TEST(StdX_RetainLazy, computes_once)
+  {
+    std::atomic<int> calls{ 0 };
+    stdx::retain_lazy<const LazyIndex> lazy([&calls] {
+      ++calls;
+      std::this_thread::yield();
+      return stdx::make_retain<const LazyIndex>(1);
+    });
+    EXPECT_FALSE(lazy.has_value());
+    EXPECT_EQ(lazy.try_get(), nullptr);
+
+    std::vector<stdx::retain_ptr<const LazyIndex>> results(8);
+    std::vector<std::thread> threads;
+    for (auto& result : results)
+    {
+      threads.emplace_back([&lazy, &result] { result = lazy.get(); });
+    }
+    for (auto& t : threads)
+    {
+      t.join();
+    }
+    EXPECT_EQ(calls, 1);
+    for (const auto& result : results)
+    {
+      EXPECT_EQ(result, results.front());
+    }
+    EXPECT_TRUE(lazy.has_value());
+    EXPECT_EQ(lazy.try_get(), results.front());
+    EXPECT_EQ(results.front().use_count(), 9);
+  }
+
+  TEST(StdX_RetainLazy, invalidate_starts_a_new_generation)
+  {
+    LazyIndex::instances = 0;
+    {
+      int version = 0;
+      stdx::retain_lazy<const LazyIndex> lazy([&version] { return stdx::make_retain<const LazyIndex>(++version); });
+      auto first = lazy.get();
+      EXPECT_EQ(first->version, 1);
+      EXPECT_EQ(lazy.generation(), 0U);
+
+      EXPECT_EQ(lazy.invalidate(), 1U);
+      EXPECT_FALSE(lazy.has_value());
+      EXPECT_EQ(first->version, 1);
+      auto second = lazy.get();
+      EXPECT_EQ(second->version, 2);
+      EXPECT_EQ(lazy.get(), second);
+
+      first.reset();
+      stdx::epoch_domain::instance().synchronize();
+      EXPECT_EQ(LazyIndex::instances, 1);
+    }
+    EXPECT_EQ(LazyIndex::instances, 0);
+  }
+
+  TEST(StdX_RetainLazy, failed_computation_is_retried)
+  {
+    int calls = 0;
+    stdx::retain_lazy<const LazyIndex> lazy([&calls] {
+      if (++calls == 1)
+      {
+        throw std::runtime_error("unavailable");
+      }
+      return stdx::make_retain<const LazyIndex>(calls);
+    });
+    EXPECT_THROW(static_cast<void>(lazy.get()), std::runtime_error);
+    EXPECT_FALSE(lazy.has_value());
+    EXPECT_EQ(lazy.get()->version, 2);
+    EXPECT_EQ(calls, 2);
+  }
+
+  TEST(StdX_RetainLazy, concurrent_get_and_invalidate)
+  {
+    LazyIndex::instances = 0;
+    {
+      std::atomic<int> version{ 0 };
+      stdx::retain_lazy<const LazyIndex> lazy([&version] { return stdx::make_retain<const LazyIndex>(++version); });
+      std::atomic<bool> done{ false };
+      std::atomic<int> failures{ 0 };
+      std::vector<std::thread> readers;
+      for (int t = 0; t < 3; ++t)
+      {
+        readers.emplace_back([&] {
+          while (!done.load())
+          {
+            if (!lazy.get())
+            {
+              ++failures;
+            }
+          }
+        });
+      }
+      for (int i = 0; i < 200; ++i)
+      {
+        lazy.invalidate();
+        std::this_thread::yield();
+      }
+      done = true;
+      for (auto& t : readers)
+      {
+        t.join();
+      }
+      EXPECT_EQ(failures, 0);
+      EXPECT_EQ(lazy.generation(), 200U);
+    }
+    stdx::epoch_domain::instance().synchronize();
+    EXPECT_EQ(LazyIndex::instances, 0);
+  }
+} // end of namespace stdx::test
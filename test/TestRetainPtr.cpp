@@ -361,6 +361,31 @@ namespace stdx::test
     EXPECT_EQ(ptr->val, 5);
   }
 
+  struct AtomicTypeWithParam : stdx::atomic_reference_count<AtomicTypeWithParam>
+  {
+    AtomicTypeWithParam(int in) : val(in) {}
+    int val;
+  };
+
+  TEST(StdX_Memory_retain_ptr, copy_does_not_copy_reference_count)
+  {
+    const auto ptr = stdx::make_retain<TypeWithParam>(5);
+    const auto other = ptr;
+    const auto copy = stdx::make_retain<TypeWithParam>(*ptr);
+    EXPECT_EQ(ptr.use_count(), 2);
+    EXPECT_EQ(copy.use_count(), 1);
+    EXPECT_EQ(copy->val, 5);
+    *copy = *ptr;
+    EXPECT_EQ(copy.use_count(), 1);
+
+    const auto atomic_ptr = stdx::make_retain<AtomicTypeWithParam>(7);
+    const auto atomic_other = atomic_ptr;
+    const auto atomic_copy = stdx::make_retain<AtomicTypeWithParam>(*atomic_ptr);
+    EXPECT_EQ(atomic_ptr.use_count(), 2);
+    EXPECT_EQ(atomic_copy.use_count(), 1);
+    EXPECT_EQ(atomic_copy->val, 7);
+  }
+
   TEST(StdX_Memory_retain_ptr, is_retain_ptr)
   {
     auto rp = stdx::make_retain<TypeWithParam>(5);
@@ -571,6 +596,28 @@ namespace stdx::test
     }
   }
 
+  TEST(StdX_Memory_retain_ptr, const_element_type)
+  {
+    {
+      stdx::retain_ptr<const TypeWithParam> cp = stdx::make_retain<TypeWithParam>(5);
+      EXPECT_EQ(cp.use_count(), 1);
+      EXPECT_EQ(cp->val, 5);
+
+      auto cp2 = cp;
+      EXPECT_EQ(cp.use_count(), 2);
+      EXPECT_EQ(cp2.get(), cp.get());
+    }
+
+    {
+      Counter::instances = 0L;
+      stdx::retain_ptr<const ThreadSafeBase_Counted> cp(new ThreadSafeDerived_Counted);
+      EXPECT_EQ(Counter::instances, 1);
+      EXPECT_EQ(cp.use_count(), 1);
+      cp.reset();
+      EXPECT_EQ(Counter::instances, 0);
+    }
+  }
+
   struct BaseTS : stdx::atomic_reference_count<BaseTS>
   {
     BaseTS() = default;
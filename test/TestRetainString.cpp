@@ -0,0 +1,128 @@
+#include <retain_string.h>
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+namespace stdx::test
+{
+  TEST(StdX_RetainString, short_strings_are_inline)
+  {
+    const stdx::retain_string empty;
+    EXPECT_TRUE(empty.empty());
+    EXPECT_TRUE(empty.is_inline());
+    EXPECT_EQ(empty, "");
+
+    const stdx::retain_string s("hello");
+    EXPECT_TRUE(s.is_inline());
+    EXPECT_EQ(s.size(), 5U);
+    EXPECT_EQ(s, "hello");
+    EXPECT_EQ(s.front(), 'h');
+    EXPECT_EQ(s.back(), 'o');
+    EXPECT_EQ(s.at(1), 'e');
+    EXPECT_THROW(static_cast<void>(s.at(5)), std::out_of_range);
+
+    const auto copy = s;
+    EXPECT_NE(copy.data(), s.data());
+    EXPECT_EQ(copy, s);
+  }
+
+  TEST(StdX_RetainString, copies_share_the_characters)
+  {
+    const std::string text(100, 'x');
+    const stdx::retain_string s(text);
+    EXPECT_FALSE(s.is_inline());
+    EXPECT_EQ(s.str(), text);
+
+    auto copy = s;
+    EXPECT_EQ(copy.data(), s.data());
+    EXPECT_EQ(copy, s);
+
+    auto moved = std::move(copy);
+    EXPECT_EQ(moved.data(), s.data());
+    EXPECT_TRUE(copy.empty()); // NOLINT(bugprone-use-after-move)
+
+    copy = moved;
+    EXPECT_EQ(copy.data(), s.data());
+  }
+
+  TEST(StdX_RetainString, substrings_are_views)
+  {
+    const stdx::retain_string s("the quick brown fox jumps over the lazy dog");
+    const auto long_part = s.substr(4, 30);
+    EXPECT_FALSE(long_part.is_inline());
+    EXPECT_EQ(long_part.data(), s.data() + 4);
+    EXPECT_EQ(long_part, "quick brown fox jumps over the");
+
+    const auto nested = long_part.substr(6, 20);
+    EXPECT_EQ(nested.data(), s.data() + 10);
+    EXPECT_EQ(nested, "brown fox jumps over");
+
+    const auto short_part = s.substr(40);
+    EXPECT_TRUE(short_part.is_inline());
+    EXPECT_EQ(short_part, "dog");
+    EXPECT_EQ(s.substr(s.size()), "");
+    EXPECT_THROW(static_cast<void>(s.substr(s.size() + 1)), std::out_of_range);
+  }
+
+  TEST(StdX_RetainString, substrings_outlive_the_string)
+  {
+    stdx::retain_string part;
+    {
+      const stdx::retain_string s(std::string(64, 'a') + std::string(64, 'b'));
+      part = s.substr(60, 40);
+    }
+    EXPECT_EQ(part, std::string(4, 'a') + std::string(36, 'b'));
+  }
+
+  TEST(StdX_RetainString, hash_matches_string_view)
+  {
+    const stdx::retain_string s("a string long enough to be shared");
+    const auto h = std::hash<std::string_view>{}(s.view());
+    EXPECT_EQ(s.hash(), h);
+    EXPECT_EQ(s.hash(), h);
+    EXPECT_EQ(std::hash<stdx::retain_string>{}(s), h);
+    EXPECT_EQ(s.substr(2).hash(), std::hash<std::string_view>{}(s.view().substr(2)));
+    EXPECT_EQ(stdx::retain_string("short").hash(), std::hash<std::string_view>{}("short"));
+
+    std::unordered_set<stdx::retain_string> set{ s, s.substr(0, 8), stdx::retain_string("a string long enough to be shared") };
+    EXPECT_EQ(set.size(), 2U);
+    EXPECT_TRUE(set.count(stdx::retain_string("a string")) == 1);
+  }
+
+  TEST(StdX_RetainString, ordering)
+  {
+    const stdx::retain_string a("apple");
+    const stdx::retain_string b("banana");
+    EXPECT_TRUE(a < b);
+    EXPECT_FALSE(b < a);
+    EXPECT_NE(a, b);
+    EXPECT_NE(a, "apples");
+  }
+
+  TEST(StdX_RetainString, concurrent_copies)
+  {
+    const stdx::retain_string s(std::string(256, 'z'));
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t)
+    {
+      threads.emplace_back([&s] {
+        for (int i = 0; i < 10000; ++i)
+        {
+          const auto copy = s;
+          const auto part = copy.substr(static_cast<std::size_t>(i % 100), 100);
+          EXPECT_EQ(part.hash(), std::hash<std::string_view>{}(part.view()));
+          static_cast<void>(copy.hash());
+        }
+      });
+    }
+    for (auto& t : threads)
+    {
+      t.join();
+    }
+    EXPECT_EQ(s, std::string(256, 'z'));
+  }
+} // end of namespace stdx::test
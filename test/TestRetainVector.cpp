@@ -0,0 +1,219 @@
+#include <retain_vector.h>
+
+#include <gtest/gtest.h>
+
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace stdx::test
+{
+  struct Counted
+  {
+    inline static long increments = 0;
+    inline static long decrements = 0;
+    inline static long instances = 0;
+
+    explicit Counted(int v)
+      : value(v)
+    {
+      ++instances;
+    }
+
+    ~Counted()
+    {
+      --instances;
+    }
+
+    int value;
+    long count{ 1 };
+  };
+
+  // counts the reference count traffic of the container
+  struct counted_traits
+  {
+    static void increment(Counted* p) noexcept
+    {
+      ++Counted::increments;
+      ++p->count;
+    }
+
+    static void decrement(Counted* p) noexcept
+    {
+      ++Counted::decrements;
+      if (--p->count == 0)
+      {
+        delete p;
+      }
+    }
+
+    static long use_count(const Counted* p) noexcept
+    {
+      return p->count;
+    }
+  };
+
+  using counted_ptr = stdx::retain_ptr<Counted, counted_traits>;
+  using counted_vector = stdx::retain_vector<Counted, counted_traits, 2>;
+
+  void reset_counters()
+  {
+    Counted::increments = 0;
+    Counted::decrements = 0;
+  }
+
+  std::vector<int> values_of(const counted_vector& v)
+  {
+    std::vector<int> result;
+    for (const auto& p : v)
+    {
+      result.push_back(p ? p->value : -1);
+    }
+    return result;
+  }
+
+  // a fancy pointer registering its copies, which must not be copied byte-wise
+  struct registered_pointer
+  {
+    registered_pointer(std::nullptr_t = nullptr) noexcept
+    {
+    }
+
+    registered_pointer(const registered_pointer& other) noexcept
+      : p(other.p)
+    {
+    }
+
+    registered_pointer& operator=(const registered_pointer& other) noexcept
+    {
+      p = other.p;
+      return *this;
+    }
+
+    Counted* p{ nullptr };
+  };
+
+  struct registered_traits
+  {
+    using pointer = registered_pointer;
+
+    static void increment(registered_pointer) noexcept
+    {
+    }
+
+    static void decrement(registered_pointer) noexcept
+    {
+    }
+  };
+
+  TEST(StdX_RetainVector, retain_ptr_is_trivially_relocatable)
+  {
+    EXPECT_TRUE(stdx::is_trivially_relocatable_v<counted_ptr>);
+    EXPECT_TRUE(stdx::is_trivially_relocatable_v<int*>);
+    EXPECT_FALSE(stdx::is_trivially_relocatable_v<std::string>);
+    EXPECT_FALSE((stdx::is_trivially_relocatable_v<stdx::retain_ptr<Counted, registered_traits>>));
+  }
+
+  TEST(StdX_RetainVector, growth_does_not_touch_reference_counts)
+  {
+    Counted::instances = 0;
+    {
+      counted_vector v;
+      EXPECT_TRUE(v.is_inline());
+      EXPECT_EQ(v.capacity(), 2U);
+
+      reset_counters();
+      for (int i = 0; i < 100; ++i)
+      {
+        v.push_back(counted_ptr(new Counted(i)));
+      }
+      EXPECT_FALSE(v.is_inline());
+      EXPECT_EQ(v.size(), 100U);
+      EXPECT_EQ(Counted::increments, 0);
+      EXPECT_EQ(Counted::decrements, 0);
+      for (int i = 0; i < 100; ++i)
+      {
+        EXPECT_EQ(v[static_cast<std::size_t>(i)]->value, i);
+        EXPECT_EQ(v[static_cast<std::size_t>(i)].use_count(), 1);
+      }
+    }
+    EXPECT_EQ(Counted::decrements, 100);
+    EXPECT_EQ(Counted::instances, 0);
+  }
+
+  TEST(StdX_RetainVector, insert_and_erase_shift_the_elements)
+  {
+    Counted::instances = 0;
+    counted_vector v;
+    for (int i = 0; i < 5; ++i)
+    {
+      v.emplace_back(new Counted(i));
+    }
+
+    reset_counters();
+    auto it = v.insert(v.begin() + 2, counted_ptr(new Counted(9)));
+    EXPECT_EQ((*it)->value, 9);
+    EXPECT_EQ(values_of(v), (std::vector<int>{ 0, 1, 9, 2, 3, 4 }));
+
+    it = v.erase(v.begin());
+    EXPECT_EQ((*it)->value, 1);
+    it = v.erase(v.begin() + 1, v.begin() + 3);
+    EXPECT_EQ((*it)->value, 3);
+    EXPECT_EQ(values_of(v), (std::vector<int>{ 1, 3, 4 }));
+    EXPECT_EQ(Counted::increments, 0);
+    EXPECT_EQ(Counted::decrements, 3);
+    EXPECT_EQ(Counted::instances, 3);
+
+    v.insert(v.end(), v.front());
+    EXPECT_EQ(values_of(v), (std::vector<int>{ 1, 3, 4, 1 }));
+    EXPECT_EQ(v.front().use_count(), 2);
+
+    v.pop_back();
+    v.resize(5);
+    EXPECT_EQ(values_of(v), (std::vector<int>{ 1, 3, 4, -1, -1 }));
+    v.resize(1);
+    EXPECT_EQ(v.back()->value, 1);
+    EXPECT_THROW(static_cast<void>(v.at(1)), std::out_of_range);
+    v.clear();
+    EXPECT_TRUE(v.empty());
+    EXPECT_EQ(Counted::instances, 0);
+  }
+
+  TEST(StdX_RetainVector, copy_and_move)
+  {
+    Counted::instances = 0;
+    {
+      counted_vector small{ counted_ptr(new Counted(1)) };
+      counted_vector large;
+      for (int i = 0; i < 10; ++i)
+      {
+        large.emplace_back(new Counted(i));
+      }
+
+      auto copy = large;
+      EXPECT_EQ(values_of(copy), values_of(large));
+      EXPECT_EQ(large[3].use_count(), 2);
+
+      reset_counters();
+      auto moved_small = std::move(small);
+      auto moved_large = std::move(large);
+      EXPECT_TRUE(moved_small.is_inline());
+      EXPECT_EQ(moved_small.front()->value, 1);
+      EXPECT_EQ(moved_large.size(), 10U);
+      EXPECT_TRUE(small.empty());
+      EXPECT_TRUE(large.empty());
+      EXPECT_TRUE(large.is_inline());
+      EXPECT_EQ(Counted::increments, 0);
+      EXPECT_EQ(Counted::decrements, 0);
+
+      copy = moved_small;
+      EXPECT_EQ(values_of(copy), (std::vector<int>{ 1 }));
+      EXPECT_EQ(moved_large[3].use_count(), 1);
+      moved_small = std::move(moved_large);
+      EXPECT_EQ(moved_small.size(), 10U);
+      EXPECT_EQ(Counted::instances, 11);
+    }
+    EXPECT_EQ(Counted::instances, 0);
+  }
+} // end of namespace stdx::test
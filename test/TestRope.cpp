@@ -0,0 +1,94 @@
+#include <rope.h>
+
+#include <gtest/gtest.h>
+
+#include <random>
+#include <stdexcept>
+#include <string>
+
+namespace stdx::test
+{
+  TEST(StdX_Rope, basic_operations)
+  {
+    const stdx::rope empty;
+    EXPECT_TRUE(empty.empty());
+    EXPECT_EQ(empty.str(), "");
+
+    const stdx::rope hello("hello world");
+    EXPECT_EQ(hello.size(), 11U);
+    EXPECT_EQ(hello.at(4), 'o');
+    EXPECT_THROW((void)hello.at(11), std::out_of_range);
+    EXPECT_EQ(hello.substr(6).str(), "world");
+    EXPECT_EQ(hello.substr(0, 5), "hello");
+    EXPECT_EQ(hello.insert(5, ",").str(), "hello, world");
+    EXPECT_EQ(hello.erase(5, 6).str(), "hello");
+    EXPECT_EQ(hello.append("!").str(), "hello world!");
+    EXPECT_EQ((hello + stdx::rope("?")).str(), "hello world?");
+    EXPECT_THROW((void)hello.insert(12, "x"), std::out_of_range);
+
+    // the original rope is not modified
+    EXPECT_EQ(hello, "hello world");
+    EXPECT_NE(hello, "hello");
+  }
+
+  TEST(StdX_Rope, edits_match_string)
+  {
+    std::mt19937 gen(5);
+    std::string expected(100000, ' ');
+    for (std::size_t i = 0; i < expected.size(); ++i)
+    {
+      expected[i] = static_cast<char>('a' + i % 26);
+    }
+    stdx::rope text(expected);
+    const auto original = text;
+
+    for (int i = 0; i < 2000; ++i)
+    {
+      std::uniform_int_distribution<std::size_t> position(0, expected.size());
+      const auto pos = position(gen);
+      if (i % 2 == 0)
+      {
+        const std::string inserted(static_cast<std::size_t>(i % 50 + 1), static_cast<char>('A' + i % 26));
+        text = text.insert(pos, inserted);
+        expected.insert(pos, inserted);
+      }
+      else
+      {
+        const auto count = static_cast<std::size_t>(i % 70);
+        text = text.erase(pos, count);
+        expected.erase(pos, count);
+      }
+    }
+    EXPECT_EQ(text.size(), expected.size());
+    EXPECT_EQ(text.str(), expected);
+    EXPECT_EQ(text.substr(1000, 5000).str(), expected.substr(1000, 5000));
+    EXPECT_EQ(text[777], expected[777]);
+    EXPECT_LE(text.height(), 40U);
+    EXPECT_EQ(original.size(), 100000U);
+    EXPECT_EQ(original.at(27), 'b');
+  }
+
+  TEST(StdX_Rope, find_across_chunks)
+  {
+    std::string expected;
+    stdx::rope text;
+    // short appended pieces and full chunks, the needles span their boundaries
+    for (int i = 0; i < 300; ++i)
+    {
+      const auto piece = std::to_string(i) + (i % 7 == 0 ? std::string(1500, '.') : std::string("-"));
+      expected += piece;
+      text = text.append(piece);
+    }
+    ASSERT_EQ(text.str(), expected);
+
+    for (const std::string needle : { "12", "99-100", ".13", "-28.", "299", "1-2-3", "nope", "." })
+    {
+      EXPECT_EQ(text.find(needle), expected.find(needle)) << needle;
+      EXPECT_EQ(text.find(needle, 5000), expected.find(needle, 5000)) << needle;
+    }
+    EXPECT_EQ(text.find('7'), expected.find('7'));
+    EXPECT_EQ(text.find('9', 20000), expected.find('9', 20000));
+    EXPECT_EQ(text.find('x'), stdx::rope::npos);
+    EXPECT_EQ(text.find("", 3), 3U);
+  }
+} // end of namespace stdx::test
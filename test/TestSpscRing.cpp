@@ -0,0 +1,238 @@
+#include <spsc_ring.h>
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <iterator>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace stdx::test
+{
+  struct Item : stdx::atomic_reference_count<Item>
+  {
+    inline static std::atomic<long> instances{ 0L };
+
+    explicit Item(int v)
+      : value(v)
+    {
+      ++instances;
+    }
+
+    Item(const Item&) = delete;
+    Item& operator=(const Item&) = delete;
+
+    ~Item()
+    {
+      --instances;
+    }
+
+    int value;
+  };
+
+  using ItemRing = stdx::spsc_ring<Item>;
+
+  TEST(StdX_SpscRing, capacity_is_power_of_two)
+  {
+    EXPECT_EQ(ItemRing(1).capacity(), 1U);
+    EXPECT_EQ(ItemRing(5).capacity(), 8U);
+    EXPECT_EQ(ItemRing(64).capacity(), 64U);
+  }
+
+  TEST(StdX_SpscRing, push_and_pop)
+  {
+    ItemRing ring(4);
+    EXPECT_TRUE(ring.empty());
+    EXPECT_FALSE(ring.try_pop());
+
+    for (int i = 0; i < 4; ++i)
+    {
+      EXPECT_TRUE(ring.try_push(stdx::make_retain<Item>(i)));
+    }
+    EXPECT_EQ(ring.size(), 4U);
+
+    // the ring is full, the rejected value is untouched
+    auto rejected = stdx::make_retain<Item>(4);
+    EXPECT_FALSE(ring.try_push(std::move(rejected)));
+    EXPECT_TRUE(rejected); // NOLINT(bugprone-use-after-move)
+
+    for (int i = 0; i < 4; ++i)
+    {
+      const auto item = ring.try_pop();
+      ASSERT_TRUE(item);
+      EXPECT_EQ(item->value, i);
+    }
+    EXPECT_TRUE(ring.empty());
+    EXPECT_TRUE(ring.try_push(std::move(rejected)));
+    EXPECT_EQ(ring.try_pop()->value, 4);
+  }
+
+  TEST(StdX_SpscRing, transfer_does_not_touch_reference_count)
+  {
+    ItemRing ring(2);
+    auto item = stdx::make_retain<Item>(0);
+    const auto observer = item;
+    EXPECT_EQ(observer.use_count(), 2);
+
+    ring.try_push(std::move(item));
+    EXPECT_EQ(observer.use_count(), 2);
+
+    const auto popped = ring.try_pop();
+    EXPECT_EQ(popped, observer);
+    EXPECT_EQ(observer.use_count(), 2);
+  }
+
+  TEST(StdX_SpscRing, bulk_operations)
+  {
+    ItemRing ring(4);
+    std::vector<ItemRing::value_type> input;
+    for (int i = 0; i < 6; ++i)
+    {
+      input.push_back(stdx::make_retain<Item>(i));
+    }
+
+    auto it = ring.try_push_bulk(input.begin(), input.end());
+    EXPECT_EQ(std::distance(input.begin(), it), 4);
+    EXPECT_EQ(ring.size(), 4U);
+
+    std::vector<ItemRing::value_type> output;
+    EXPECT_EQ(ring.try_pop_bulk(std::back_inserter(output), 3), 3U);
+    ASSERT_EQ(output.size(), 3U);
+    EXPECT_EQ(output[0]->value, 0);
+    EXPECT_EQ(output[2]->value, 2);
+
+    it = ring.try_push_bulk(it, input.end());
+    EXPECT_EQ(it, input.end());
+
+    EXPECT_EQ(ring.try_pop_bulk(std::back_inserter(output), 10), 3U);
+    ASSERT_EQ(output.size(), 6U);
+    for (int i = 0; i < 6; ++i)
+    {
+      EXPECT_EQ(output[i]->value, i);
+    }
+    EXPECT_EQ(ring.try_pop_bulk(std::back_inserter(output), 10), 0U);
+  }
+
+  // writes to a vector, throws on the assignment number fail_at
+  struct FailingOutput
+  {
+    using iterator_category = std::output_iterator_tag;
+    using value_type = void;
+    using difference_type = std::ptrdiff_t;
+    using pointer = void;
+    using reference = void;
+
+    FailingOutput& operator*()
+    {
+      return *this;
+    }
+
+    FailingOutput& operator++()
+    {
+      return *this;
+    }
+
+    FailingOutput& operator=(ItemRing::value_type value)
+    {
+      if (++*assignments == fail_at)
+      {
+        throw std::runtime_error("output full");
+      }
+      out->push_back(std::move(value));
+      return *this;
+    }
+
+    std::vector<ItemRing::value_type>* out;
+    int* assignments;
+    int fail_at;
+  };
+
+  TEST(StdX_SpscRing, bulk_pop_with_throwing_output)
+  {
+    Item::instances = 0L;
+    {
+      ItemRing ring(8);
+      for (int i = 0; i < 5; ++i)
+      {
+        ring.try_push(stdx::make_retain<Item>(i));
+      }
+      std::vector<ItemRing::value_type> output;
+      int assignments = 0;
+      EXPECT_THROW(ring.try_pop_bulk(FailingOutput{ &output, &assignments, 2 }, 4), std::runtime_error);
+      ASSERT_EQ(output.size(), 1U);
+      EXPECT_EQ(output[0]->value, 0);
+      // the object whose assignment threw is released
+      EXPECT_EQ(ring.size(), 3U);
+      EXPECT_EQ(Item::instances, 4);
+      EXPECT_EQ(ring.try_pop()->value, 2);
+    }
+    EXPECT_EQ(Item::instances, 0);
+  }
+
+  TEST(StdX_SpscRing, destructor_releases_objects)
+  {
+    Item::instances = 0L;
+    {
+      ItemRing ring(8);
+      for (int i = 0; i < 5; ++i)
+      {
+        ring.try_push(stdx::make_retain<Item>(i));
+      }
+      EXPECT_EQ(Item::instances, 5);
+    }
+    EXPECT_EQ(Item::instances, 0);
+  }
+
+  TEST(StdX_SpscRing, destructor_releases_objects_behind_a_null)
+  {
+    Item::instances = 0L;
+    {
+      ItemRing ring(8);
+      ring.try_push(stdx::make_retain<Item>(0));
+      ring.try_push(ItemRing::value_type());
+      ring.try_push(stdx::make_retain<Item>(2));
+      EXPECT_EQ(ring.size(), 3U);
+      EXPECT_EQ(Item::instances, 2);
+    }
+    EXPECT_EQ(Item::instances, 0);
+  }
+
+  TEST(StdX_SpscRing, producer_and_consumer_threads)
+  {
+    Item::instances = 0L;
+    constexpr int count = 100000;
+    {
+      ItemRing ring(64);
+      std::thread producer([&ring] {
+        for (int i = 0; i < count; ++i)
+        {
+          auto item = stdx::make_retain<Item>(i);
+          while (!ring.try_push(std::move(item)))
+          {
+            std::this_thread::yield();
+          }
+        }
+      });
+
+      int expected = 0;
+      std::vector<ItemRing::value_type> batch;
+      while (expected < count)
+      {
+        batch.clear();
+        if (ring.try_pop_bulk(std::back_inserter(batch), 16) == 0)
+        {
+          std::this_thread::yield();
+        }
+        for (const auto& item : batch)
+        {
+          EXPECT_EQ(item->value, expected);
+          ++expected;
+        }
+      }
+      producer.join();
+      EXPECT_TRUE(ring.empty());
+    }
+    EXPECT_EQ(Item::instances, 0);
+  }
+} // end of namespace stdx::test
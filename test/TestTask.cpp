@@ -0,0 +1,143 @@
+#include <task.h>
+
+#include <gtest/gtest.h>
+
+#if __cplusplus >= 202002L && defined(__cpp_impl_coroutine)
+
+#include <atomic>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+namespace stdx::test
+{
+  struct FrameLocal
+  {
+    inline static std::atomic<long> instances{ 0L };
+
+    FrameLocal()
+    {
+      ++instances;
+    }
+
+    FrameLocal(const FrameLocal&) = delete;
+    FrameLocal& operator=(const FrameLocal&) = delete;
+
+    ~FrameLocal()
+    {
+      --instances;
+    }
+  };
+
+  stdx::task<int> answer()
+  {
+    co_return 42;
+  }
+
+  stdx::task<std::string> describe()
+  {
+    const auto value = co_await answer();
+    co_return "answer " + std::to_string(value);
+  }
+
+  stdx::task<> fail()
+  {
+    throw std::runtime_error("failed");
+    co_return;
+  }
+
+  stdx::task<int> count_up(int n)
+  {
+    int sum = 0;
+    for (int i = 0; i < n; ++i)
+    {
+      // completes synchronously and resumes the awaiting coroutine by symmetric transfer
+      sum += co_await answer() - 41;
+    }
+    co_return sum;
+  }
+
+  TEST(StdX_Task, awaiting_chain)
+  {
+    EXPECT_EQ(stdx::sync_wait(answer()), 42);
+    EXPECT_EQ(stdx::sync_wait(describe()), "answer 42");
+    EXPECT_EQ(stdx::sync_wait(count_up(1000)), 1000);
+  }
+
+  TEST(StdX_Task, exceptions_propagate)
+  {
+    EXPECT_THROW(stdx::sync_wait(fail()), std::runtime_error);
+
+    auto awaiting = []() -> stdx::task<bool> {
+      try
+      {
+        co_await fail();
+      }
+      catch (const std::runtime_error&)
+      {
+        co_return true;
+      }
+      co_return false;
+    };
+    EXPECT_TRUE(stdx::sync_wait(awaiting()));
+  }
+
+  TEST(StdX_Task, frame_is_retained)
+  {
+    FrameLocal::instances = 0L;
+    auto make = []() -> stdx::task<int> {
+      FrameLocal local;
+      co_return 1;
+    };
+
+    auto t = make();
+    EXPECT_FALSE(t.is_ready());
+    auto frame = t.frame();
+    EXPECT_EQ(frame.use_count(), 2);
+    EXPECT_EQ(stdx::sync_wait(std::move(t)), 1);
+
+    // the completed frame is kept by the remaining reference
+    EXPECT_EQ(FrameLocal::instances, 0);
+    EXPECT_EQ(frame.use_count(), 1);
+    EXPECT_EQ(frame->result(), 1);
+    frame.reset();
+
+    // an abandoned task destroys its suspended frame
+    {
+      auto abandoned = []() -> stdx::task<> {
+        FrameLocal local;
+        co_return;
+      }();
+      EXPECT_TRUE(abandoned);
+    }
+    EXPECT_EQ(FrameLocal::instances, 0);
+  }
+
+  TEST(StdX_Task, resumed_on_another_thread)
+  {
+    struct resume_on_new_thread
+    {
+      bool await_ready() const noexcept
+      {
+        return false;
+      }
+
+      void await_suspend(std::coroutine_handle<> h)
+      {
+        std::thread([h] { h.resume(); }).detach();
+      }
+
+      void await_resume() const noexcept
+      {
+      }
+    };
+
+    auto work = []() -> stdx::task<std::thread::id> {
+      co_await resume_on_new_thread{};
+      co_return std::this_thread::get_id();
+    };
+    EXPECT_NE(stdx::sync_wait(work()), std::this_thread::get_id());
+  }
+} // end of namespace stdx::test
+
+#endif
@@ -0,0 +1,163 @@
+#include <task_graph.h>
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+
+namespace stdx::test
+{
+  struct CountedNode : stdx::task_node
+  {
+    inline static std::atomic<long> instances{ 0L };
+
+    CountedNode()
+    {
+      ++instances;
+    }
+
+    ~CountedNode() override
+    {
+      --instances;
+    }
+
+    void execute() override
+    {
+    }
+  };
+
+  TEST(StdX_TaskGraph, runs_nodes_in_dependency_order)
+  {
+    stdx::work_stealing_executor executor(2);
+    stdx::task_graph graph;
+    std::atomic<int> clock{ 0 };
+    int a_time = -1;
+    int b_time = -1;
+    int c_time = -1;
+    int d_time = -1;
+
+    // a -> b, a -> c, b -> d, c -> d
+    auto& a = graph.emplace([&] { a_time = clock++; });
+    auto& b = graph.emplace([&] { b_time = clock++; });
+    auto& c = graph.emplace([&] { c_time = clock++; });
+    auto& d = graph.emplace([&] { d_time = clock++; });
+    a.precede(b);
+    a.precede(c);
+    b.precede(d);
+    c.precede(d);
+    EXPECT_EQ(d.dependency_count(), 2U);
+    EXPECT_EQ(a.successor_count(), 2U);
+    EXPECT_EQ(graph.size(), 4U);
+
+    graph.run(executor);
+    EXPECT_EQ(clock, 4);
+    EXPECT_EQ(a_time, 0);
+    EXPECT_LT(a_time, b_time);
+    EXPECT_LT(a_time, c_time);
+    EXPECT_EQ(d_time, 3);
+  }
+
+  TEST(StdX_TaskGraph, run_again_and_empty_graph)
+  {
+    stdx::work_stealing_executor executor(2);
+    stdx::task_graph empty;
+    empty.run(executor);
+
+    stdx::task_graph graph;
+    std::atomic<int> count{ 0 };
+    auto& first = graph.emplace([&count] { ++count; });
+    for (int i = 0; i < 10; ++i)
+    {
+      first.precede(graph.emplace([&count] { ++count; }));
+    }
+
+    graph.run(executor);
+    EXPECT_EQ(count, 11);
+    graph.run(executor);
+    EXPECT_EQ(count, 22);
+  }
+
+  TEST(StdX_TaskGraph, graph_without_sink_throws)
+  {
+    stdx::work_stealing_executor executor(2);
+    stdx::task_graph graph;
+    std::atomic<int> count{ 0 };
+    auto& a = graph.emplace([&count] { ++count; });
+    auto& b = graph.emplace([&count] { ++count; });
+    a.precede(b);
+    b.precede(a);
+    EXPECT_THROW(graph.run(executor), std::logic_error);
+    EXPECT_EQ(count, 0);
+  }
+
+  TEST(StdX_TaskGraph, cycle_with_sink_throws)
+  {
+    stdx::work_stealing_executor executor(2);
+    stdx::task_graph graph;
+    std::atomic<int> count{ 0 };
+    auto& root = graph.emplace([&count] { ++count; });
+    auto& a = graph.emplace([&count] { ++count; });
+    auto& b = graph.emplace([&count] { ++count; });
+    auto& sink = graph.emplace([&count] { ++count; });
+    root.precede(a);
+    a.precede(b);
+    b.precede(a);
+    b.precede(sink);
+    EXPECT_THROW(graph.run(executor), std::logic_error);
+    EXPECT_EQ(count, 0);
+  }
+
+  TEST(StdX_TaskGraph, nodes_released_with_graph)
+  {
+    stdx::work_stealing_executor executor(2);
+    {
+      stdx::task_graph graph;
+      auto& root = graph.add(stdx::retain_ptr<stdx::task_node>(new CountedNode, stdx::adopt_object));
+      root.precede(graph.add(stdx::retain_ptr<stdx::task_node>(new CountedNode, stdx::adopt_object)));
+      graph.run(executor);
+      EXPECT_EQ(CountedNode::instances, 2);
+    }
+    EXPECT_EQ(CountedNode::instances, 0);
+  }
+
+  TEST(StdX_TaskGraph, wide_layered_graph)
+  {
+    constexpr int layers = 20;
+    constexpr int width = 50;
+    stdx::work_stealing_executor executor(4);
+    stdx::task_graph graph;
+    std::vector<std::atomic<bool>> finished(layers * width);
+    std::atomic<int> count{ 0 };
+    std::atomic<bool> ordered{ true };
+
+    std::vector<stdx::task_node*> previous;
+    for (int l = 0; l < layers; ++l)
+    {
+      std::vector<stdx::task_node*> current;
+      for (int i = 0; i < width; ++i)
+      {
+        auto& n = graph.emplace([&finished, &count, &ordered, l, i] {
+          // every node depends on two nodes of the previous layer
+          if (l > 0 && (!finished[(l - 1) * width + i] || !finished[(l - 1) * width + (i + 1) % width]))
+          {
+            ordered = false;
+          }
+          finished[l * width + i] = true;
+          ++count;
+        });
+        if (!previous.empty())
+        {
+          previous[i]->precede(n);
+          previous[(i + 1) % width]->precede(n);
+        }
+        current.push_back(&n);
+      }
+      previous = std::move(current);
+    }
+
+    graph.run(executor);
+    EXPECT_EQ(count, layers * width);
+    EXPECT_TRUE(ordered);
+  }
+} // end of namespace stdx::test
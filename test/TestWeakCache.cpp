@@ -0,0 +1,168 @@
+#include <weak_cache.h>
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace stdx::test
+{
+  struct Texture
+  {
+    inline static std::atomic<long> instances{ 0L };
+
+    explicit Texture(std::string n)
+      : name(std::move(n))
+    {
+      ++instances;
+    }
+
+    Texture(Texture&& other)
+      : name(std::move(other.name))
+    {
+      ++instances;
+    }
+
+    ~Texture()
+    {
+      --instances;
+    }
+
+    std::string name;
+  };
+
+  TEST(StdX_WeakCache, lookup_returns_the_live_value)
+  {
+    Texture::instances = 0;
+    stdx::weak_cache<int, Texture> cache;
+    const auto a = cache.try_emplace(1, "grass");
+    const auto b = cache.try_emplace(1, "ignored");
+
+    EXPECT_EQ(a, b);
+    EXPECT_EQ(b->name, "grass");
+    EXPECT_EQ(a.use_count(), 2);
+    EXPECT_EQ(cache.find(1), a);
+    EXPECT_EQ(cache.find(2), nullptr);
+    EXPECT_EQ(cache.size(), 1U);
+    EXPECT_EQ(Texture::instances, 1);
+  }
+
+  TEST(StdX_WeakCache, cache_does_not_extend_lifetime)
+  {
+    Texture::instances = 0;
+    stdx::weak_cache<std::string, Texture> cache(4);
+    {
+      auto rock = cache.try_emplace("rock", "rock.png");
+      auto sand = cache.try_emplace("sand", "sand.png");
+      EXPECT_EQ(cache.size(), 2U);
+      rock.reset();
+      EXPECT_EQ(cache.size(), 1U);
+      EXPECT_EQ(cache.find("rock"), nullptr);
+      EXPECT_EQ(Texture::instances, 1);
+    }
+    EXPECT_EQ(cache.size(), 0U);
+    EXPECT_EQ(Texture::instances, 0);
+  }
+
+  TEST(StdX_WeakCache, get_or_create_invokes_the_factory_on_miss)
+  {
+    Texture::instances = 0;
+    stdx::weak_cache<int, Texture> cache;
+    int calls = 0;
+    const auto make = [&calls] {
+      ++calls;
+      return Texture("water");
+    };
+    auto a = cache.get_or_create(3, make);
+    auto b = cache.get_or_create(3, make);
+    EXPECT_EQ(calls, 1);
+    EXPECT_EQ(a, b);
+
+    a.reset();
+    b.reset();
+    auto c = cache.get_or_create(3, make);
+    EXPECT_EQ(calls, 2);
+    EXPECT_EQ(c->name, "water");
+    EXPECT_EQ(Texture::instances, 1);
+  }
+
+  TEST(StdX_WeakCache, erased_values_stay_alive)
+  {
+    Texture::instances = 0;
+    stdx::weak_cache<int, Texture> cache;
+    auto a = cache.try_emplace(1, "lava");
+    EXPECT_TRUE(cache.erase(1));
+    EXPECT_FALSE(cache.erase(1));
+    EXPECT_EQ(cache.find(1), nullptr);
+    EXPECT_EQ(a->name, "lava");
+
+    auto b = cache.try_emplace(1, "ice");
+    a.reset();
+    EXPECT_EQ(cache.find(1), b);
+    EXPECT_EQ(Texture::instances, 1);
+  }
+
+  TEST(StdX_WeakCache, values_may_outlive_the_cache)
+  {
+    Texture::instances = 0;
+    stdx::weak_cache<int, Texture>::pointer kept;
+    {
+      stdx::weak_cache<int, Texture> cache;
+      kept = cache.try_emplace(5, "snow");
+    }
+    EXPECT_EQ(kept->name, "snow");
+    kept.reset();
+    EXPECT_EQ(Texture::instances, 0);
+  }
+
+  TEST(StdX_WeakCache, erased_values_may_outlive_the_cache)
+  {
+    Texture::instances = 0;
+    stdx::weak_cache<int, Texture>::pointer kept;
+    {
+      stdx::weak_cache<int, Texture> cache;
+      kept = cache.try_emplace(1, "moss");
+      EXPECT_TRUE(cache.erase(1));
+      auto released = cache.try_emplace(2, "sand");
+      EXPECT_TRUE(cache.erase(2));
+      released.reset();
+      EXPECT_EQ(Texture::instances, 1);
+    }
+    EXPECT_EQ(kept->name, "moss");
+    kept.reset();
+    EXPECT_EQ(Texture::instances, 0);
+  }
+
+  TEST(StdX_WeakCache, concurrent_lookup_and_release)
+  {
+    Texture::instances = 0;
+    stdx::weak_cache<int, Texture> cache(8);
+    constexpr int keys = 16;
+    std::vector<std::thread> threads;
+    std::atomic<int> mismatches{ 0 };
+    for (int t = 0; t < 4; ++t)
+    {
+      threads.emplace_back([&cache, &mismatches, t] {
+        for (int i = 0; i < 5000; ++i)
+        {
+          const auto k = (i + t) % keys;
+          auto first = cache.get_or_create(k, [k] { return Texture(std::to_string(k)); });
+          auto second = cache.try_emplace(k, "unused");
+          if (first != second || first->name != std::to_string(k))
+          {
+            ++mismatches;
+          }
+        }
+      });
+    }
+    for (auto& t : threads)
+    {
+      t.join();
+    }
+    EXPECT_EQ(mismatches, 0);
+    EXPECT_EQ(cache.size(), 0U);
+    EXPECT_EQ(Texture::instances, 0);
+  }
+} // end of namespace stdx::test